@@ -0,0 +1,115 @@
+﻿/***************************************************************************
+  文件名称：BSTBenchmark.cpp
+  功    能：树查找、批量查找与只读快照、学习型索引查找的性能对比
+  说    明：命令行程序，CMake 中打开 BSTDISPLAY_BUILD_BENCHMARK 才会构建；
+            用法：BSTBenchmark [最大规模的指数]，规模从 1e3 到 1e指数（默认 1e8，约需 3GB 内存）
+***************************************************************************/
+#include <QElapsedTimer>
+#include <QVector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include "BinarySearchTree.h"
+
+const int QueryCount = 2000000; // 每项测试的查询次数
+
+/***************************************************************************
+  函数名称：measure
+  功    能：测量一种查找方式的平均耗时
+  输入参数：queries - 查询值，lookup - 查找函数，返回参与校验和的值，checksum - 累加校验和
+  返 回 值：double - 每次查找的纳秒数
+  说    明：校验和用于防止编译器把查找优化掉，也用来核对两种查找的结果一致
+***************************************************************************/
+template <typename Lookup>
+static double measure(const QVector<int>& queries, Lookup lookup, quint64& checksum) {
+    QElapsedTimer timer;
+    timer.start();
+    for (int query : queries) {
+        checksum += static_cast<quint64>(lookup(query));
+    }
+    return static_cast<double>(timer.nsecsElapsed()) / queries.size();
+}
+
+/***************************************************************************
+  函数名称：main
+  功    能：按规模依次测试并输出结果表
+  输入参数：argc, argv - 命令行参数
+  返 回 值：int - 程序退出码
+  说    明：树中的值为 0, 2, 4, ...，查询值在 [0, 2n) 中均匀随机，约一半命中；
+            依次测树、树的批量查找、学习型索引和 Eytzinger 快照（前者存在时查找优先走后者），各项的校验和应当相同
+***************************************************************************/
+int main(int argc, char* argv[]) {
+    int maxExponent = argc > 1 ? std::atoi(argv[1]) : 8;
+    maxExponent = std::max(3, std::min(maxExponent, 8));
+
+    std::printf("%10s | %9s %9s %9s %9s | %9s %9s | %9s %9s | %7s %7s %8s\n",
+        "keys", "tree", "batch", "learned", "snapshot", "tree", "snapshot", "tree", "learned", "snap MB", "RMI MB", "RMI err");
+    std::printf("%10s | %39s | %19s | %19s |\n", "", "find (ns)", "lower_bound (ns)", "rank (ns)");
+
+    std::mt19937 generator(2024);
+    int keyCount = 1000;
+    for (int exponent = 3; exponent <= maxExponent; exponent++, keyCount *= 10) {
+        BinarySearchTree tree;
+        {
+            QVector<int> values(keyCount);
+            for (int i = 0; i < keyCount; i++) {
+                values[i] = i * 2;
+            }
+            tree.assign(values);
+        }
+
+        std::uniform_int_distribution<int> distribution(0, keyCount * 2 - 1);
+        QVector<int> queries(QueryCount);
+        for (int& query : queries) {
+            query = distribution(generator);
+        }
+
+        auto findLookup = [&tree](int value) {
+            return tree.contains(value) ? 1 : 0;
+        };
+        auto lowerLookup = [&tree](int value) {
+            int result = -1;
+            tree.lowerBound(value, result);
+            return result;
+        };
+        auto rankLookup = [&tree](int value) {
+            return tree.rank(value);
+        };
+
+        quint64 treeFindSum = 0, treeLowerSum = 0, treeRankSum = 0;
+        double treeFind  = measure(queries, findLookup, treeFindSum);
+        double treeLower = measure(queries, lowerLookup, treeLowerSum);
+        double treeRank  = measure(queries, rankLookup, treeRankSum);
+
+        quint64 batchFindSum = 0;
+        QVector<int> depths;
+        QElapsedTimer timer;
+        timer.start();
+        batchFindSum += static_cast<quint64>(tree.findMany(queries, depths));
+        double batchFind = static_cast<double>(timer.nsecsElapsed()) / queries.size();
+
+        tree.freezeLearnedIndex();
+
+        quint64 learnedFindSum = 0, learnedRankSum = 0;
+        double learnedFind = measure(queries, findLookup, learnedFindSum);
+        double learnedRank = measure(queries, rankLookup, learnedRankSum);
+
+        tree.freezeSnapshot();
+
+        quint64 snapFindSum = 0, snapLowerSum = 0;
+        double snapFind  = measure(queries, findLookup, snapFindSum);
+        double snapLower = measure(queries, lowerLookup, snapLowerSum);
+
+        bool consistent = treeFindSum == batchFindSum && treeFindSum == learnedFindSum && treeFindSum == snapFindSum &&
+            treeLowerSum == snapLowerSum && treeRankSum == learnedRankSum;
+        std::printf("%10d | %9.1f %9.1f %9.1f %9.1f | %9.1f %9.1f | %9.1f %9.1f | %7.1f %7.1f %8d%s\n",
+            keyCount, treeFind, batchFind, learnedFind, snapFind, treeLower, snapLower, treeRank, learnedRank,
+            tree.getSnapshot().getBytesReserved() / (1024.0 * 1024.0),
+            tree.getLearnedIndex().getBytesReserved() / (1024.0 * 1024.0),
+            tree.getLearnedIndex().getMaxError(),
+            consistent ? "" : "  (结果不一致)");
+    }
+
+    return 0;
+}
\ No newline at end of file
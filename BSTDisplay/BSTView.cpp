@@ -23,11 +23,11 @@
   说    明：初始化布局参数、缩放因子和交互状态
 ***************************************************************************/
 BSTView::BSTView(QWidget* parent) :
-    QWidget(parent)  , bst(nullptr),
+    QWidget(parent)  , bst(nullptr), secondBst(nullptr),
     zoomFactor(1.0)  , xOffset(0), yOffset(0),
     isDragging(false), lastDragPos(0, 0),
     treeWidth(0)     , treeHeight(0), 
-    rootX(0)         , rootY(0),
+    rootX(0)         , rootY(0), secondRootX(0),
     highlightedValue(-1)
 {
     setMinimumSize(400, 300);
@@ -43,7 +43,8 @@ BSTView::BSTView(QWidget* parent) :
   功    能：设置要显示的二叉搜索树
   输入参数：tree - 二叉搜索树指针
   返 回 值：
-  说    明：连接树的变化信号到视图的槽函数，并重新计算布局
+  说    明：连接树的变化信号到视图的槽函数，开启树的版本发布，并重新计算布局；
+            须在树没有被其他线程修改时调用
 ***************************************************************************/
 void BSTView::setTree(BinarySearchTree* tree) {
     if (bst) {
@@ -57,6 +58,7 @@ void BSTView::setTree(BinarySearchTree* tree) {
     bst = tree;
 
     if (bst) {
+        bst->setPublishing(true);
         connect(bst, &BinarySearchTree::treeChanged,     this, &BSTView::onTreeChanged);
         connect(bst, &BinarySearchTree::animationStep,   this, &BSTView::onAnimationStep);
         connect(bst, &BinarySearchTree::highlightNode,   this, &BSTView::onHighlightNode);
@@ -64,11 +66,63 @@ void BSTView::setTree(BinarySearchTree* tree) {
         connect(bst, &BinarySearchTree::highlightPath,   this, &BSTView::onHighlightPath);
     }
 
+    pinVersions();
     calculatePositions();
     resetView();
     update();
 }
 
+/***************************************************************************
+  函数名称：BSTView::setSecondTree
+  功    能：设置并排显示的第二棵树
+  输入参数：tree - 二叉搜索树指针，为空时只显示主树
+  返 回 值：
+  说    明：用于显示拆分出的右半棵树，只响应其结构变化，不参与动画和高亮；
+            与主树一样开启版本发布
+***************************************************************************/
+void BSTView::setSecondTree(BinarySearchTree* tree) {
+    if (secondBst) {
+        disconnect(secondBst, &BinarySearchTree::treeChanged, this, &BSTView::onTreeChanged);
+    }
+
+    secondBst = tree;
+
+    if (secondBst) {
+        secondBst->setPublishing(true);
+        connect(secondBst, &BinarySearchTree::treeChanged, this, &BSTView::onTreeChanged);
+    }
+
+    pinVersions();
+    calculatePositions();
+    resetView();
+    update();
+}
+
+/***************************************************************************
+  函数名称：BSTView::pinVersions
+  功    能：重新登记两棵树最新发布的版本
+  输入参数：
+  返 回 值：
+  说    明：先取得新版本再放开旧版本；节点位置列表中的句柄指向旧版本，调用后须重新计算布局
+***************************************************************************/
+void BSTView::pinVersions() {
+    shownVersion  = bst ? bst->acquireVersion() : TreePublisher::ReadGuard();
+    secondVersion = secondBst ? secondBst->acquireVersion() : TreePublisher::ReadGuard();
+}
+
+/***************************************************************************
+  函数名称：BSTView::isViewEmpty
+  功    能：检查视图中是否没有节点
+  输入参数：
+  返 回 值：bool - 主树和第二棵树都为空时返回true
+  说    明：按已发布的版本判断，不读取正在修改的树
+***************************************************************************/
+bool BSTView::isViewEmpty() const {
+    bool firstEmpty  = !shownVersion || shownVersion->isEmpty();
+    bool secondEmpty = !secondVersion || secondVersion->isEmpty();
+    return firstEmpty && secondEmpty;
+}
+
 /***************************************************************************
   函数名称：BSTView::sizeHint
   功    能：返回视图的建议大小
@@ -105,7 +159,7 @@ void BSTView::paintEvent(QPaintEvent* event) {
         painter.drawText(10, 30, currentAnimationStep);
     }
 
-    if (!bst || bst->isEmpty()) {
+    if (isViewEmpty()) {
         painter.setPen(Qt::white);
         painter.drawText(rect(), Qt::AlignCenter, QString::fromUtf8("树为空"));
         return;
@@ -283,7 +337,7 @@ void BSTView::zoomOut() {
   说    明：重新计算节点位置并重置视图到初始状态
 ***************************************************************************/
 void BSTView::resetView() {
-    if (!bst || bst->isEmpty()) 
+    if (isViewEmpty()) 
         return;
 
     // 重新计算位置
@@ -292,7 +346,7 @@ void BSTView::resetView() {
     // lambda表达式匿名函数:找到根节点的位置
     auto rootIt = std::find_if(nodePositions.begin(), nodePositions.end(),
         [this](const NodePosition& np) { 
-            return np.node == bst->getRoot(); 
+            return np.node == shownVersion->getRoot(); 
         });
 
     if (rootIt != nodePositions.end()) {
@@ -304,6 +358,12 @@ void BSTView::resetView() {
         yOffset = rootY;
     }
 
+    // 并排显示两棵树时以两个根节点的中点为中心
+    if (secondVersion && !secondVersion->isEmpty()) {
+        xOffset = (rootX + secondRootX) / 2;
+        yOffset = rootY;
+    }
+
     // 自动调整缩放
     adjustZoom();
 }
@@ -316,7 +376,7 @@ void BSTView::resetView() {
   说    明：根据树的大小自动调整缩放因子
 ***************************************************************************/
 void BSTView::adjustZoom() {
-    if (!bst || bst->isEmpty()) 
+    if (isViewEmpty()) 
         return;
 
     // 根据树的大小自动调整缩放
@@ -339,16 +399,18 @@ void BSTView::adjustZoom() {
 void BSTView::calculatePositions() {
     nodePositions.clear();
 
-    if (!bst || bst->isEmpty()) 
+    if (isViewEmpty()) 
         return;
 
-    // 使用对称布局算法
+    // 使用对称布局算法，主树为空时根节点坐标仍取原点
     calculateSymmetricLayout();
+    rootX = 0;
+    rootY = 0;
 
     //lambda匿名函数:找到根节点的位置
     auto rootIt = std::find_if(nodePositions.begin(), nodePositions.end(),
         [this](const NodePosition& np) { 
-            return np.node == bst->getRoot();
+            return np.node == shownVersion->getRoot();
         });
 
     if (rootIt != nodePositions.end()) {
@@ -362,14 +424,18 @@ void BSTView::calculatePositions() {
   功    能：计算节点大小
   输入参数：
   返 回 值：int - 节点大小
-  说    明：根据树的深度和节点数量动态计算节点大小
+  说    明：根据树的深度和节点数量动态计算节点大小，两者均由树直接给出
 ***************************************************************************/
 int BSTView::calculateNodeSize() {
-    if (!bst || bst->isEmpty()) 
+    if (isViewEmpty()) 
         return 30;
 
-    int maxDepth = getTreeDepth(bst->getRoot());
-    int nodeCount = nodePositions.size();
+    int maxDepth  = shownVersion ? shownVersion->height : 0;
+    int nodeCount = shownVersion ? shownVersion->nodeCount : 0;
+    if (secondVersion) {
+        maxDepth  = std::max(maxDepth, secondVersion->height);
+        nodeCount = std::max(nodeCount, secondVersion->nodeCount);
+    }
 
     // 根据树的深度和节点数量动态计算节点大小
     const int baseSize = 40;
@@ -385,7 +451,7 @@ int BSTView::calculateNodeSize() {
   返 回 值：int - 子树宽度
   说    明：递归计算子树的宽度，用于布局计算
 ***************************************************************************/
-int BSTView::calculateSubtreeWidth(TreeNode* node, int level) {
+int BSTView::calculateSubtreeWidth(NodeHandle node, int level) {
     if (!node) 
         return 0;
 
@@ -409,7 +475,7 @@ int BSTView::calculateSubtreeWidth(TreeNode* node, int level) {
   返 回 值：
   说    明：递归定位节点及其子节点
 ***************************************************************************/
-void BSTView::positionNode(TreeNode* node, int x, int y, int level, int hGap) {
+void BSTView::positionNode(NodeHandle node, int x, int y, int level, int hGap) {
     if (!node) 
         return;
 
@@ -438,23 +504,6 @@ void BSTView::positionNode(TreeNode* node, int x, int y, int level, int hGap) {
     }
 }
 
-/***************************************************************************
-  函数名称：BSTView::getTreeDepth
-  功    能：获取树深度
-  输入参数：node - 树根节点
-  返 回 值：int - 树深度
-  说    明：递归计算树的最大深度
-***************************************************************************/
-int BSTView::getTreeDepth(TreeNode* node) {
-    if (!node) 
-        return 0;
-
-    int leftDepth  = getTreeDepth(node->left);
-    int rightDepth = getTreeDepth(node->right);
-
-    return 1 + std::max(leftDepth, rightDepth);
-}
-
 /***************************************************************************
   函数名称：BSTView::drawTree
   功    能：绘制树
@@ -466,7 +515,7 @@ int BSTView::getTreeDepth(TreeNode* node) {
 void BSTView::drawTree(QPainter* painter) {
     // 先绘制所有连接线
     for (const NodePosition& pos : nodePositions) {
-        TreeNode* node = pos.node;
+        NodeHandle node = pos.node;
 
         // 绘制左子节点连接线
         if (node->left) {
@@ -545,7 +594,16 @@ void BSTView::drawTree(QPainter* painter) {
         font.setBold(true);
         painter->setFont(font);
         painter->drawText(QRect(pos.x - pos.size / 2, pos.y - pos.size / 2, pos.size, pos.size),
-            Qt::AlignCenter, QString::number(pos.node->value));
+            Qt::AlignCenter, KeyTraits<int>::toString(pos.node->value));
+
+        // 绘制重复次数 - 多重集合中重复的值在节点右上角标出“×次数”
+        if (pos.node->count > 1) {
+            painter->setPen(QColor(200, 60, 60));
+            font.setPointSize(pos.size / 5);
+            painter->setFont(font);
+            painter->drawText(QRect(pos.x, pos.y - pos.size / 2 - 20, pos.size, 20),
+                Qt::AlignLeft | Qt::AlignBottom, QString::fromUtf8("×") + QString::number(pos.node->count));
+        }
 
         // 绘制节点深度 - 使用浅灰色文字
         painter->setPen(QColor(200, 200, 200));
@@ -560,11 +618,18 @@ void BSTView::drawTree(QPainter* painter) {
 /***************************************************************************
   函数名称：BSTView::onTreeChanged
   功    能：树变化响应
-  输入参数：
+  输入参数：change - 变化摘要（批量修改时为整批的摘要）
   返 回 值：
-  说    明：当树结构变化时重新计算节点位置并更新视图
+  说    明：当树结构变化时登记最新发布的版本，重新计算节点位置并更新视图；
+            插入已有的值、删除不存在的值等没有实际变化时跳过重新布局；
+            树在其他线程上修改时信号排队送达，连续几次变化只需按最新版本布局
 ***************************************************************************/
-void BSTView::onTreeChanged() {
+void BSTView::onTreeChanged(const TreeChange& change) {
+    if (change.isEmpty()) {
+        return;
+    }
+
+    pinVersions();
     calculatePositions();
     update();
 }
@@ -687,7 +752,7 @@ bool BSTView::isConnectionHighlighted(int parentValue, int childValue) const {
   返 回 值：
   说    明：递归计算树的布局，避免节点重叠
 ***************************************************************************/
-void BSTView::calculateTreeLayout(TreeNode* node, int level, int& x, int& minX) {
+void BSTView::calculateTreeLayout(NodeHandle node, int level, int& x, int& minX) {
     if (!node) 
         return;
 
@@ -739,7 +804,7 @@ void BSTView::calculateTreeLayout(TreeNode* node, int level, int& x, int& minX)
   返 回 值：bool - 节点是否在子树中
   说    明：递归检查指定节点是否在给定子树中
 ***************************************************************************/
-bool BSTView::isNodeInSubtree(TreeNode* node, TreeNode* root) {
+bool BSTView::isNodeInSubtree(NodeHandle node, NodeHandle root) {
     if (!root) 
         return false;
 
@@ -757,7 +822,7 @@ bool BSTView::isNodeInSubtree(TreeNode* node, TreeNode* root) {
   返 回 值：
   说    明：递归移动子树中的所有节点
 ***************************************************************************/
-void BSTView::shiftSubtree(TreeNode* node, int shift) {
+void BSTView::shiftSubtree(NodeHandle node, int shift) {
     if (!node) 
         return;
 
@@ -777,7 +842,7 @@ void BSTView::shiftSubtree(TreeNode* node, int shift) {
   返 回 值：int - 子树宽度
   说    明：递归计算子树的宽度
 ***************************************************************************/
-int BSTView::calculateSubtreeWidth(TreeNode* node) {
+int BSTView::calculateSubtreeWidth(NodeHandle node) {
     if (!node) 
         return 0;
 
@@ -794,7 +859,7 @@ int BSTView::calculateSubtreeWidth(TreeNode* node) {
   返 回 值：
   说    明：调整子节点位置使其相对于父节点居中
 ***************************************************************************/
-void BSTView::centerChildNodes(TreeNode* node, int parentX) {
+void BSTView::centerChildNodes(NodeHandle node, int parentX) {
     if (!node) 
         return;
 
@@ -854,20 +919,20 @@ void BSTView::centerChildNodes(TreeNode* node, int parentX) {
   说    明：调整树布局使整体居中
 ***************************************************************************/
 void BSTView::adjustTreeLayout() {
-    if (!bst || !bst->getRoot()) 
+    if (!shownVersion || shownVersion->isEmpty()) 
         return;
 
     // 计算树的高度
-    int treeDepth = getTreeDepth(bst->getRoot());
+    int treeDepth = shownVersion->height;
 
     // 第一次遍历：计算初始位置
     int x = 0;
     int minX = INT_MAX;
     tempPositions.clear();
-    calculateTreeLayout(bst->getRoot(), 0, x, minX);
+    calculateTreeLayout(shownVersion->getRoot(), 0, x, minX);
 
     // 第二次遍历：居中子节点
-    centerChildNodes(bst->getRoot(), getNodePosition(bst->getRoot()).x());
+    centerChildNodes(shownVersion->getRoot(), getNodePosition(shownVersion->getRoot()).x());
 
     // 计算整体偏移，使树居中
     int minTreeX = INT_MAX;
@@ -905,7 +970,7 @@ void BSTView::adjustTreeLayout() {
   返 回 值：QPoint - 节点位置
   说    明：从临时位置列表中获取指定节点的位置
 ***************************************************************************/
-QPoint BSTView::getNodePosition(TreeNode* node) const {
+QPoint BSTView::getNodePosition(NodeHandle node) const {
     for (const auto& pair : tempPositions) {
         if (pair.first == node) {
             return pair.second;
@@ -921,7 +986,7 @@ QPoint BSTView::getNodePosition(TreeNode* node) const {
   返 回 值：
   说    明：设置指定节点的位置，如果节点不存在则添加新条目
 ***************************************************************************/
-void BSTView::setNodePosition(TreeNode* node, const QPoint& position) {
+void BSTView::setNodePosition(NodeHandle node, const QPoint& position) {
     for (auto& pair : tempPositions) {
         if (pair.first == node) {
             pair.second = position;
@@ -942,21 +1007,33 @@ void BSTView::setNodePosition(TreeNode* node, const QPoint& position) {
 void BSTView::calculateSymmetricLayout() {
     nodePositions.clear();
 
-    if (!bst || bst->isEmpty()) 
+    if (isViewEmpty()) 
         return;
 
     // 计算树的高度
-    int treeDepth = getTreeDepth(bst->getRoot());
+    int treeDepth = shownVersion ? shownVersion->height : 0;
 
     // 计算每个子树所需的宽度
-    int treeWidth = calculateSymmetricSubtreeWidth(bst->getRoot());
+    int treeWidth = shownVersion ? calculateSymmetricSubtreeWidth(shownVersion->getRoot()) : 0;
 
     // 定位根节点（居中）
     int rootX = 0;
     int rootY = 0;
 
     // 定位所有节点
-    positionSymmetricNode(bst->getRoot(), rootX, rootY, 0);
+    if (shownVersion) {
+        positionSymmetricNode(shownVersion->getRoot(), rootX, rootY, 0);
+    }
+
+    // 第二棵树放在主树右侧，两树之间留出两倍节点间距
+    if (secondVersion && !secondVersion->isEmpty()) {
+        int secondWidth = calculateSymmetricSubtreeWidth(secondVersion->getRoot());
+        secondRootX = rootX + (treeWidth + secondWidth) / 2 + nodeSpacing * 2;
+        positionSymmetricNode(secondVersion->getRoot(), secondRootX, rootY, 0);
+
+        treeDepth  = std::max(treeDepth, secondVersion->height);
+        treeWidth += secondWidth + nodeSpacing * 2;
+    }
 
     // 更新树的总宽度和高度
     this->treeWidth  = treeWidth;
@@ -970,7 +1047,7 @@ void BSTView::calculateSymmetricLayout() {
   返 回 值：int - 子树宽度
   说    明：递归计算对称布局中子树的宽度
 ***************************************************************************/
-int BSTView::calculateSymmetricSubtreeWidth(TreeNode* node) {
+int BSTView::calculateSymmetricSubtreeWidth(NodeHandle node) {
     if (!node) 
         return 0;
 
@@ -993,7 +1070,7 @@ int BSTView::calculateSymmetricSubtreeWidth(TreeNode* node) {
   返 回 值：
   说    明：使用对称布局算法递归定位节点及其子节点
 ***************************************************************************/
-void BSTView::positionSymmetricNode(TreeNode* node, int x, int y, int level) {
+void BSTView::positionSymmetricNode(NodeHandle node, int x, int y, int level) {
     if (!node) 
         return;
 
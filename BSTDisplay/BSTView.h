@@ -15,9 +15,10 @@ class BSTView : public QWidget {
     Q_OBJECT
 
 public:
-    explicit BSTView(QWidget* parent = nullptr); // 构造函数
-    void     setTree(BinarySearchTree* tree);    // 设置要显示的树
-    QSize    sizeHint() const override;          // 设置视图大小
+    explicit BSTView(QWidget* parent = nullptr);    // 构造函数
+    void     setTree(BinarySearchTree* tree);       // 设置要显示的树
+    void     setSecondTree(BinarySearchTree* tree); // 设置并排显示的第二棵树（拆分结果）
+    QSize    sizeHint() const override;             // 设置视图大小
 
     // 视图控制方法
     void zoomIn();    // 放大视图
@@ -29,7 +30,7 @@ public:
     void clearHighlight();              // 清除高亮
 
 public slots:
-    void onTreeChanged();                                            // 树变化响应
+    void onTreeChanged(const TreeChange& change);                    // 树变化响应
     void onAnimationStep(QString description, int highlightedValue); // 动画步骤响应
     void onHighlightNode(int value);                                 // 高亮节点响应
     void onClearHighlights();                                        // 清除高亮响应
@@ -42,7 +43,13 @@ protected:
     void wheelEvent(QWheelEvent* event) override;        // 滚轮事件
 
 private:
-    BinarySearchTree* bst; // 二叉搜索树指针
+    BinarySearchTree* bst;       // 二叉搜索树指针
+    BinarySearchTree* secondBst; // 并排显示在右侧的第二棵树，可以为空
+
+    // 布局和绘制只读取两棵树最新发布的版本，节点句柄指向版本中的节点，持有期间不会被回收
+    TreePublisher::ReadGuard shownVersion;  // 主树的已发布版本
+    TreePublisher::ReadGuard secondVersion; // 第二棵树的已发布版本，可以为空
+    void pinVersions();                     // 重新登记两棵树最新发布的版本
 
     // 缩放和滚动参数
     double zoomFactor; // 缩放因子
@@ -59,18 +66,17 @@ private:
 
     // 节点位置信息
     struct NodePosition {
-        TreeNode* node; // 节点指针
-        int x, y;       // 节点坐标
-        int size;       // 节点大小
+        NodeHandle node; // 节点句柄
+        int x, y;        // 节点坐标
+        int size;        // 节点大小
     };
 
     QList<NodePosition> nodePositions; // 节点位置列表
 
     // 布局计算相关方法
-    void calculatePositions();                                            // 计算节点位置
-    int  calculateSubtreeWidth(TreeNode* node, int level);                // 计算子树宽度
-    void positionNode(TreeNode* node, int x, int y, int level, int hGap); // 定位节点
-    int  getTreeDepth(TreeNode* node);                                    // 获取树深度
+    void calculatePositions();                                             // 计算节点位置
+    int  calculateSubtreeWidth(NodeHandle node, int level);                // 计算子树宽度
+    void positionNode(NodeHandle node, int x, int y, int level, int hGap); // 定位节点
 
     // 树的总宽度和高度
     int treeWidth;  // 树宽度
@@ -84,6 +90,9 @@ private:
 
     // 根节点位置
     int rootX, rootY; // 根节点坐标
+    int secondRootX;  // 第二棵树根节点的X坐标
+
+    bool isViewEmpty() const; // 两棵树是否都为空
 
     // 获取节点位置
     bool getNodePosition(int value, int& x, int& y, int& size); // 获取节点位置信息
@@ -98,8 +107,8 @@ private:
     void onHighlightPath(const QVector<int>& path);                      // 高亮路径响应
 
     // 布局算法辅助方法
-    bool isNodeInSubtree(TreeNode* node, TreeNode* root); // 检查节点是否在子树中
-    void shiftSubtree(TreeNode* node, int shift);         // 移动子树
+    bool isNodeInSubtree(NodeHandle node, NodeHandle root); // 检查节点是否在子树中
+    void shiftSubtree(NodeHandle node, int shift);          // 移动子树
 
     // 布局算法参数
     int levelSpacing;       // 层级间距
@@ -107,21 +116,21 @@ private:
     int nodeSpacing;        // 节点间最小间距
 
     // 布局算法辅助方法
-    void calculateTreeLayout(TreeNode* node, int level, int& x, int& minX); // 计算树布局
-    void adjustTreeLayout();                                                // 调整树布局
-    int  calculateSubtreeWidth(TreeNode* node);                             // 计算子树宽度
-    void centerChildNodes(TreeNode* node, int parentX);                     // 居中子节点
+    void calculateTreeLayout(NodeHandle node, int level, int& x, int& minX); // 计算树布局
+    void adjustTreeLayout();                                                 // 调整树布局
+    int  calculateSubtreeWidth(NodeHandle node);                             // 计算子树宽度
+    void centerChildNodes(NodeHandle node, int parentX);                     // 居中子节点
 
     // 对称布局方法
-    void calculateSymmetricLayout();                                     // 计算对称布局
-    int  calculateSymmetricSubtreeWidth(TreeNode* node);                 // 计算对称子树宽度
-    void positionSymmetricNode(TreeNode* node, int x, int y, int level); // 对称定位节点
+    void calculateSymmetricLayout();                                      // 计算对称布局
+    int  calculateSymmetricSubtreeWidth(NodeHandle node);                 // 计算对称子树宽度
+    void positionSymmetricNode(NodeHandle node, int x, int y, int level); // 对称定位节点
 
-    QVector<QPair<TreeNode*, QPoint>> tempPositions; // 临时位置存储
+    QVector<QPair<NodeHandle, QPoint>> tempPositions; // 临时位置存储
 
     // 节点位置辅助方法
-    QPoint getNodePosition(TreeNode* node) const;                   // 获取节点位置
-    void   setNodePosition(TreeNode* node, const QPoint& position); // 设置节点位置
+    QPoint getNodePosition(NodeHandle node) const;                   // 获取节点位置
+    void   setNodePosition(NodeHandle node, const QPoint& position); // 设置节点位置
 
     // 绘制方法
     void drawTree(QPainter* painter); // 绘制树
@@ -20,7 +20,18 @@
 #include <Qcoreapplication>
 #include <QGroupBox>
 #include <QStatusBar>
+#include <QComboBox>
+#include <QCheckBox>
+#include <QSpinBox>
+#include <QFileDialog>
+#include <QFile>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
 #include "BSTView.h"
+#include "ConcurrentTree.h"
+#include "ShardedTree.h"
 
 /***************************************************************************
   函数名称：BSTWindow::BSTWindow
@@ -29,7 +40,7 @@
   返 回 值：
   说    明：创建和布局所有UI组件，连接信号和槽
 ***************************************************************************/
-BSTWindow::BSTWindow(QWidget* parent) : QWidget(parent), bst(this) {
+BSTWindow::BSTWindow(QWidget* parent) : QWidget(parent), bst(this), splitTree(this) {
     /* 设置应用程序样式 - 使用深色科技主题*/
     setStyleSheet(R"(
         QWidget {
@@ -255,6 +266,20 @@ BSTWindow::BSTWindow(QWidget* parent) : QWidget(parent), bst(this) {
     deleteBtn  = new QPushButton(QString::fromUtf8("删除"));
     displayBtn = new QPushButton(QString::fromUtf8("显示"));
     clearBtn   = new QPushButton(QString::fromUtf8("清空"));
+    splitBtn   = new QPushButton(QString::fromUtf8("拆分"));
+    joinBtn    = new QPushButton(QString::fromUtf8("合并"));
+    undoBtn    = new QPushButton(QString::fromUtf8("撤销"));
+    redoBtn    = new QPushButton(QString::fromUtf8("重做"));
+    undoBtn->setShortcut(QKeySequence::Undo);
+    redoBtn->setShortcut(QKeySequence::Redo);
+    undoBtn->setEnabled(false);
+    redoBtn->setEnabled(false);
+    /* 撤销历史的内存上限，为0时不记录*/
+    historyBudgetSpin = new QSpinBox;
+    historyBudgetSpin->setRange(0, 256);
+    historyBudgetSpin->setValue(static_cast<int>(EditHistory::DefaultBudget / (1024 * 1024)));
+    historyBudgetSpin->setSuffix(" MB");
+    historyBudgetSpin->setToolTip(QString::fromUtf8("撤销历史的内存上限，超出时丢弃最早的记录"));
 
     /* 设置对象名称以便应用特定样式*/
     insertBtn->setObjectName("insertBtn");
@@ -266,12 +291,14 @@ BSTWindow::BSTWindow(QWidget* parent) : QWidget(parent), bst(this) {
     animateInsertBtn  = new QPushButton(QString::fromUtf8("动画插入"));
     animateDeleteBtn  = new QPushButton(QString::fromUtf8("动画删除"));
     animateBalanceBtn = new QPushButton(QString::fromUtf8("动画平衡"));
+    animateSelectBtn  = new QPushButton(QString::fromUtf8("动画第k小"));
 
     /* 设置动画按钮样式*/
     animateFindBtn   ->setObjectName("animateBtn");
     animateInsertBtn ->setObjectName("animateBtn");
     animateDeleteBtn ->setObjectName("animateBtn");
     animateBalanceBtn->setObjectName("animateBtn");
+    animateSelectBtn ->setObjectName("animateBtn");
 
     /* 音效控制*/
     soundToggleBtn = new QPushButton(QString::fromUtf8("🔇 关闭音效"));
@@ -294,6 +321,7 @@ BSTWindow::BSTWindow(QWidget* parent) : QWidget(parent), bst(this) {
     /* 树视图*/
     bstView = new BSTView;
     bstView->setTree(&bst);
+    bstView->setSecondTree(&splitTree);
 
     /* 树生成相关组件*/
     /* 随机数量输入框*/
@@ -304,12 +332,21 @@ BSTWindow::BSTWindow(QWidget* parent) : QWidget(parent), bst(this) {
     /* 随机生成按钮*/
     randomCountBtn = new QPushButton(QString::fromUtf8("随机生成"));
     randomCountBtn->setObjectName("randomBtn");
+    /* 并发生成按钮*/
+    concurrentBtn = new QPushButton(QString::fromUtf8("并发生成"));
+    concurrentBtn->setToolTip(QString::fromUtf8("多个线程同时插入、删除无锁并发树，结束后显示它的快照"));
+    /* 分片生成按钮*/
+    shardedBtn = new QPushButton(QString::fromUtf8("分片生成"));
+    shardedBtn->setToolTip(QString::fromUtf8("多个线程同时插入、删除按值域分片的树，重新分片后显示合并的视图"));
     /* 输入一组值*/
     valuesInput = new QLineEdit;
     valuesInput->setPlaceholderText(QString::fromUtf8("数字用空格分隔"));
     valuesInput->setMinimumWidth(120);
     /* 构建按钮*/
     buildTreeBtn = new QPushButton(QString::fromUtf8("构建"));
+    /* 导入按钮*/
+    importBtn = new QPushButton(QString::fromUtf8("导入"));
+    importBtn->setToolTip(QString::fromUtf8("从文本文件读入大量整数，多线程排序去重后一次性建成平衡树"));
 
     /* 视图控制按钮*/
     zoomInBtn    = new QPushButton(QString::fromUtf8("放大"));
@@ -317,6 +354,20 @@ BSTWindow::BSTWindow(QWidget* parent) : QWidget(parent), bst(this) {
     resetViewBtn = new QPushButton(QString::fromUtf8("重置"));
     balanceBtn   = new QPushButton(QString::fromUtf8("平衡"));
     balanceBtn->setObjectName("balanceBtn");
+    /* 自平衡策略选择框，顺序与 BalancePolicy 一致*/
+    policyCombo = new QComboBox;
+    policyCombo->addItem(QString::fromUtf8("不平衡"));
+    policyCombo->addItem(QString::fromUtf8("AVL树"));
+    policyCombo->addItem(QString::fromUtf8("红黑树"));
+    policyCombo->addItem(QString::fromUtf8("伸展树"));
+    policyCombo->addItem(QString::fromUtf8("替罪羊树"));
+    policyCombo->addItem(QString::fromUtf8("树堆"));
+    /* 多重集合模式复选框，勾选后重复插入的值累计重复次数*/
+    multisetCheck = new QCheckBox(QString::fromUtf8("多重集合"));
+    /* 版本控制，保存的版本与当前树共用节点*/
+    saveVersionBtn = new QPushButton(QString::fromUtf8("保存版本"));
+    versionCombo   = new QComboBox;
+    versionCombo->addItem(QString::fromUtf8("当前树"));
     randomBtn = new QPushButton(QString::fromUtf8("随机"));
     randomBtn->setObjectName("randomBtn");
 
@@ -350,6 +401,12 @@ BSTWindow::BSTWindow(QWidget* parent) : QWidget(parent), bst(this) {
     operationLayout->addWidget(deleteBtn);
     operationLayout->addWidget(displayBtn);
     operationLayout->addWidget(clearBtn);
+    operationLayout->addWidget(splitBtn);
+    operationLayout->addWidget(joinBtn);
+    operationLayout->addWidget(undoBtn);
+    operationLayout->addWidget(redoBtn);
+    operationLayout->addWidget(new QLabel(QString::fromUtf8("历史上限:")));
+    operationLayout->addWidget(historyBudgetSpin);
     operationLayout->setSpacing(4);
     operationLayout->setContentsMargins(8, 12, 8, 8);
     operationGroup ->setLayout(operationLayout);
@@ -361,6 +418,7 @@ BSTWindow::BSTWindow(QWidget* parent) : QWidget(parent), bst(this) {
     animationLayout->addWidget(animateInsertBtn);
     animationLayout->addWidget(animateDeleteBtn);
     animationLayout->addWidget(animateBalanceBtn);
+    animationLayout->addWidget(animateSelectBtn);
     animationLayout->addWidget(speedLabel);
     animationLayout->addWidget(animationSpeedSlider);
     animationLayout->addWidget(soundToggleBtn);
@@ -374,9 +432,12 @@ BSTWindow::BSTWindow(QWidget* parent) : QWidget(parent), bst(this) {
     treeGenLayout->addWidget(new QLabel(QString::fromUtf8("节点数:")));
     treeGenLayout->addWidget(countInput);
     treeGenLayout->addWidget(randomCountBtn);
+    treeGenLayout->addWidget(concurrentBtn);
+    treeGenLayout->addWidget(shardedBtn);
     treeGenLayout->addWidget(new QLabel(QString::fromUtf8("自定义:")));
     treeGenLayout->addWidget(valuesInput);
     treeGenLayout->addWidget(buildTreeBtn);
+    treeGenLayout->addWidget(importBtn);
     treeGenLayout->setSpacing(4);
     treeGenLayout->setContentsMargins(8, 12, 8, 8);
     treeGenGroup ->setLayout(treeGenLayout);
@@ -388,6 +449,11 @@ BSTWindow::BSTWindow(QWidget* parent) : QWidget(parent), bst(this) {
     viewLayout->addWidget(zoomOutBtn);
     viewLayout->addWidget(resetViewBtn);
     viewLayout->addWidget(balanceBtn);
+    viewLayout->addWidget(new QLabel(QString::fromUtf8("自平衡:")));
+    viewLayout->addWidget(policyCombo);
+    viewLayout->addWidget(multisetCheck);
+    viewLayout->addWidget(saveVersionBtn);
+    viewLayout->addWidget(versionCombo);
     viewLayout->addWidget(randomBtn);
     viewLayout->setSpacing(4);
     viewLayout->setContentsMargins(8, 12, 8, 8);
@@ -421,52 +487,56 @@ BSTWindow::BSTWindow(QWidget* parent) : QWidget(parent), bst(this) {
     connect(deleteBtn,      &QPushButton::clicked, this, &BSTWindow::deleteValue);
     connect(displayBtn,     &QPushButton::clicked, this, &BSTWindow::displayTree);
     connect(clearBtn,       &QPushButton::clicked, this, &BSTWindow::clearTree);
+    connect(splitBtn,       &QPushButton::clicked, this, &BSTWindow::splitAtValue);
+    connect(joinBtn,        &QPushButton::clicked, this, &BSTWindow::joinTrees);
+    connect(undoBtn,        &QPushButton::clicked, this, &BSTWindow::undoEdit);
+    connect(redoBtn,        &QPushButton::clicked, this, &BSTWindow::redoEdit);
     connect(randomBtn,      &QPushButton::clicked, this, &BSTWindow::generateRandomTree);
     connect(balanceBtn,     &QPushButton::clicked, this, &BSTWindow::balanceTree);
     connect(zoomInBtn,      &QPushButton::clicked, this, &BSTWindow::zoomIn);
     connect(zoomOutBtn,     &QPushButton::clicked, this, &BSTWindow::zoomOut);
     connect(resetViewBtn,   &QPushButton::clicked, this, &BSTWindow::resetView);
     connect(randomCountBtn, &QPushButton::clicked, this, &BSTWindow::generateRandomTreeWithCount);
+    connect(concurrentBtn,  &QPushButton::clicked, this, &BSTWindow::generateConcurrentTree);
+    connect(shardedBtn,     &QPushButton::clicked, this, &BSTWindow::generateShardedTree);
     connect(buildTreeBtn,   &QPushButton::clicked, this, &BSTWindow::buildTreeFromValues);
+    connect(importBtn,      &QPushButton::clicked, this, &BSTWindow::importTreeFromFile);
     connect(soundToggleBtn, &QPushButton::toggled, this, &BSTWindow::toggleSound);
+    connect(policyCombo,    &QComboBox::currentIndexChanged, this, &BSTWindow::changeBalancePolicy);
+    connect(multisetCheck,  &QCheckBox::toggled, this, &BSTWindow::toggleMultiset);
+    connect(saveVersionBtn, &QPushButton::clicked, this, &BSTWindow::saveVersion);
+    connect(versionCombo,   &QComboBox::currentIndexChanged, this, &BSTWindow::showVersion);
+    connect(historyBudgetSpin, &QSpinBox::valueChanged,      this, &BSTWindow::changeHistoryBudget);
 
     /* 动画控制连接*/
     connect(animateFindBtn,       &QPushButton::clicked,                this, &BSTWindow::animateFind);
     connect(animateInsertBtn,     &QPushButton::clicked,                this, &BSTWindow::animateInsert);
     connect(animateDeleteBtn,     &QPushButton::clicked,                this, &BSTWindow::animateDelete);
     connect(animateBalanceBtn,    &QPushButton::clicked,                this, &BSTWindow::animateBalance);
+    connect(animateSelectBtn,     &QPushButton::clicked,                this, &BSTWindow::animateSelect);
     connect(animationSpeedSlider, &QSlider::valueChanged,               this, &BSTWindow::updateAnimationSpeed);
     connect(&bst,                 &BinarySearchTree::animationFinished, this, &BSTWindow::onAnimationFinished);
     connect(bstView,              &BSTView::nodeHighlighted,            this, &BSTWindow::playTouchSound);
 
-    /* 更新状态栏*/
+    /* 更新状态栏，读取最新发布的版本*/
     connect(&bst, &BinarySearchTree::treeChanged, this, [this, statusBar]() {
-        QString status = QString::fromUtf8("节点数: %1 | 树高度: %2,可用鼠标进行移动和缩放")
-            .arg(countNodes(bst.getRoot()))
-            .arg(bst.getHeight());
+        TreePublisher::ReadGuard version = bst.acquireVersion();
+        QString status = QString::fromUtf8("节点数: %1 | 元素数: %2 | 树高度: %3,可用鼠标进行移动和缩放")
+            .arg(version->nodeCount)
+            .arg(version->totalCount)
+            .arg(version->height);
         statusBar->showMessage(status);
+        undoBtn->setEnabled(bst.canUndo());
+        redoBtn->setEnabled(bst.canRedo());
      });
 
     /* 初始状态*/
-    QString status = QString::fromUtf8("节点数: 0 | 树高度: 0,可用鼠标进行移动和缩放");
+    QString status = QString::fromUtf8("节点数: 0 | 元素数: 0 | 树高度: 0,可用鼠标进行移动和缩放");
     statusBar->showMessage(status);
 
     updateAnimationSpeed(2000);
 }
 
-/***************************************************************************
-  函数名称：BSTWindow::countNodes
-  功    能：辅助函数：计算节点数量
-  输入参数：
-  返 回 值：
-  说    明：
-***************************************************************************/
-int BSTWindow::countNodes(TreeNode* node) {
-    if (!node) 
-        return 0;
-    return 1 + countNodes(node->left) + countNodes(node->right);
-}
-
 /***************************************************************************
   函数名称：BSTWindow::insertValue
   功    能：插入值到二叉搜索树
@@ -509,7 +579,8 @@ void BSTWindow::findValue() {
     int depth = 0;
     if (bst.find(value, depth)) {
         infoArea->setText(QString::fromUtf8("值 ") + QString::number(value) +
-            QString::fromUtf8(" 在树中，深度为: ") + QString::number(depth));
+            QString::fromUtf8(" 在树中，深度为: ") + QString::number(depth) +
+            QString::fromUtf8("，是第 ") + QString::number(bst.rank(value) + 1) + QString::fromUtf8(" 小的值"));
         playTouchSound();  // 播放触摸音效
     }
     else {
@@ -557,11 +628,22 @@ void BSTWindow::deleteValue() {
   功    能：显示树的信息
   输入参数：
   返 回 值：
-  说    明：显示树的当前状态和高度信息
+  说    明：显示树的当前状态和高度信息，以及当前自平衡策略的旋转和重建统计
 ***************************************************************************/
 void BSTWindow::displayTree() {
+    BalanceStats stats = bst.getBalanceStats(bst.getBalancePolicy());
+    double rotationsPerOp = stats.operations > 0 ? double(stats.rotations) / stats.operations : 0.0;
+
     infoArea->setText(QString::fromUtf8("当前树: ") + bst.display() +
-        QString::fromUtf8("\n树高度: ") + QString::number(bst.getHeight()));
+        QString::fromUtf8("\n树高度: ") + QString::number(bst.getHeight()) +
+        QString::fromUtf8("\n自平衡: %1，操作 %2 次，旋转 %3 次，平均每次操作旋转 %4 次")
+            .arg(policyCombo->currentText())
+            .arg(stats.operations)
+            .arg(stats.rotations)
+            .arg(rotationsPerOp, 0, 'f', 2) +
+        QString::fromUtf8("\n局部重建 %1 次，共 %2 个节点")
+            .arg(stats.rebuilds)
+            .arg(stats.rebuiltNodes));
 }
 
 /***************************************************************************
@@ -579,6 +661,7 @@ void BSTWindow::clearTree() {
 
     // 使用 clear() 方法而不是赋值操作
     bst.clear();
+    splitTree.clear();
     infoArea->setText(QString::fromUtf8("树已清空"));
 }
 
@@ -587,12 +670,9 @@ void BSTWindow::clearTree() {
   功    能：生成随机二叉搜索树
   输入参数：
   返 回 值：
-  说    明：生成包含10个随机值的二叉搜索树，更新信息显示
+  说    明：生成包含10个随机值的二叉搜索树，一次性建成平衡树，更新信息显示
 ***************************************************************************/
 void BSTWindow::generateRandomTree() {
-    // 先清空现有树
-    bst.clear();
-
     // 生成10个随机数
     QTime time = QTime::currentTime();
     srand(time.msec() + time.second() * 1000);
@@ -601,12 +681,17 @@ void BSTWindow::generateRandomTree() {
     const int maxNum        = 100;
 
     QString values;
+    QVector<int> randomValues;
     for (int i = 0; i < randomNodeNum; i++) {
         int value = rand() % maxNum;
-        bst.insert(value);
+        randomValues.append(value);
         values += QString::number(value) + " ";
     }
 
+    // 整体替换树的内容，只触发一次重新布局
+    bst.assign(randomValues);
+
+    versionCombo->setCurrentIndex(0);
     bstView->setTree(&bst);
     infoArea->setText(QString::fromUtf8("生成的随机值: ") + values + QString::fromUtf8("\n当前树: ") + bst.display());
 }
@@ -628,6 +713,189 @@ void BSTWindow::balanceTree() {
     infoArea->setText(QString::fromUtf8("树已平衡\n当前树: ") + bst.display());
 }
 
+/***************************************************************************
+  函数名称：BSTWindow::changeBalancePolicy
+  功    能：切换自平衡策略
+  输入参数：index - 选择框中的序号，与 BalancePolicy 的顺序一致
+  返 回 值：
+  说    明：切换到自平衡策略时已有的树会先整体重建，随后更新信息显示
+***************************************************************************/
+void BSTWindow::changeBalancePolicy(int index) {
+    bst.setBalancePolicy(static_cast<BalancePolicy>(index));
+    infoArea->setText(QString::fromUtf8("自平衡策略: ") + policyCombo->currentText() +
+        QString::fromUtf8("\n当前树: ") + bst.display());
+}
+
+/***************************************************************************
+  函数名称：BSTWindow::toggleMultiset
+  功    能：切换多重集合模式
+  输入参数：enabled - 是否为多重集合
+  返 回 值：
+  说    明：拆分出的树一并切换；取消多重集合时重复的值只保留一份，随后更新信息显示
+***************************************************************************/
+void BSTWindow::toggleMultiset(bool enabled) {
+    bst.setMultiset(enabled);
+    splitTree.setMultiset(enabled);
+    undoBtn->setEnabled(bst.canUndo());
+    redoBtn->setEnabled(bst.canRedo());
+    infoArea->setText(QString::fromUtf8(enabled ? "已切换为多重集合，重复插入的值累计重复次数" : "已切换为集合，重复的值只保留一份") +
+        QString::fromUtf8("\n当前树: ") + bst.display());
+}
+
+/***************************************************************************
+  函数名称：BSTWindow::saveVersion
+  功    能：保存当前树的版本
+  输入参数：
+  返 回 值：
+  说    明：版本与当前树共用全部节点，保存本身不复制节点；
+            之后的插入、删除只复制查找路径，信息区显示存储中实际存活的节点数
+***************************************************************************/
+void BSTWindow::saveVersion() {
+    BinarySearchTree* version = new BinarySearchTree(this);
+    bst.saveVersion(*version);
+    versions.append(version);
+    versionCombo->addItem(QString::fromUtf8("版本 %1").arg(versions.size()));
+
+    playTouchSound();
+    infoArea->setText(QString::fromUtf8("已保存版本 %1（%2 个节点）\n各版本共用节点，存储中共有 %3 个节点")
+        .arg(versions.size())
+        .arg(version->getNodeCount())
+        .arg(bst.getNodePool().getLiveNodes()));
+}
+
+/***************************************************************************
+  函数名称：BSTWindow::showVersion
+  功    能：显示选中的版本
+  输入参数：index - 版本选择框中的序号，0 为当前树
+  返 回 值：
+  说    明：视图改为显示保存的版本；树操作仍作用于当前树，选回“当前树”即可看到
+***************************************************************************/
+void BSTWindow::showVersion(int index) {
+    if (index <= 0 || index > versions.size()) {
+        bstView->setTree(&bst);
+        infoArea->setText(QString::fromUtf8("当前树: ") + bst.display());
+        return;
+    }
+
+    BinarySearchTree* version = versions[index - 1];
+    bstView->setTree(version);
+    infoArea->setText(QString::fromUtf8("版本 %1（只供查看，树操作仍作用于当前树）: ").arg(index) + version->display());
+}
+
+/***************************************************************************
+  函数名称：BSTWindow::splitAtValue
+  功    能：按输入值拆分树
+  输入参数：
+  返 回 值：
+  说    明：不小于输入值的节点移到右侧的拆分树中，两棵树并排显示；
+            拆分前会切换为树堆策略，已有拆分树时先合并回来
+***************************************************************************/
+void BSTWindow::splitAtValue() {
+    bool ok;
+    int value = valueInput->text().toInt(&ok);
+
+    if (!ok) {
+        QMessageBox::warning(this, QString::fromUtf8("输入错误"), QString::fromUtf8("请输入有效的整数值"));
+        return;
+    }
+
+    // 合并、切换策略和拆分合起来只刷新一次视图
+    {
+        BinarySearchTree::BatchGuard leftBatch(bst);
+        BinarySearchTree::BatchGuard rightBatch(splitTree);
+
+        if (!splitTree.isEmpty()) {
+            bst.join(splitTree);
+        }
+
+        bst.split(value, splitTree);
+        policyCombo->setCurrentIndex(static_cast<int>(BalancePolicy::Treap));
+    }
+    playTouchSound();
+    infoArea->setText(QString::fromUtf8("已按 ") + QString::number(value) + QString::fromUtf8(" 拆分") +
+        QString::fromUtf8("\n左树: ") + bst.display() +
+        QString::fromUtf8("\n右树: ") + splitTree.display());
+    valueInput->clear();
+}
+
+/***************************************************************************
+  函数名称：BSTWindow::joinTrees
+  功    能：合并拆分出的树
+  输入参数：
+  返 回 值：
+  说    明：把右侧的拆分树整体接回主树，要求其值全部大于主树；
+            合并会把主树切换为树堆策略，策略下拉框随之同步
+***************************************************************************/
+void BSTWindow::joinTrees() {
+    if (splitTree.isEmpty()) {
+        QMessageBox::information(this, QString::fromUtf8("提示"), QString::fromUtf8("没有可以合并的树，请先拆分"));
+        return;
+    }
+
+    // 合并和同步策略合起来只刷新一次视图
+    {
+        BinarySearchTree::BatchGuard leftBatch(bst);
+        BinarySearchTree::BatchGuard rightBatch(splitTree);
+
+        if (!bst.join(splitTree)) {
+            QMessageBox::warning(this, QString::fromUtf8("合并失败"),
+                QString::fromUtf8("右树的值必须全部大于主树的值"));
+            return;
+        }
+        policyCombo->setCurrentIndex(static_cast<int>(BalancePolicy::Treap));
+    }
+
+    playSuccessSound();
+    infoArea->setText(QString::fromUtf8("已合并\n当前树: ") + bst.display());
+}
+
+/***************************************************************************
+  函数名称：BSTWindow::undoEdit
+  功    能：撤销最近一次修改
+  输入参数：
+  返 回 值：
+  说    明：执行记录的逆操作，耗时只与那次修改涉及的值数有关；拆分、合并后历史被清空
+***************************************************************************/
+void BSTWindow::undoEdit() {
+    if (!bst.undo()) {
+        infoArea->setText(QString::fromUtf8("没有可以撤销的修改"));
+        return;
+    }
+
+    playTouchSound();
+    infoArea->setText(QString::fromUtf8("已撤销（还可撤销 %1 步）\n当前树: ").arg(bst.getHistory().getUndoCount()) + bst.display());
+}
+
+/***************************************************************************
+  函数名称：BSTWindow::redoEdit
+  功    能：重做最近一次撤销的修改
+  输入参数：
+  返 回 值：
+  说    明：撤销后有新的修改时不能再重做
+***************************************************************************/
+void BSTWindow::redoEdit() {
+    if (!bst.redo()) {
+        infoArea->setText(QString::fromUtf8("没有可以重做的修改"));
+        return;
+    }
+
+    playTouchSound();
+    infoArea->setText(QString::fromUtf8("已重做（还可重做 %1 步）\n当前树: ").arg(bst.getHistory().getRedoCount()) + bst.display());
+}
+
+/***************************************************************************
+  函数名称：BSTWindow::changeHistoryBudget
+  功    能：修改撤销历史的内存上限
+  输入参数：mb - 内存上限（MB），为0时不再记录修改
+  返 回 值：
+  说    明：降低上限时立即丢弃最早的记录
+***************************************************************************/
+void BSTWindow::changeHistoryBudget(int mb) {
+    bst.setHistoryBudget(static_cast<qint64>(mb) * 1024 * 1024);
+    undoBtn->setEnabled(bst.canUndo());
+    redoBtn->setEnabled(bst.canRedo());
+}
+
 /***************************************************************************
   函数名称：BSTWindow::zoomIn
   功    能：放大树视图
@@ -767,6 +1035,30 @@ void BSTWindow::animateBalance() {
     infoArea->setText(QString::fromUtf8("开始平衡动画"));
 }
 
+/***************************************************************************
+  函数名称：BSTWindow::animateSelect
+  功    能：执行动画选择第k小操作
+  输入参数：
+  返 回 值：
+  说    明：从输入框获取名次k，动画展示按子树节点数逐层选择的过程
+***************************************************************************/
+void BSTWindow::animateSelect() {
+    bool ok;
+    int k = valueInput->text().toInt(&ok);
+
+    if (!ok || k < 1 || k > bst.getNodeCount()) {
+        QMessageBox::warning(this, QString::fromUtf8("输入错误"),
+            QString::fromUtf8("请输入1-%1之间的名次").arg(bst.getNodeCount()));
+        return;
+    }
+
+    // 禁用按钮，防止在动画过程中进行操作
+    setEnabled(false);
+
+    bst.startSelectAnimation(k);
+    infoArea->setText(QString::fromUtf8("开始选择动画: 第 ") + QString::number(k) + QString::fromUtf8(" 小"));
+}
+
 /***************************************************************************
   函数名称：BSTWindow::updateAnimationSpeed
   功    能：更新动画速度
@@ -798,7 +1090,7 @@ void BSTWindow::onAnimationFinished() {
   功    能：根据指定数量生成随机树
   输入参数：
   返 回 值：
-  说    明：从输入框获取数量并生成包含指定数量随机值的二叉搜索树
+  说    明：从输入框获取数量并生成包含指定数量随机值的二叉搜索树，一次性建成平衡树
 ***************************************************************************/
 void BSTWindow::generateRandomTreeWithCount() {
     // 获取输入的节点数量
@@ -812,36 +1104,211 @@ void BSTWindow::generateRandomTreeWithCount() {
         return;
     }
 
-    // 先清空现有树
-    bst.clear();
-
     // 生成随机数
     QTime time = QTime::currentTime();
     srand(time.msec() + time.second() * 1000);
 
     QString values;
     QSet<int> generatedValues;  // 使用集合确保值唯一
+    QVector<int> randomValues;
 
     while (generatedValues.size() < count) {
         int value = rand() % 100;  // 生成0-99的随机数
         if (!generatedValues.contains(value)) {
             generatedValues.insert(value);
-            bst.insert(value);
+            randomValues.append(value);
             values += QString::number(value) + " ";
         }
     }
 
+    bst.assign(randomValues);
+
+    versionCombo->setCurrentIndex(0);
     bstView->setTree(&bst);
     infoArea->setText(QString::fromUtf8("生成的随机值: ") + values +
         QString::fromUtf8("\n当前树: ") + bst.display());
 }
 
+/***************************************************************************
+  函数名称：BSTWindow::generateConcurrentTree
+  功    能：多个线程并发修改无锁树，结束后把它的快照显示出来
+  输入参数：
+  返 回 值：
+  说    明：每个线程在 0-99 中随机插入和删除，插入多于删除，树中的值数由节点数输入框给出上限；
+            线程全部结束后取一致快照，一次性建成平衡树交给视图显示
+***************************************************************************/
+void BSTWindow::generateConcurrentTree() {
+    bool ok;
+    int count = countInput->text().toInt(&ok);
+    const int maxNodes = 100; // 最大节点数限制
+
+    if (!ok || count <= 0 || count > maxNodes) {
+        QMessageBox::warning(this, QString::fromUtf8("输入错误"),
+            QString::fromUtf8("请输入1-100之间的有效整数"));
+        return;
+    }
+
+    const int threadCount = 4; // 并发修改的线程数
+
+    ConcurrentTree tree;
+    std::atomic<int> size(0);
+    unsigned seed = static_cast<unsigned>(QTime::currentTime().msecsSinceStartOfDay());
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&tree, &size, count, seed, t]() {
+            std::mt19937 generator(seed + t);
+            for (int i = 0; i < count * 4 && size.load() < count; i++) {
+                int value = static_cast<int>(generator() % 100);
+                if (generator() % 4 != 0) {
+                    // 先占一个名额再插入，树中的值数不会超过上限
+                    if (size.fetch_add(1) >= count || !tree.insert(value)) {
+                        size.fetch_sub(1);
+                    }
+                }
+                else if (tree.remove(value)) {
+                    size.fetch_sub(1);
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    QVector<int> values;
+    tree.snapshot(values);
+    bst.assign(values);
+
+    QString text;
+    for (int value : values) {
+        text += QString::number(value) + " ";
+    }
+
+    versionCombo->setCurrentIndex(0);
+    bstView->setTree(&bst);
+    infoArea->setText(QString::fromUtf8("%1 个线程并发生成的值: ").arg(threadCount) + text +
+        QString::fromUtf8("\n当前树: ") + bst.display());
+}
+
+/***************************************************************************
+  函数名称：BSTWindow::generateShardedTree
+  功    能：多个线程并发修改分片树，结束后显示合并的视图
+  输入参数：
+  返 回 值：
+  说    明：0-99 均分为4个分片，各线程随机写入；线程全部结束后按写入分布重新分片，
+            信息区列出各分片的值域和内容，视图显示跨分片中序合并成的平衡树
+***************************************************************************/
+void BSTWindow::generateShardedTree() {
+    bool ok;
+    int count = countInput->text().toInt(&ok);
+    const int maxNodes = 100; // 最大节点数限制
+
+    if (!ok || count <= 0 || count > maxNodes) {
+        QMessageBox::warning(this, QString::fromUtf8("输入错误"),
+            QString::fromUtf8("请输入1-100之间的有效整数"));
+        return;
+    }
+
+    const int threadCount = 4; // 并发修改的线程数
+
+    ShardedTree tree(threadCount, 0, 99);
+    std::atomic<int> size(0);
+    unsigned seed = static_cast<unsigned>(QTime::currentTime().msecsSinceStartOfDay());
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&tree, &size, count, seed, t]() {
+            std::mt19937 generator(seed + t);
+            for (int i = 0; i < count * 4 && size.load() < count; i++) {
+                int value = static_cast<int>(generator() % 100);
+                if (generator() % 4 != 0) {
+                    // 先占一个名额再插入，树中的值数不会超过上限
+                    if (size.fetch_add(1) >= count || !tree.insert(value)) {
+                        size.fetch_sub(1);
+                    }
+                }
+                else if (tree.remove(value)) {
+                    size.fetch_sub(1);
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    int changes = tree.rebalance();
+
+    QString shardText;
+    for (const ShardInfo& info : tree.getShardInfo()) {
+        shardText += QString::fromUtf8("[%1, %2] %3 个值\n")
+            .arg(info.lowValue == std::numeric_limits<int>::min() ? QString::fromUtf8("-∞") : QString::number(info.lowValue))
+            .arg(info.highValue == std::numeric_limits<int>::max() ? QString::fromUtf8("+∞") : QString::number(info.highValue))
+            .arg(info.size);
+    }
+
+    tree.exportTo(bst);
+
+    versionCombo->setCurrentIndex(0);
+    bstView->setTree(&bst);
+    infoArea->setText(QString::fromUtf8("%1 个线程并发写入，重新分片 %2 次，现有 %3 个分片:\n")
+        .arg(threadCount).arg(changes).arg(tree.getShardCount()) + shardText +
+        QString::fromUtf8("各分片内容: ") + tree.display() +
+        QString::fromUtf8("\n当前树: ") + bst.display());
+}
+
+/***************************************************************************
+  函数名称：BSTWindow::importTreeFromFile
+  功    能：从文件中的大量整数批量建树
+  输入参数：
+  返 回 值：
+  说    明：文件内容为以空白、逗号或分号分隔的整数，可以无序、重复；
+            经 bulkLoad 多线程解析、排序、去重后一次性建树，信息区给出各阶段的耗时；
+            节点很多时只显示节点数，不列出全部的值
+***************************************************************************/
+void BSTWindow::importTreeFromFile() {
+    QString fileName = QFileDialog::getOpenFileName(this, QString::fromUtf8("导入整数"), QString(),
+        QString::fromUtf8("文本文件 (*.txt *.csv);;所有文件 (*)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        QMessageBox::warning(this, QString::fromUtf8("导入错误"),
+            QString::fromUtf8("无法打开文件: ") + fileName);
+        return;
+    }
+    QByteArray text = file.readAll();
+    file.close();
+
+    BulkBuildTimings timings;
+    if (!bst.bulkLoad(text, &timings)) {
+        QMessageBox::warning(this, QString::fromUtf8("导入错误"),
+            QString::fromUtf8("文件中含有无效的整数"));
+        return;
+    }
+
+    const int maxListed = 1000; // 超过这个节点数时不列出树的内容
+
+    versionCombo->setCurrentIndex(0);
+    bstView->setTree(&bst);
+    infoArea->setText(QString::fromUtf8("%1 个线程导入 %2 个值，建成 %3 个节点\n")
+        .arg(timings.threads).arg(timings.inputCount).arg(timings.nodeCount) +
+        QString::fromUtf8("解析 %1 ms，排序 %2 ms，去重 %3 ms，建树 %4 ms，共 %5 ms")
+        .arg(timings.parseNs / 1e6, 0, 'f', 2).arg(timings.sortNs / 1e6, 0, 'f', 2)
+        .arg(timings.dedupNs / 1e6, 0, 'f', 2).arg(timings.buildNs / 1e6, 0, 'f', 2)
+        .arg(timings.getTotalNs() / 1e6, 0, 'f', 2) +
+        (timings.nodeCount <= maxListed ? QString::fromUtf8("\n当前树: ") + bst.display() : QString()));
+}
+
 /***************************************************************************
   函数名称：BSTWindow::buildTreeFromValues
   功    能：根据自定义值构建树
   输入参数：
   返 回 值：
-  说    明：从输入框获取自定义值并构建二叉搜索树
+  说    明：从输入框获取自定义值，排序去重后一次性构建平衡的二叉搜索树
 ***************************************************************************/
 void BSTWindow::buildTreeFromValues() {
     // 获取输入的值
@@ -869,16 +1336,14 @@ void BSTWindow::buildTreeFromValues() {
         }
     }
 
-    // 先清空现有树
-    bst.clear();
-
-    // 插入所有值
+    // 整体替换树的内容，重复的值只保留一个
     QString insertedValues;
     for (int value : values) {
-        bst.insert(value);
         insertedValues += QString::number(value) + " ";
     }
+    bst.assign(values);
 
+    versionCombo->setCurrentIndex(0);
     bstView->setTree(&bst);
     infoArea->setText(QString::fromUtf8("插入的值: ") + insertedValues +
         QString::fromUtf8("\n当前树: ") + bst.display());
@@ -17,6 +17,9 @@ class QLineEdit;
 class QTextEdit;
 class QPushButton;
 class QSlider;
+class QComboBox;
+class QCheckBox;
+class QSpinBox;
 class BSTView;
 
 class BSTWindow : public QWidget {
@@ -24,6 +27,7 @@ class BSTWindow : public QWidget {
 
 private:
     BinarySearchTree bst;           // 二叉搜索树实例
+    BinarySearchTree splitTree;     // 拆分出的右半棵树
 
     //视图组件
     QLineEdit*   valueInput;        // 值输入框
@@ -36,23 +40,38 @@ private:
     QPushButton* deleteBtn;         // 删除按钮
     QPushButton* displayBtn;        // 显示按钮
     QPushButton* clearBtn;          // 清空按钮
+    QPushButton* splitBtn;          // 拆分按钮
+    QPushButton* joinBtn;           // 合并按钮
+    QPushButton* undoBtn;           // 撤销按钮
+    QPushButton* redoBtn;           // 重做按钮
+    QSpinBox*    historyBudgetSpin; // 撤销历史内存上限（MB）输入框
     QPushButton* randomBtn;         // 随机生成按钮
     QPushButton* balanceBtn;        // 平衡按钮
     QPushButton* zoomInBtn;         // 放大按钮
     QPushButton* zoomOutBtn;        // 缩小按钮
     QPushButton* resetViewBtn;      // 重置视图按钮
+    QComboBox*   policyCombo;       // 自平衡策略选择框
+    QCheckBox*   multisetCheck;     // 多重集合模式复选框
+    QPushButton* saveVersionBtn;    // 保存版本按钮
+    QComboBox*   versionCombo;      // 显示的版本选择框（0 为当前树）
+
+    QVector<BinarySearchTree*> versions; // 保存的版本，与当前树共用节点
 
     // 动画控制按钮
     QPushButton* animateFindBtn;        // 动画查找按钮
     QPushButton* animateInsertBtn;      // 动画插入按钮
     QPushButton* animateDeleteBtn;      // 动画删除按钮
     QPushButton* animateBalanceBtn;     // 动画平衡按钮
+    QPushButton* animateSelectBtn;      // 动画选择第k小按钮
     QSlider*     animationSpeedSlider;  // 动画速度滑块
 
     QLineEdit*   countInput;        // 随机节点数量输入框
     QPushButton* randomCountBtn;    // 根据数量生成随机树按钮
+    QPushButton* concurrentBtn;     // 多线程并发生成按钮
+    QPushButton* shardedBtn;        // 分片并发生成按钮
     QLineEdit*   valuesInput;       // 自定义值输入框
     QPushButton* buildTreeBtn;      // 构建树按钮
+    QPushButton* importBtn;         // 从文件批量建树按钮
 
     // 音效控制
     QMediaPlayer* backgroundMusic;  // 背景音乐播放器
@@ -73,13 +92,22 @@ public:
 
 private slots:
     // 树操作相关方法
-    void insertValue();        // 插入值
-    void findValue();          // 查找值
-    void deleteValue();        // 删除值
-    void displayTree();        // 显示树信息
-    void clearTree();          // 清空树
-    void generateRandomTree(); // 生成随机树
-    void balanceTree();        // 平衡树
+    void insertValue();                  // 插入值
+    void findValue();                    // 查找值
+    void deleteValue();                  // 删除值
+    void displayTree();                  // 显示树信息
+    void clearTree();                    // 清空树
+    void generateRandomTree();           // 生成随机树
+    void balanceTree();                  // 平衡树
+    void changeBalancePolicy(int index); // 切换自平衡策略
+    void toggleMultiset(bool enabled);   // 切换多重集合模式
+    void saveVersion();                  // 保存当前树的版本
+    void showVersion(int index);         // 显示选中的版本
+    void splitAtValue();                 // 按输入值拆分树
+    void joinTrees();                    // 合并拆分出的树
+    void undoEdit();                     // 撤销最近一次修改
+    void redoEdit();                     // 重做最近一次撤销的修改
+    void changeHistoryBudget(int mb);    // 修改撤销历史的内存上限
 
     // 视图控制相关方法
     void zoomIn();      // 放大视图
@@ -91,14 +119,16 @@ private slots:
     void animateInsert();                 // 动画插入
     void animateDelete();                 // 动画删除
     void animateBalance();                // 动画平衡
+    void animateSelect();                 // 动画选择第k小
     void updateAnimationSpeed(int speed); // 更新动画速度
     void onAnimationFinished();           // 动画完成处理
 
     // 树生成相关方法
     void generateRandomTreeWithCount(); // 根据数量生成随机树
+    void generateConcurrentTree();      // 多个线程并发修改无锁树后显示其快照
+    void generateShardedTree();         // 多个线程并发修改分片树后显示合并的视图
     void buildTreeFromValues();         // 根据自定义值构建树
-
-    int  countNodes(TreeNode* node);    //辅助函数,计算节点数目
+    void importTreeFromFile();          // 从文件中的大量整数批量建树
 
 };
 
@@ -6,8 +6,30 @@
 
 #include "BinarySearchTree.h"
 #include <algorithm>
-#include <queue>
+#include <limits>
+#include <thread>
 #include <QDebug>
+#include <QElapsedTimer>
+#include "ParallelSort.h"
+
+/***************************************************************************
+  函数名称：makeChange
+  功    能：生成一次树变化的摘要
+  输入参数：inserted - 新增节点数，removed - 删除节点数，lowValue, highValue - 涉及的值域，
+            restructured - 是否整体调整了树的形状
+  返 回 值：TreeChange - 变化摘要，计为一次修改
+  说    明：
+***************************************************************************/
+static TreeChange makeChange(int inserted, int removed, int lowValue, int highValue, bool restructured) {
+    TreeChange change;
+    change.operations   = 1;
+    change.inserted     = inserted;
+    change.removed      = removed;
+    change.lowValue     = lowValue;
+    change.highValue    = highValue;
+    change.restructured = restructured;
+    return change;
+}
 
 /***************************************************************************
   函数名称：BinarySearchTree::BinarySearchTree
@@ -16,10 +38,14 @@
   返 回 值：
   说    明：初始化根节点为空，设置动画速度，连接定时器信号与槽
 ***************************************************************************/
-BinarySearchTree::BinarySearchTree(QObject* parent) : 
-    QObject(parent)      , root(nullptr),
+BinarySearchTree::BinarySearchTree(QObject* parent) :
+    QObject(parent)      ,
+    balanceThreads(std::max(1, static_cast<int>(std::thread::hardware_concurrency()))),
     animationSpeed(1000) , isAnimationRunning(false),
-    pendingInsertValue(0), pendingDeleteValue(0)
+    pendingAction(PendingAction::None), pendingValue(0),
+    snapshotValid(false) , learnedValid(false),
+    learnedInsertions(0) , publishing(false),
+    batchDepth(0)        , replaying(false)
 {
     animationTimer = new QTimer(this);
     connect(animationTimer, &QTimer::timeout, this, &BinarySearchTree::processNextAnimationStep);
@@ -30,10 +56,9 @@ BinarySearchTree::BinarySearchTree(QObject* parent) :
   功    能：析构函数，清理树节点和停止动画
   输入参数：
   返 回 值：
-  说    明：递归删除所有节点，停止动画定时器
+  说    明：节点由 SearchTree 随对象一起释放，这里只需停止动画定时器
 ***************************************************************************/
 BinarySearchTree::~BinarySearchTree() {
-    clearTree(root); //删除二叉树数据
     stopAnimation();
 }
 
@@ -42,12 +67,145 @@ BinarySearchTree::~BinarySearchTree() {
   功    能：清空树中的所有节点
   输入参数：
   返 回 值：
-  说    明：删除所有节点并将根节点设为空，发出树变化信号
+  说    明：清空后发出树变化信号
 ***************************************************************************/
 void BinarySearchTree::clear() {
-    clearTree(root);
-    root = nullptr;
-    emit treeChanged(); //发送树改变信号
+    if (isRecording() && !core.isEmpty()) {
+        EditHistory::Record record;
+        record.kind    = EditHistory::Record::Kind::Replace;
+        record.removed = EditHistory::packValues(collectValues(std::numeric_limits<int>::min(), std::numeric_limits<int>::max()));
+        history.push(record);
+    }
+
+    int removed = core.getNodeCount();
+    core.clear();
+    notifyChanged(makeChange(0, removed, std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), true)); //发送树改变信号
+}
+
+/***************************************************************************
+  函数名称：BinarySearchTree::assign
+  功    能：用一组值整体替换树的内容
+  输入参数：values - 新的节点值（可以无序、重复）
+  返 回 值：
+  说    明：排序去重后 O(n) 建成完全平衡的树（树堆策略下按优先级链接），只发出一次树变化信号；
+            撤销历史中记为一次整体替换
+***************************************************************************/
+void BinarySearchTree::assign(const QVector<int>& values) {
+    EditHistory::Record record;
+    bool recording = isRecording();
+    if (recording) {
+        record.kind    = EditHistory::Record::Kind::Replace;
+        record.removed = EditHistory::packValues(collectValues(std::numeric_limits<int>::min(), std::numeric_limits<int>::max()));
+    }
+
+    int removed = core.getNodeCount();
+    core.assign(values);
+    if (recording) {
+        record.added = EditHistory::packValues(collectValues(std::numeric_limits<int>::min(), std::numeric_limits<int>::max()));
+        history.push(record);
+    }
+    notifyChanged(makeChange(core.getNodeCount(), removed, std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), true));
+}
+
+/***************************************************************************
+  函数名称：BinarySearchTree::bulkLoad
+  功    能：从文本批量建树
+  输入参数：text - 以空白、逗号或分号分隔的整数，timings - 不为空时用于返回各阶段的耗时
+  返 回 值：bool - 文本中有无效内容时返回false，树不变、不发信号
+  说    明：多线程解析后交给 bulkBuild
+***************************************************************************/
+bool BinarySearchTree::bulkLoad(const QByteArray& text, BulkBuildTimings* timings) {
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<int> values;
+    if (!ParallelSort::parseValues(text, values, balanceThreads)) {
+        return false;
+    }
+    qint64 parseNs = timer.nsecsElapsed();
+
+    bulkBuild(std::move(values), timings);
+    if (timings != nullptr) {
+        timings->parseNs = parseNs;
+    }
+    return true;
+}
+
+/***************************************************************************
+  函数名称：BinarySearchTree::bulkBuild
+  功    能：从无序的值批量建树
+  输入参数：values - 新的节点值（可以无序、重复），timings - 不为空时用于返回各阶段的耗时
+  返 回 值：
+  说    明：用 getBalanceThreads() 个线程依次基数排序、去重（多重集合模式下保留重复次数）、
+            分配节点并链接成完全二叉树，结果与 assign 后再 balance 的形状相同；
+            逐个插入 n 个值要 O(n log n) 次随机访问，这里各阶段都是顺序访问；
+            只发出一次树变化信号；撤销历史中记为一次整体替换
+***************************************************************************/
+void BinarySearchTree::bulkBuild(QVector<int> values, BulkBuildTimings* timings) {
+    EditHistory::Record record;
+    bool recording = isRecording();
+    if (recording) {
+        record.kind    = EditHistory::Record::Kind::Replace;
+        record.removed = EditHistory::packValues(collectValues(std::numeric_limits<int>::min(), std::numeric_limits<int>::max()));
+    }
+
+    BulkBuildTimings phases;
+    phases.inputCount = values.size();
+    phases.threads    = balanceThreads;
+
+    QElapsedTimer timer;
+    timer.start();
+    ParallelSort::radixSort(values, balanceThreads);
+    phases.sortNs = timer.nsecsElapsed();
+
+    timer.restart();
+    QVector<int> unique, counts;
+    ParallelSort::uniqueSorted(values, unique, core.isMultiset() ? &counts : nullptr, balanceThreads);
+    phases.dedupNs = timer.nsecsElapsed();
+
+    timer.restart();
+    int removed = core.getNodeCount();
+    core.assignSorted(unique, core.isMultiset() ? &counts : nullptr, balanceThreads);
+    phases.buildNs   = timer.nsecsElapsed();
+    phases.nodeCount = core.getNodeCount();
+
+    if (recording) {
+        record.added = EditHistory::packValues(core.isMultiset() ? values : unique);
+        history.push(record);
+    }
+    if (timings != nullptr) {
+        *timings = phases;
+    }
+    notifyChanged(makeChange(core.getNodeCount(), removed, std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), true));
+}
+
+/***************************************************************************
+  函数名称：BinarySearchTree::copyFrom
+  功    能：整体复制另一棵树
+  输入参数：other - 被复制的树
+  返 回 值：
+  说    明：节点以下标链接且可平凡复制，复制内存池即完成整棵树的复制；
+            自平衡策略一并复制，保证树的性质与策略一致，发出树变化信号；撤销历史中记为一次整体替换
+***************************************************************************/
+void BinarySearchTree::copyFrom(const BinarySearchTree& other) {
+    if (&other == this) {
+        return;
+    }
+
+    EditHistory::Record record;
+    bool recording = isRecording();
+    if (recording) {
+        record.kind    = EditHistory::Record::Kind::Replace;
+        record.removed = EditHistory::packValues(collectValues(std::numeric_limits<int>::min(), std::numeric_limits<int>::max()));
+    }
+
+    int removed = core.getNodeCount();
+    core.copyFrom(other.core);
+    if (recording) {
+        record.added = EditHistory::packValues(collectValues(std::numeric_limits<int>::min(), std::numeric_limits<int>::max()));
+        history.push(record);
+    }
+    notifyChanged(makeChange(core.getNodeCount(), removed, std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), true));
 }
 
 /***************************************************************************
@@ -55,18 +213,17 @@ void BinarySearchTree::clear() {
   功    能：插入新节点到二叉搜索树中
   输入参数：value - 要插入的值
   返 回 值：
-  说    明：如果树为空则创建根节点，否则递归插入，更新节点深度并发出树变化信号
+  说    明：迭代插入节点并发出树变化信号，只访问查找路径上的节点；插入成功时记入撤销历史
 ***************************************************************************/
 void BinarySearchTree::insert(int value) {
-    if (root == nullptr) {
-        root = new TreeNode(value, 1);
+    bool inserted = core.insert(value);
+    if (inserted && isRecording()) {
+        EditHistory::Record record;
+        record.kind = EditHistory::Record::Kind::Insert;
+        record.low  = value;
+        history.push(record);
     }
-    else {
-        root = insertNode(root, value, 1);
-    }
-
-    updateDepths(root, 1); //更新所有节点的高度
-    emit treeChanged();
+    notifyChanged(makeChange(inserted ? 1 : 0, 0, value, value, false));
 }
 
 /***************************************************************************
@@ -74,11 +231,28 @@ void BinarySearchTree::insert(int value) {
   功    能：在二叉搜索树中查找指定值
   输入参数：value - 要查找的值，depth - 用于返回节点深度
   返 回 值：bool - 是否找到节点
-  说    明：递归查找节点，如果找到则设置深度并返回true
+  说    明：迭代查找节点，不记录路径，整个过程不申请内存；深度即查找经过的层数；
+            伸展树策略下把访问到的节点伸展到根，深度为伸展前的层数，并发出树变化信号
 ***************************************************************************/
 bool BinarySearchTree::find(int value, int& depth) {
-    QVector<int> path;
-    return findNode(root, value, depth, path);
+    bool splayed = core.getBalancePolicy() == BalancePolicy::Splay && !core.isEmpty();
+    bool found   = core.find(value, depth);
+    if (splayed) {
+        notifyChanged(makeChange(0, 0, value, value, true));
+    }
+    return found;
+}
+
+/***************************************************************************
+  函数名称：BinarySearchTree::findMany
+  功    能：批量查找一组值
+  输入参数：keys - 要查找的值，depths - 用于返回每个值的深度
+  返 回 值：int - 找到的值的个数
+  说    明：交错推进多路查找，depths[i] 与 find 的深度相同，未找到为0；
+            只读，伸展树策略下也不伸展
+***************************************************************************/
+int BinarySearchTree::findMany(const QVector<int>& keys, QVector<int>& depths) const {
+    return core.findMany(keys, depths);
 }
 
 /***************************************************************************
@@ -86,12 +260,18 @@ bool BinarySearchTree::find(int value, int& depth) {
   功    能：从二叉搜索树中删除指定值的节点
   输入参数：value - 要删除的值
   返 回 值：
-  说    明：递归删除节点，更新节点深度并发出树变化信号
+  说    明：迭代删除节点并发出树变化信号，节点深度在遍历时才计算，删除后无需刷新；
+            删除成功时记入撤销历史
 ***************************************************************************/
 void BinarySearchTree::remove(int value) {
-    root = deleteNode(root, value);
-    updateDepths(root, 1);
-    emit treeChanged();
+    bool removed = core.remove(value);
+    if (removed && isRecording()) {
+        EditHistory::Record record;
+        record.kind = EditHistory::Record::Kind::Remove;
+        record.low  = value;
+        history.push(record);
+    }
+    notifyChanged(makeChange(0, removed ? 1 : 0, value, value, false));
 }
 
 /***************************************************************************
@@ -102,8 +282,7 @@ void BinarySearchTree::remove(int value) {
   说    明：返回中序遍历结果，包含节点值和深度，如果树为空则返回相应提示
 ***************************************************************************/
 QString BinarySearchTree::display() {
-    QString result;
-    inOrderTraversal(root, result); //中序遍历
+    QString result = core.toString(); //中序遍历
     if (result.isEmpty()) {
         return QString::fromUtf8("树为空");
     }
@@ -117,8 +296,8 @@ QString BinarySearchTree::display() {
   返 回 值：bool - 树是否为空
   说    明：如果根节点为空则返回true
 ***************************************************************************/
-bool BinarySearchTree::isEmpty() {
-    return root == nullptr;
+bool BinarySearchTree::isEmpty() const {
+    return core.isEmpty();
 }
 
 /***************************************************************************
@@ -126,237 +305,645 @@ bool BinarySearchTree::isEmpty() {
   功    能：获取二叉搜索树的高度
   输入参数：
   返 回 值：int - 树的高度
-  说    明：递归计算树的最大深度
+  说    明：每个节点保存子树高度并随修改维护，树高即根节点的子树高度，O(1)
+***************************************************************************/
+int BinarySearchTree::getHeight() const {
+    return core.getHeight();
+}
+
+/***************************************************************************
+  函数名称：BinarySearchTree::freezeSnapshot
+  功    能：把当前内容冻结为只读快照
+  输入参数：
+  返 回 值：
+  说    明：O(n) 建成 Eytzinger 数组，之后 contains 和 lowerBound 走快照；
+            树的内容再变化时快照自动作废，需要时重新冻结
 ***************************************************************************/
-int BinarySearchTree::getHeight() {
-    return calculateHeight(root); 
+void BinarySearchTree::freezeSnapshot() {
+    snapshot.build(core.getNodePool(), core.getRootIndex(), core.getNodeCount());
+    snapshotValid = true;
 }
 
 /***************************************************************************
-  函数名称：BinarySearchTree::insertNode
-  功    能：递归插入节点到二叉搜索树中
-  输入参数：node - 当前节点指针，value - 要插入的值，depth - 当前深度
-  返 回 值：TreeNode* - 插入后的节点指针
-  说    明：根据值大小递归插入到左子树或右子树，如果值已存在则不插入
+  函数名称：BinarySearchTree::contains
+  功    能：检查值是否在树中
+  输入参数：value - 要查找的值
+  返 回 值：bool - 是否存在
+  说    明：有有效快照时在快照中无分支查找；其次查学习型索引，之后插入过节点且没查到时再沿树查找；
+            沿树查找时伸展树策略下也不伸展
 ***************************************************************************/
-TreeNode* BinarySearchTree::insertNode(TreeNode* node, int value, int depth) {
-    if (node == nullptr) {
-        return new TreeNode(value, depth);
+bool BinarySearchTree::contains(int value) const {
+    if (snapshotValid) {
+        return snapshot.contains(value);
     }
+    if (learnedValid) {
+        if (learnedIndex.contains(value)) {
+            return true;
+        }
+        if (learnedInsertions == 0) {
+            return false;
+        }
+    }
+
+    return core.contains(value);
+}
 
-    if (value < node->value) {
-        node->left = insertNode(node->left, value, depth + 1);
+/***************************************************************************
+  函数名称：BinarySearchTree::lowerBound
+  功    能：查找不小于 value 的最小值
+  输入参数：value - 要查找的值，result - 用于返回找到的值
+  返 回 值：bool - 是否存在这样的值
+  说    明：有有效快照或与树一致的学习型索引时在其中查找；否则沿树下降
+***************************************************************************/
+bool BinarySearchTree::lowerBound(int value, int& result) const {
+    if (snapshotValid) {
+        return snapshot.lowerBound(value, result);
     }
-    else if (value > node->value) {
-        node->right = insertNode(node->right, value, depth + 1);
+    if (learnedExact()) {
+        return learnedIndex.valueAt(learnedIndex.lowerBound(value), result);
     }
-    else {
-        return node;        // 值已存在，不插入
+
+    return core.lowerBound(value, result);
+}
+
+/***************************************************************************
+  函数名称：BinarySearchTree::freezeLearnedIndex
+  功    能：用当前内容训练学习型索引
+  输入参数：
+  返 回 值：
+  说    明：O(n) 重新训练；之后的插入不影响已有的值，索引继续可用，删除后需要重新训练
+***************************************************************************/
+void BinarySearchTree::freezeLearnedIndex() {
+    learnedIndex.build(core.getNodePool(), core.getRootIndex(), core.getNodeCount());
+    learnedValid      = true;
+    learnedInsertions = 0;
+}
+
+/***************************************************************************
+  函数名称：BinarySearchTree::countRange
+  功    能：统计 [low, high] 内的元素数
+  输入参数：low, high - 范围（包含两端）
+  返 回 值：int - 元素数（多重集合计入重复次数）
+  说    明：等于不大于 high 的个数减去小于 low 的个数，两者都由 rank 得出
+***************************************************************************/
+int BinarySearchTree::countRange(int low, int high) const {
+    if (low > high) {
+        return 0;
     }
 
-    return node;
+    int notAbove = high == std::numeric_limits<int>::max() ? core.getTotalCount() : rank(high + 1);
+    return notAbove - rank(low);
 }
 
 /***************************************************************************
-  函数名称：BinarySearchTree::findNode
-  功    能：递归查找二叉搜索树中的节点
-  输入参数：node - 当前节点指针，value - 要查找的值，depth - 用于返回节点深度，path - 用于记录查找路径
-  返 回 值：bool - 是否找到节点
-  说    明：根据值大小递归查找左子树或右子树，记录路径并在找到时设置深度
+  函数名称：BinarySearchTree::rank
+  功    能：统计树中小于指定值的元素数
+  输入参数：value - 比较的值
+  返 回 值：int - 小于 value 的元素数
+  说    明：有与树一致的学习型索引时由模型预测位置后局部查找；否则沿查找路径下降，O(树高)；
+            学习型索引只记录不同的值，多重集合的名次按重复次数加权，只能由树给出
 ***************************************************************************/
-bool BinarySearchTree::findNode(TreeNode* node, int value, int& depth, QVector<int>& path) {
-    if (node == nullptr) {
-        return false;
+int BinarySearchTree::rank(int value) const {
+    if (learnedExact() && !core.isMultiset()) {
+        return learnedIndex.lowerBound(value);
     }
 
-    // 记录路径
-    path.append(node->value);
+    return core.rank(value);
+}
 
-    if (value == node->value) {
-        depth = node->depth;
-        return true;
+/***************************************************************************
+  函数名称：BinarySearchTree::select
+  功    能：查找第 k 小的值
+  输入参数：k - 名次（从1开始），value - 用于返回找到的值
+  返 回 值：bool - k 是否在有效范围内
+  说    明：比较 k 与左子树的元素数决定向左、向右或停在当前节点，O(树高)
+***************************************************************************/
+bool BinarySearchTree::select(int k, int& value) const {
+    return core.select(k, value);
+}
+
+/***************************************************************************
+  函数名称：BinarySearchTree::sample
+  功    能：等概率随机取出树中的一个值
+  输入参数：value - 用于返回取到的值
+  返 回 值：bool - 树非空时返回true
+  说    明：随机生成名次后调用 select，O(树高)
+***************************************************************************/
+bool BinarySearchTree::sample(int& value) const {
+    return core.sample(value);
+}
+
+/***************************************************************************
+  函数名称：BinarySearchTree::ensureTreap
+  功    能：不是树堆策略时切换为树堆
+  输入参数：
+  返 回 值：
+  说    明：拆分与合并依赖堆序，其他策略下的树先原地重建为树堆并发出树变化信号
+***************************************************************************/
+void BinarySearchTree::ensureTreap() {
+    if (core.getBalancePolicy() != BalancePolicy::Treap) {
+        setBalancePolicy(BalancePolicy::Treap);
     }
-    else if (value < node->value) {
-        return findNode(node->left, value, depth, path);
+}
+
+/***************************************************************************
+  函数名称：BinarySearchTree::saveVersion
+  功    能：把当前内容保存为一个版本
+  输入参数：version - 接收版本的树（原有内容被清空）
+  返 回 值：
+  说    明：两棵树共用全部节点，O(1)；之后任一棵树的插入、删除只复制查找路径上的节点，
+            另一棵不受影响；本树内容不变，只有 version 发出树变化信号，version 的撤销历史被清空
+***************************************************************************/
+void BinarySearchTree::saveVersion(BinarySearchTree& version) {
+    if (&version == this) {
+        return;
     }
-    else {
-        return findNode(node->right, value, depth, path);
+
+    int removed = version.core.getNodeCount();
+    core.saveVersion(version.core);
+    version.history.clear();
+    version.notifyChanged(makeChange(version.core.getNodeCount(), removed,
+                                     std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), true));
+}
+
+/***************************************************************************
+  函数名称：BinarySearchTree::split
+  功    能：按 key 拆分树
+  输入参数：key - 拆分值，right - 接收不小于 key 的节点的树（原有内容被清空）
+  返 回 值：
+  说    明：本树保留小于 key 的节点；right 与本树共用节点存储，节点不搬动，期望 O(log n)；
+            两棵树都切换为树堆策略并发出树变化信号；拆分跨越两棵树，两棵树的撤销历史都被清空
+***************************************************************************/
+void BinarySearchTree::split(int key, BinarySearchTree& right) {
+    if (&right == this) {
+        return;
     }
+
+    ensureTreap();
+    right.clear();
+    core.split(key, right.core);
+    history.clear();
+    right.history.clear();
+
+    int moved = right.core.getTotalCount();
+    notifyChanged(makeChange(0, moved, key, std::numeric_limits<int>::max(), true));
+    right.notifyChanged(makeChange(moved, 0, key, std::numeric_limits<int>::max(), true));
 }
 
 /***************************************************************************
-  函数名称：BinarySearchTree::findNodeWithPath
-  功    能：递归查找节点并记录查找路径
-  输入参数：node - 当前节点指针，value - 要查找的值，path - 用于记录查找路径
-  返 回 值：bool - 是否找到节点
-  说    明：根据值大小递归查找左子树或右子树，记录路径但不设置深度
+  函数名称：BinarySearchTree::join
+  功    能：把 right 整体接到本树右侧
+  输入参数：right - 要接入的树，其中的值须全部大于本树中的值，完成后被清空
+  返 回 值：bool - 值域重叠时返回false，两棵树都不变
+  说    明：两棵树共用节点存储（如由 split 得到）时只需合并，期望 O(log n)；
+            否则先把 right 的节点复制进本树的存储，O(m)；两棵树的撤销历史都被清空；
+            名次计入重复次数，多重集合按元素总数取两端的值
 ***************************************************************************/
-bool BinarySearchTree::findNodeWithPath(TreeNode* node, int value, QVector<int>& path) {
-    if (node == nullptr) {
+bool BinarySearchTree::join(BinarySearchTree& right) {
+    if (&right == this || right.isEmpty()) {
+        return true;
+    }
+
+    int maxValue, minValue;
+    if (select(getTotalCount(), maxValue) && right.select(1, minValue) && maxValue >= minValue) {
         return false;
     }
 
-    // 记录路径
-    path.append(node->value);
+    int lowValue, highValue, joined = right.getTotalCount();
+    right.select(1, lowValue);
+    right.select(joined, highValue);
 
-    if (value == node->value) {
-        return true;
+    ensureTreap();
+    if (core.getNodePool().sharesWith(right.core.getNodePool())) {
+        right.ensureTreap();
     }
-    else if (value < node->value) {
-        return findNodeWithPath(node->left, value, path);
+    if (!core.join(right.core)) {
+        return false;
+    }
+    history.clear();
+    right.history.clear();
+
+    right.notifyChanged(makeChange(0, joined, std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), true));
+    notifyChanged(makeChange(joined, 0, lowValue, highValue, true));
+    return true;
+}
+
+/***************************************************************************
+  函数名称：BinarySearchTree::insertBatch
+  功    能：批量插入
+  输入参数：values - 要插入的值（可以无序、重复）
+  返 回 值：
+  说    明：树堆策略下排序去重后用 O(m) 的方式建成一棵树堆，再与本树求并；
+            其他策略下逐个插入，O(m log n)，平衡策略保持不变，撤销后也无需恢复；
+            已存在的值被丢弃，只发出一次树变化信号；
+            撤销历史中记为一条，只保存实际新增的值（多重集合为全部值）
+***************************************************************************/
+void BinarySearchTree::insertBatch(const QVector<int>& values) {
+    if (values.isEmpty()) {
+        return;
+    }
+
+    if (isRecording()) {
+        QVector<int> added = values;
+        std::sort(added.begin(), added.end());
+        if (!core.isMultiset()) {
+            added.erase(std::unique(added.begin(), added.end()), added.end());
+            added.erase(std::remove_if(added.begin(), added.end(),
+                                       [this](int value) { return core.contains(value); }), added.end());
+        }
+        if (!added.isEmpty()) {
+            EditHistory::Record record;
+            record.kind  = EditHistory::Record::Kind::InsertBatch;
+            record.added = EditHistory::packValues(added);
+            history.push(record);
+        }
+    }
+
+    int inserted = 0;
+    if (core.getBalancePolicy() == BalancePolicy::Treap) {
+        inserted = core.insertBatch(values);
     }
     else {
-        return findNodeWithPath(node->right, value, path);
+        for (int value : values) {
+            inserted += core.insert(value) ? 1 : 0;
+        }
     }
+
+    auto range = std::minmax_element(values.begin(), values.end());
+    notifyChanged(makeChange(inserted, 0, *range.first, *range.second, false));
 }
 
 /***************************************************************************
-  函数名称：BinarySearchTree::deleteNode
-  功    能：递归删除二叉搜索树中的节点
-  输入参数：node - 当前节点指针，value - 要删除的值
-  返 回 值：TreeNode* - 删除后的节点指针
-  说    明：根据值大小递归查找要删除的节点，处理三种删除情况：无子节点、一个子节点、两个子节点
+  函数名称：BinarySearchTree::eraseRange
+  功    能：批量删除 [low, high] 内的节点
+  输入参数：low, high - 删除范围（包含两端）
+  返 回 值：int - 删除的节点数
+  说    明：树堆策略下两次拆分取出中间一段整体回收，再把两侧合并，期望 O(log n + m)；
+            其他策略下取出范围内的值逐个删除，O(m log n)，平衡策略保持不变；
+            只发出一次树变化信号；撤销历史中记为一条，保存被删除的值
 ***************************************************************************/
-TreeNode* BinarySearchTree::deleteNode(TreeNode* node, int value) {
-    if (node == nullptr) {
-        return nullptr;
+int BinarySearchTree::eraseRange(int low, int high) {
+    if (low > high || isEmpty()) {
+        return 0;
     }
 
-    if (value < node->value) {
-        node->left = deleteNode(node->left, value);
+    bool         treap = core.getBalancePolicy() == BalancePolicy::Treap;
+    QVector<int> erasedValues;
+    if (isRecording() || !treap) {
+        erasedValues = collectValues(low, high);
     }
-    else if (value > node->value) {
-        node->right = deleteNode(node->right, value);
+    if (isRecording() && !erasedValues.isEmpty()) {
+        EditHistory::Record record;
+        record.kind    = EditHistory::Record::Kind::EraseRange;
+        record.low     = low;
+        record.high    = high;
+        record.removed = EditHistory::packValues(erasedValues);
+        history.push(record);
+    }
+
+    int erased = 0;
+    if (treap) {
+        erased = core.eraseRange(low, high);
     }
     else {
-        if (node->left == nullptr && node->right == nullptr) {
-            delete node;
-            node = nullptr;
-        }
-        else if (node->left == nullptr) {
-            TreeNode* temp = node;
-            node = node->right;
-            delete temp;
-        }
-        else if (node->right == nullptr) {
-            TreeNode* temp = node;
-            node = node->left;
-            delete temp;
-        }
-        else {
-            TreeNode* temp = node->right;
-            while (temp->left != nullptr) {
-                temp = temp->left;
-            }
-            node->value = temp->value;
-            node->right = deleteNode(node->right, temp->value);
+        for (int value : erasedValues) {
+            erased += core.remove(value) ? 1 : 0;
         }
     }
 
-    return node;
+    notifyChanged(makeChange(0, erased, low, high, false));
+    return erased;
 }
 
 /***************************************************************************
-  函数名称：BinarySearchTree::inOrderTraversal
-  功    能：递归进行中序遍历
-  输入参数：node - 当前节点指针，result - 用于存储遍历结果的字符串
+  函数名称：BinarySearchTree::setBalancePolicy
+  功    能：切换自平衡策略
+  输入参数：policy - 新的自平衡策略
   返 回 值：
-  说    明：按左子树-根节点-右子树的顺序遍历，将节点值和深度添加到结果字符串
+  说    明：切换到 AVL、红黑树、替罪羊树或树堆时整棵树被重建，发出树变化信号；
+            任何二叉搜索树都可以直接作为伸展树
 ***************************************************************************/
-void BinarySearchTree::inOrderTraversal(TreeNode* node, QString& result) {
-    if (node != nullptr) {
-        inOrderTraversal(node->left, result);
-        result += QString::number(node->value) + "(" + QString::number(node->depth) + ") ";
-        inOrderTraversal(node->right, result);
+void BinarySearchTree::setBalancePolicy(BalancePolicy policy) {
+    if (policy == core.getBalancePolicy()) {
+        return;
+    }
+
+    core.setBalancePolicy(policy);
+    if (policy != BalancePolicy::None && policy != BalancePolicy::Splay && !core.isEmpty()) {
+        notifyChanged(makeChange(0, 0, 0, 0, true));
     }
 }
 
 /***************************************************************************
-  函数名称：BinarySearchTree::clearTree
-  功    能：递归清空二叉搜索树
-  输入参数：node - 当前节点指针
+  函数名称：BinarySearchTree::setMultiset
+  功    能：切换多重集合模式
+  输入参数：enabled - 是否为多重集合
   返 回 值：
-  说    明：递归删除左子树、右子树和当前节点
+  说    明：树的形状不变；切换为集合时各值只保留一份，重复次数的显示随之变化，发出树变化信号；
+            插入、删除的含义随模式改变，撤销历史被清空
 ***************************************************************************/
-void BinarySearchTree::clearTree(TreeNode* node) {
-    if (node != nullptr) {
-        clearTree(node->left);
-        clearTree(node->right);
-        delete node;
+void BinarySearchTree::setMultiset(bool enabled) {
+    if (enabled == core.isMultiset()) {
+        return;
+    }
+
+    int oldTotal = core.getTotalCount();
+    core.setMultiset(enabled);
+    history.clear();
+    if (oldTotal != core.getTotalCount()) {
+        notifyChanged(makeChange(0, oldTotal - core.getTotalCount(),
+                                 std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), true));
     }
 }
 
 /***************************************************************************
-  函数名称：BinarySearchTree::storeNodesInOrder
-  功    能：递归按顺序存储节点值
-  输入参数：node - 当前节点指针，values - 用于存储节点值的向量
+  函数名称：BinarySearchTree::getBalanceStats
+  功    能：获取某一策略的旋转统计
+  输入参数：policy - 自平衡策略
+  返 回 值：BalanceStats - 该策略下累计的操作数和旋转数
+  说    明：
+***************************************************************************/
+BalanceStats BinarySearchTree::getBalanceStats(BalancePolicy policy) const {
+    return core.getBalanceStats(policy);
+}
+
+/***************************************************************************
+  函数名称：BinarySearchTree::resetBalanceStats
+  功    能：清零各策略的旋转统计
+  输入参数：
   返 回 值：
-  说    明：递归进行中序遍历，将节点值按顺序添加到向量中
+  说    明：
 ***************************************************************************/
-void BinarySearchTree::storeNodesInOrder(TreeNode* node, QVector<int>& values) {
-    if (node == nullptr) {
-        return;
+void BinarySearchTree::resetBalanceStats() {
+    core.resetBalanceStats();
+}
+
+/***************************************************************************
+  函数名称：BinarySearchTree::undo
+  功    能：撤销最近一次修改
+  输入参数：
+  返 回 值：bool - 是否有可撤销的修改
+  说    明：执行记录的逆操作，耗时与这次修改涉及的元素数成正比，与树的大小无关（整体替换除外）；
+            逆操作本身不再记录，整个过程只发出一次树变化信号
+***************************************************************************/
+bool BinarySearchTree::undo() {
+    EditHistory::Record record;
+    if (!history.undo(record)) {
+        return false;
     }
 
-    storeNodesInOrder(node->left, values);
-    values.append(node->value);
-    storeNodesInOrder(node->right, values);
+    replay(record, false);
+    return true;
 }
 
 /***************************************************************************
-  函数名称：BinarySearchTree::buildBalancedTree
-  功    能：递归构建平衡二叉搜索树
-  输入参数：values - 有序节点值向量，start - 起始索引，end - 结束索引，depth - 当前深度
-  返 回 值：TreeNode* - 构建的平衡树根节点
-  说    明：使用有序数组的中间值作为根节点，递归构建左右子树
+  函数名称：BinarySearchTree::redo
+  功    能：重做最近一次撤销的修改
+  输入参数：
+  返 回 值：bool - 是否有可重做的修改
+  说    明：重新执行记录的操作，只发出一次树变化信号
 ***************************************************************************/
-TreeNode* BinarySearchTree::buildBalancedTree(QVector<int>& values, int start, int end, int depth) {
-    if (start > end) {
-        return nullptr;
+bool BinarySearchTree::redo() {
+    EditHistory::Record record;
+    if (!history.redo(record)) {
+        return false;
     }
 
-    int mid = (start + end) / 2;
-    TreeNode* node = new TreeNode(values[mid], depth);
+    replay(record, true);
+    return true;
+}
 
-    node->left = buildBalancedTree(values, start, mid - 1, depth + 1);
-    node->right = buildBalancedTree(values, mid + 1, end, depth + 1);
+/***************************************************************************
+  函数名称：BinarySearchTree::clearHistory
+  功    能：清空撤销、重做历史
+  输入参数：
+  返 回 值：
+  说    明：
+***************************************************************************/
+void BinarySearchTree::clearHistory() {
+    history.clear();
+}
 
-    return node;
+/***************************************************************************
+  函数名称：BinarySearchTree::setHistoryBudget
+  功    能：设置撤销、重做历史的内存上限
+  输入参数：bytes - 内存上限（字节），为0时不再记录修改
+  返 回 值：
+  说    明：超出上限的最早记录立即被丢弃
+***************************************************************************/
+void BinarySearchTree::setHistoryBudget(qint64 bytes) {
+    history.setBudget(bytes);
 }
 
 /***************************************************************************
-  函数名称：BinarySearchTree::updateDepths
-  功    能：递归更新节点深度
-  输入参数：node - 当前节点指针，depth - 当前深度
+  函数名称：BinarySearchTree::replay
+  功    能：执行一条记录或它的逆操作
+  输入参数：record - 修改记录，forward - true 为重做，false 为撤销
   返 回 值：
-  说    明：递归设置节点深度，并更新左右子树的深度
+  说    明：replaying 置位期间的修改不记入历史；
+            插入与删除互为逆操作，整体替换换回另一份内容，
+            批量插入的逆操作为逐个删除新增的值，范围删除的逆操作为把删除的值批量插回
 ***************************************************************************/
-void BinarySearchTree::updateDepths(TreeNode* node, int depth) {
-    if (node == nullptr) {
+void BinarySearchTree::replay(const EditHistory::Record& record, bool forward) {
+    typedef EditHistory::Record::Kind Kind;
+
+    BatchGuard guard(*this);
+    replaying = true;
+
+    switch (record.kind) {
+    case Kind::Insert:
+        if (forward) {
+            insert(record.low);
+        }
+        else {
+            remove(record.low);
+        }
+        break;
+    case Kind::Remove:
+        if (forward) {
+            remove(record.low);
+        }
+        else {
+            insert(record.low);
+        }
+        break;
+    case Kind::Replace:
+        assign(EditHistory::unpackValues(forward ? record.added : record.removed));
+        break;
+    case Kind::InsertBatch:
+        if (forward) {
+            insertBatch(EditHistory::unpackValues(record.added));
+        }
+        else {
+            for (int value : EditHistory::unpackValues(record.added)) {
+                remove(value);
+            }
+        }
+        break;
+    case Kind::EraseRange:
+        if (forward) {
+            eraseRange(record.low, record.high);
+        }
+        else {
+            insertBatch(EditHistory::unpackValues(record.removed));
+        }
+        break;
+    }
+
+    replaying = false;
+}
+
+/***************************************************************************
+  函数名称：BinarySearchTree::collectValues
+  功    能：取出 [low, high] 内的值
+  输入参数：low, high - 值域（包含两端）
+  返 回 值：QVector<int> - 从小到大排列的值，多重集合中重复的值按重复次数展开
+  说    明：整个值域时中序遍历，O(n)；否则从 low 起逐个取后继，O(m log n)
+***************************************************************************/
+QVector<int> BinarySearchTree::collectValues(int low, int high) const {
+    QVector<int> values;
+
+    if (low == std::numeric_limits<int>::min() && high == std::numeric_limits<int>::max()) {
+        values.reserve(core.getTotalCount());
+        core.visitInOrder([&values](const TreeNode& current, int) {
+            for (int i = 0; i < current.count; i++) {
+                values.append(current.key);
+            }
+        });
+        return values;
+    }
+
+    int value;
+    int next = low;
+    while (core.lowerBound(next, value) && value <= high) {
+        for (int i = core.count(value); i > 0; i--) {
+            values.append(value);
+        }
+        if (value == std::numeric_limits<int>::max()) {
+            break;
+        }
+        next = value + 1;
+    }
+
+    return values;
+}
+
+/***************************************************************************
+  函数名称：BinarySearchTree::setPublishing
+  功    能：开启或关闭版本发布
+  输入参数：enabled - 是否发布
+  返 回 值：
+  说    明：开启时立即发布一次当前内容；关闭时发布空版本，之前的版本没有读者持有后归还节点，
+            之后的修改不必再复制路径
+***************************************************************************/
+void BinarySearchTree::setPublishing(bool enabled) {
+    if (enabled == publishing) {
         return;
     }
 
-    node->depth = depth;
-    updateDepths(node->left, depth + 1);
-    updateDepths(node->right, depth + 1);
+    publishing = enabled;
+    if (publishing) {
+        publishVersion();
+    }
+    else {
+        publisher.withdraw();
+    }
 }
 
 /***************************************************************************
-  函数名称：BinarySearchTree::calculateHeight
-  功    能：递归计算树高度
-  输入参数：node - 当前节点指针
-  返 回 值：int - 树的高度
-  说    明：递归计算左右子树的高度，返回较大值加1
+  函数名称：BinarySearchTree::publishVersion
+  功    能：发布当前内容
+  输入参数：
+  返 回 值：
+  说    明：在修改树的线程上调用，版本与树共用节点，O(1)；之后各策略下的每次修改只复制查找路径
+            和调整涉及的被共用节点，替罪羊树重建时复制被重建的子树；批量修改整批只发布一次；
+            未开启发布时不做任何事
 ***************************************************************************/
-int BinarySearchTree::calculateHeight(TreeNode* node) {
-    if (node == nullptr) {
-        return 0;
+void BinarySearchTree::publishVersion() {
+    if (publishing) {
+        publisher.publish(core.getNodePool(), core.getRootIndex(), core.getNodeCount(), core.getTotalCount());
+    }
+}
+
+/***************************************************************************
+  函数名称：BinarySearchTree::beginBatch
+  功    能：开始批量修改
+  输入参数：
+  返 回 值：
+  说    明：之后的修改只累计到 pendingChange，不发出树变化信号；可以嵌套，最外层结束时才发出
+***************************************************************************/
+void BinarySearchTree::beginBatch() {
+    if (batchDepth++ == 0) {
+        pendingChange = TreeChange();
+    }
+}
+
+/***************************************************************************
+  函数名称：BinarySearchTree::endBatch
+  功    能：结束批量修改
+  输入参数：
+  返 回 值：
+  说    明：最外层结束时，若期间有修改，把累计的变化合并为一次树变化信号发出，树有变化时先发布一次版本
+***************************************************************************/
+void BinarySearchTree::endBatch() {
+    if (batchDepth == 0 || --batchDepth > 0) {
+        return;
+    }
+
+    if (pendingChange.operations > 0) {
+        TreeChange change = pendingChange;
+        pendingChange = TreeChange();
+        if (!change.isEmpty()) {
+            publishVersion();
+        }
+        emit treeChanged(change);
+    }
+}
+
+/***************************************************************************
+  函数名称：BinarySearchTree::notifyChanged
+  功    能：发出或累计一次树变化
+  输入参数：change - 本次变化的摘要
+  返 回 值：
+  说    明：树的内容有增删时作废只读快照（伸展、平衡只改变形状，快照仍然有效）；
+            有删除时作废学习型索引，只有插入时记下插入数，查不到的值再到树中查找；
+            不在批量修改中时立即发出树变化信号，树有变化时先发布版本；
+            否则累加节点数，合并值域，任一次整体调整都使整批标记为整体调整
+***************************************************************************/
+void BinarySearchTree::notifyChanged(const TreeChange& change) {
+    if (snapshotValid && change.inserted + change.removed > 0) {
+        snapshot.clear();
+        snapshotValid = false;
+    }
+    if (learnedValid && change.removed > 0) {
+        learnedIndex.clear();
+        learnedValid = false;
+    }
+    learnedInsertions += change.inserted;
+
+    if (batchDepth == 0) {
+        if (!change.isEmpty()) {
+            publishVersion();
+        }
+        emit treeChanged(change);
+        return;
     }
 
-    int leftHeight  = calculateHeight(node->left);
-    int rightHeight = calculateHeight(node->right);
+    if (change.inserted + change.removed > 0) {
+        if (pendingChange.inserted + pendingChange.removed == 0) {
+            pendingChange.lowValue  = change.lowValue;
+            pendingChange.highValue = change.highValue;
+        }
+        else {
+            pendingChange.lowValue  = std::min(pendingChange.lowValue, change.lowValue);
+            pendingChange.highValue = std::max(pendingChange.highValue, change.highValue);
+        }
+    }
 
-    return 1 + std::max(leftHeight, rightHeight);
+    pendingChange.operations   += change.operations;
+    pendingChange.inserted     += change.inserted;
+    pendingChange.removed      += change.removed;
+    pendingChange.restructured  = pendingChange.restructured || change.restructured;
 }
 
 /***************************************************************************
@@ -364,23 +951,28 @@ int BinarySearchTree::calculateHeight(TreeNode* node) {
   功    能：平衡二叉搜索树
   输入参数：
   返 回 值：
-  说    明：将树转换为有序数组，然后从中构建平衡树，发出树变化信号
+  说    明：用 DSW 算法原地调整，节点既不回收也不重新分配，发出树变化信号；
+            树堆的形状由优先级决定，不做调整；
+            动画执行时把拉直和每一轮压缩各记为一个动画步骤；
+            大树且线程数大于1时改为多线程重建，结果与 DSW 相同
 ***************************************************************************/
 void BinarySearchTree::balance() {
-    if (root == nullptr)
+    if (core.isEmpty() || core.getBalancePolicy() == BalancePolicy::Treap)
         return;
 
-    // 将树转换为有序数组
-    QVector<int> values;
-    storeNodesInOrder(root, values);
-
-    // 清空原树
-    clearTree(root);
-
-    // 从有序数组构建平衡树
-    root = buildBalancedTree(values, 0, values.size() - 1, 1);
+    core.balance(balanceThreads);
+    notifyChanged(makeChange(0, 0, 0, 0, true));
+}
 
-    emit treeChanged();
+/***************************************************************************
+  函数名称：BinarySearchTree::setBalanceThreads
+  功    能：设置平衡使用的线程数
+  输入参数：threads - 线程数，小于1时按1处理
+  返 回 值：
+  说    明：默认为硬件线程数；为1时总是用 DSW 算法
+***************************************************************************/
+void BinarySearchTree::setBalanceThreads(int threads) {
+    balanceThreads = std::max(1, threads);
 }
 
 /***************************************************************************
@@ -388,12 +980,15 @@ void BinarySearchTree::balance() {
   功    能：开始查找动画
   输入参数：value - 要查找的值
   返 回 值：
-  说    明：停止当前动画，生成查找动画步骤，启动动画定时器
+  说    明：停止当前动画，生成查找动画步骤，启动动画定时器；
+            伸展树策略下查找结束后继续播放伸展的每一步
 ***************************************************************************/
 void BinarySearchTree::startFindAnimation(int value) {
     stopAnimation();
     isAnimationRunning = true;
     animationSteps.clear();
+    pendingAction = PendingAction::Find;
+    pendingValue  = value;
     animateFind(value);
     currentStep = 0;
     animationTimer->start(animationSpeed);
@@ -410,7 +1005,8 @@ void BinarySearchTree::startInsertAnimation(int value) {
     stopAnimation();
     isAnimationRunning = true;
     animationSteps.clear();
-    pendingInsertValue = value;
+    pendingAction = PendingAction::Insert;
+    pendingValue  = value;
     animateInsertion(value);
     currentStep = 0;
     animationTimer->start(animationSpeed);
@@ -427,7 +1023,8 @@ void BinarySearchTree::startDeleteAnimation(int value) {
     stopAnimation();
     isAnimationRunning = true;
     animationSteps.clear();
-    pendingDeleteValue = value;
+    pendingAction = PendingAction::Delete;
+    pendingValue  = value;
     animateDeletion(value);
     currentStep = 0;
     animationTimer->start(animationSpeed);
@@ -444,23 +1041,42 @@ void BinarySearchTree::startBalanceAnimation() {
     stopAnimation();
     isAnimationRunning = true;
     animationSteps.clear();
+    pendingAction = PendingAction::Balance;
     animateBalancing();
     currentStep = 0;
     animationTimer->start(animationSpeed);
 }
 
+/***************************************************************************
+  函数名称：BinarySearchTree::startSelectAnimation
+  功    能：开始选择第 k 小动画
+  输入参数：k - 名次（从1开始）
+  返 回 值：
+  说    明：停止当前动画，生成选择动画步骤，启动动画定时器
+***************************************************************************/
+void BinarySearchTree::startSelectAnimation(int k) {
+    stopAnimation();
+    isAnimationRunning = true;
+    animationSteps.clear();
+    animateSelect(k);
+    currentStep = 0;
+    animationTimer->start(animationSpeed);
+}
+
 /***************************************************************************
   函数名称：BinarySearchTree::stopAnimation
   功    能：停止动画
   输入参数：
   返 回 值：
-  说    明：停止动画定时器，清除高亮状态，设置动画运行状态为false
+  说    明：停止动画定时器，清除高亮状态，设置动画运行状态为false；
+            被打断的动画不再执行待执行的操作
 ***************************************************************************/
 void BinarySearchTree::stopAnimation() {
     if (animationTimer->isActive()) {
         animationTimer->stop();
     }
     isAnimationRunning = false;
+    pendingAction = PendingAction::None;
     emit clearHighlights();
 }
 
@@ -473,8 +1089,8 @@ void BinarySearchTree::stopAnimation() {
 ***************************************************************************/
 void BinarySearchTree::animateFind(int value) {
     currentPath.clear();  // 清空当前路径
-    QVector<int> path;
-    bool found = findNodeWithPath(root, value, path);
+    SearchPath path;
+    bool found = core.findPath(value, path);
 
     // 添加查找路径步骤
     for (int i = 0; i < path.size(); i++) {
@@ -520,9 +1136,8 @@ void BinarySearchTree::animateFind(int value) {
 ***************************************************************************/
 void BinarySearchTree::animateInsertion(int value) {
     currentPath.clear();  // 清空当前路径
-    int depth = 0;
-    QVector<int> path;
-    bool exists = findNode(root, value, depth, path);
+    SearchPath path;
+    bool exists = core.findPath(value, path);
 
     if (exists) {
         animationSteps.append(qMakePair(
@@ -578,9 +1193,8 @@ void BinarySearchTree::animateInsertion(int value) {
 ***************************************************************************/
 void BinarySearchTree::animateDeletion(int value) {
     currentPath.clear();  // 清空当前路径
-    int depth = 0;
-    QVector<int> path;
-    bool exists = findNode(root, value, depth, path);
+    SearchPath path;
+    bool exists = core.findPath(value, path);
 
     if (!exists) {
         animationSteps.append(qMakePair(
@@ -637,11 +1251,11 @@ void BinarySearchTree::animateDeletion(int value) {
   功    能：生成平衡动画步骤
   输入参数：
   返 回 值：
-  说    明：生成平衡过程的动画步骤，包括中序遍历和构建平衡树
+  说    明：先说明 DSW 的两个阶段，拉直和各轮压缩在执行平衡时作为旋转步骤追加
 ***************************************************************************/
 void BinarySearchTree::animateBalancing() {
     currentPath.clear();  // 清空当前路径
-    if (root == nullptr) {
+    if (core.isEmpty()) {
         animationSteps.append(qMakePair(
             QString::fromUtf8("树为空，无需平衡"),
             -1
@@ -649,46 +1263,26 @@ void BinarySearchTree::animateBalancing() {
         return;
     }
 
-    animationSteps.append(qMakePair(
-        QString::fromUtf8("开始平衡树"),
-        -1
-    ));
-
-    animationSteps.append(qMakePair(
-        QString::fromUtf8("中序遍历获取所有节点"),
-        -1
-    ));
-
-    // 添加中序遍历步骤
-    QVector<int> inOrderValues;
-    storeNodesInOrderForAnimation(root, inOrderValues);
-
-    for (int i = 0; i < inOrderValues.size(); i++) {
-        QVector<int> stepPath;
-        stepPath.append(inOrderValues[i]);
-        currentPath = stepPath;
-
+    if (core.getBalancePolicy() == BalancePolicy::Treap) {
         animationSteps.append(qMakePair(
-            QString::fromUtf8("中序遍历步骤 %1: 访问节点 %2").arg(i + 1).arg(inOrderValues[i]),
-            inOrderValues[i]
+            QString::fromUtf8("树堆的形状由优先级决定，无需平衡"),
+            -1
         ));
-
-        // 发送路径高亮信号
-        emit highlightPath(stepPath);
+        return;
     }
 
     animationSteps.append(qMakePair(
-        QString::fromUtf8("构建平衡树"),
+        QString::fromUtf8("开始平衡树，原地旋转，不重新分配节点"),
         -1
     ));
 
     animationSteps.append(qMakePair(
-        QString::fromUtf8("更新节点高度"),
-        -1
+        QString::fromUtf8("第一步：沿右链向下，遇到左孩子就右旋，把树拉直成链"),
+        core.getNodePool()[core.getRootIndex()].key
     ));
 
     animationSteps.append(qMakePair(
-        QString::fromUtf8("平衡完成"),
+        QString::fromUtf8("第二步：从根开始每隔一个节点左旋，每轮右链长度减半"),
         -1
     ));
 
@@ -697,19 +1291,66 @@ void BinarySearchTree::animateBalancing() {
 }
 
 /***************************************************************************
-  函数名称：BinarySearchTree::storeNodesInOrderForAnimation
-  功    能：为动画按顺序存储节点值
-  输入参数：node - 当前节点指针，values - 用于存储节点值的向量
+  函数名称：BinarySearchTree::animateSelect
+  功    能：生成选择第 k 小动画步骤
+  输入参数：k - 名次（从1开始）
   返 回 值：
-  说    明：递归进行中序遍历，将节点值存储到向量中，用于动画显示
+  说    明：按子树元素数逐层下降，每一步说明向左、向右还是命中，并高亮已走过的路径；
+            多重集合中重复 c 次的值占据 c 个名次
 ***************************************************************************/
-void BinarySearchTree::storeNodesInOrderForAnimation(TreeNode* node, QVector<int>& values) {
-    if (node == nullptr)
+void BinarySearchTree::animateSelect(int k) {
+    currentPath.clear();  // 清空当前路径
+    SearchPath path;
+    bool found = core.selectPath(k, path);
+
+    if (!found) {
+        animationSteps.append(qMakePair(
+            QString::fromUtf8("名次 %1 超出范围（共 %2 个元素）").arg(k).arg(core.getTotalCount()),
+            -1
+        ));
         return;
+    }
+
+    // 添加选择路径步骤
+    int remaining = k;
+    for (int i = 0; i < path.size(); i++) {
+        // 更新当前路径
+        QVector<int> stepPath;
+        for (int j = 0; j <= i; j++) {
+            stepPath.append(path[j]);
+        }
+        currentPath = stepPath;
+
+        int leftCount = rank(path[i]) - (k - remaining);
+        int repeats   = core.count(path[i]);
+        QString direction;
+        if (i + 1 == path.size()) {
+            direction = QString::fromUtf8("左子树 %1 个元素，命中").arg(leftCount);
+        }
+        else if (remaining <= leftCount) {
+            direction = QString::fromUtf8("左子树 %1 个元素，向左").arg(leftCount);
+        }
+        else {
+            direction = QString::fromUtf8("左子树 %1 个元素，向右找第 %2 小").arg(leftCount).arg(remaining - leftCount - repeats);
+            remaining -= leftCount + repeats;
+        }
+
+        animationSteps.append(qMakePair(
+            QString::fromUtf8("选择步骤 %1: 访问节点 %2，%3").arg(i + 1).arg(path[i]).arg(direction),
+            path[i]
+        ));
 
-    storeNodesInOrderForAnimation(node->left, values);
-    values.append(node->value);
-    storeNodesInOrderForAnimation(node->right, values);
+        // 发送路径高亮信号
+        emit highlightPath(stepPath);
+    }
+
+    animationSteps.append(qMakePair(
+        QString::fromUtf8("第 %1 小的值为 %2").arg(k).arg(path.last()),
+        path.last()
+    ));
+
+    currentPath.clear();  // 清空当前路径
+    emit highlightPath(QVector<int>());  // 发送空路径清除高亮
 }
 
 /***************************************************************************
@@ -717,7 +1358,8 @@ void BinarySearchTree::storeNodesInOrderForAnimation(TreeNode* node, QVector<int
   功    能：处理下一个动画步骤
   输入参数：
   返 回 值：
-  说    明：从动画步骤队列中取出下一个步骤并执行，如果所有步骤完成则执行实际操作
+  说    明：从动画步骤队列中取出下一个步骤并执行，所有步骤完成后执行实际操作；
+            操作中发生的旋转、伸展追加为新的动画步骤继续播放，播放完后动画结束
 ***************************************************************************/
 void BinarySearchTree::processNextAnimationStep() {
     if (currentStep < animationSteps.size()) {
@@ -735,24 +1377,46 @@ void BinarySearchTree::processNextAnimationStep() {
         }
 
         currentStep++;
+        return;
     }
-    else {
-        stopAnimation();
-        emit animationFinished();
 
-        // 执行实际的操作
-        if (animationSteps.size() > 0) {
-            QString firstStep = animationSteps[0].first;
+    // 执行实际的操作，记录其中的旋转
+    PendingAction action = pendingAction;
+    pendingAction = PendingAction::None;
 
-            if (firstStep.contains(QString::fromUtf8("插入"))) {
-                insert(pendingInsertValue);
-            }
-            else if (firstStep.contains(QString::fromUtf8("删除"))) {
-                remove(pendingDeleteValue);
-            }
-            else if (firstStep.contains(QString::fromUtf8("平衡"))) {
-                balance();
+    if (action != PendingAction::None) {
+        core.takeSteps();
+        core.setRecordSteps(true);
+
+        switch (action) {
+        case PendingAction::Find: {
+            int depth;
+            find(pendingValue, depth);
+            break;
+        }
+        case PendingAction::Insert:
+            insert(pendingValue);
+            break;
+        case PendingAction::Delete:
+            remove(pendingValue);
+            break;
+        default:
+            balance();
+            break;
+        }
+
+        core.setRecordSteps(false);
+
+        QVector<SearchTree<int>::Step> steps = core.takeSteps();
+        if (!steps.isEmpty()) {
+            for (const SearchTree<int>::Step& step : steps) {
+                animationSteps.append(qMakePair(step.description, step.highlighted ? step.key : -1));
             }
+            animationSteps.append(qMakePair(QString::fromUtf8("调整完成，共 %1 步").arg(steps.size()), -1));
+            return;     // 定时器继续运行，播放旋转步骤
         }
     }
+
+    stopAnimation();
+    emit animationFinished();
 }
\ No newline at end of file
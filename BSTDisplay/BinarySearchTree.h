@@ -1,7 +1,7 @@
 ﻿/***************************************************************************
   文件名称：BinarySearchTree.h
   功    能：二叉搜索树类的声明文件，包含节点的插入、删除、查找、平衡等操作
-  说    明：
+  说    明：树本身由 SearchTree<int> 实现，这里加上信号、批量修改、只读索引和动画
 ***************************************************************************/
 
 #ifndef BINARYSEARCHTREE_H
@@ -11,12 +11,44 @@
 #include <QVector>
 #include <QTimer>
 #include <QObject>
-#include "TreeNode.h"
+#include "SearchTree.h"
+#include "SnapshotIndex.h"
+#include "LearnedIndex.h"
+#include "EditHistory.h"
+#include "TreePublisher.h"
+
+typedef SearchTree<int>::KeyPath SearchPath; // 查找路径，较浅的路径不申请堆内存
+
+// 树的一次变化（批量修改时为整批变化）的摘要，随 treeChanged 信号发出
+struct TreeChange {
+    int  operations   = 0;     // 合并的修改次数
+    int  inserted     = 0;     // 新增的元素数（多重集合含重复次数的增加）
+    int  removed      = 0;     // 删除的元素数（多重集合含重复次数的减少）
+    int  lowValue     = 0;     // 新增或删除的值域下界（有新增或删除时有效）
+    int  highValue    = 0;     // 新增或删除的值域上界
+    bool restructured = false; // 是否有整体重建、拆分合并或伸展，节点位置需全部重新计算
+
+    bool isEmpty() const { return inserted == 0 && removed == 0 && !restructured; } // 树没有变化
+};
+
+// 批量建树各阶段的耗时，由 bulkLoad、bulkBuild 填写
+struct BulkBuildTimings {
+    qint64 parseNs    = 0; // 解析文本的纳秒数（bulkBuild 不解析，为0）
+    qint64 sortNs     = 0; // 基数排序的纳秒数
+    qint64 dedupNs    = 0; // 去重的纳秒数
+    qint64 buildNs    = 0; // 分配节点并链接成树的纳秒数
+    int    inputCount = 0; // 输入的值数
+    int    nodeCount  = 0; // 建成的节点数
+    int    threads    = 1; // 使用的线程数
+
+    qint64 getTotalNs() const { return parseNs + sortNs + dedupNs + buildNs; } // 总耗时
+};
 
 /***************************************************************************
   类名称：BinarySearchTree
   功    能：二叉搜索树数据结构实现
-  说    明：支持插入、删除、查找、平衡等操作，包含动画功能
+  说    明：支持插入、删除、查找、平衡等操作，包含动画功能；
+            界面使用的整数树，算法委托给 SearchTree<int>，本类负责发出树变化信号
 ***************************************************************************/
 class BinarySearchTree : public QObject {
     Q_OBJECT
@@ -28,30 +60,109 @@ public:
     //基本操作
     void    insert(int value);                            // 插入节点
     bool    find(int value, int& depth);                  // 查找节点
+    int     findMany(const QVector<int>& keys, QVector<int>& depths) const; // 批量查找，交错推进多路查找
     void    remove(int value);                            // 删除节点
     QString display();                                    // 显示树内容
-    bool    isEmpty();                                    // 检查树是否为空
+    bool    isEmpty() const;                              // 检查树是否为空
 
     void    clear();                                      // 清空树
 
-    TreeNode* getRoot() const { return root; }            // 返回根节点
+    NodeHandle getRoot() const { return NodeHandle(&core.getNodePool(), core.getRootIndex(), 1); } // 返回根节点句柄
 
     void    balance();                                    // 平衡树操作
-
-    int     getHeight();                                  // 获取树的高度
+    void    setBalanceThreads(int threads);               // 设置平衡与批量建树使用的线程数，不小于1
+    int     getBalanceThreads() const { return balanceThreads; } // 获取平衡与批量建树使用的线程数
+    void    copyFrom(const BinarySearchTree& other);      // 整体复制另一棵树
+    void    assign(const QVector<int>& values);           // 用一组值整体替换树的内容
+
+    // 批量建树：多线程解析、基数排序、去重并链接成树，整体替换树的内容，只发出一次树变化信号
+    bool    bulkLoad(const QByteArray& text, BulkBuildTimings* timings = nullptr); // 从文本批量建树，有无效内容时树不变并返回false
+    void    bulkBuild(QVector<int> values, BulkBuildTimings* timings = nullptr);   // 从无序的值批量建树
+
+    int     getHeight() const;                                   // 获取树的高度
+    int     getNodeCount() const { return core.getNodeCount(); } // 获取节点数
+
+    // 多重集合：重复插入的值增加节点的重复次数，名次按重复次数加权
+    void    setMultiset(bool enabled);                             // 切换多重集合模式
+    bool    isMultiset() const    { return core.isMultiset(); }    // 是否为多重集合模式
+    int     getTotalCount() const { return core.getTotalCount(); } // 计入重复次数的元素总数
+    int     count(int value) const { return core.count(value); }  // 值的重复次数
+
+    // 自平衡策略
+    void          setBalancePolicy(BalancePolicy policy);                      // 切换自平衡策略
+    BalancePolicy getBalancePolicy() const { return core.getBalancePolicy(); } // 获取当前自平衡策略
+    BalanceStats  getBalanceStats(BalancePolicy policy) const;                 // 获取某一策略的旋转统计
+    void          resetBalanceStats();                                         // 清零旋转统计
+
+    // 撤销与重做：记录每次修改的逆操作，耗时与这次修改涉及的元素数成正比
+    bool    undo();                                           // 撤销最近一次修改
+    bool    redo();                                           // 重做最近一次撤销的修改
+    bool    canUndo() const { return history.canUndo(); }     // 是否可以撤销
+    bool    canRedo() const { return history.canRedo(); }     // 是否可以重做
+    void    clearHistory();                                   // 清空撤销、重做历史
+    void    setHistoryBudget(qint64 bytes);                   // 设置历史的内存上限，为0时不记录
+    const EditHistory& getHistory() const { return history; } // 获取撤销、重做历史
+
+    // 已发布版本：开启后每次发出树变化信号前把树冻结为只读版本并原子发布，
+    // 读者持有登记期间可在任意线程上遍历，写线程照常修改，旧版本在没有读者时回收
+    void    setPublishing(bool enabled);                                           // 开启或关闭版本发布
+    bool    isPublishing() const { return publishing; }                            // 是否发布版本
+    TreePublisher::ReadGuard acquireVersion() const { return publisher.acquire(); } // 登记并取得最新发布的版本
+    const TreePublisher& getPublisher() const { return publisher; }                // 获取版本发布者
+
+    // 持久化版本：保存版本 O(1)，版本与原树共用节点，可以交给 BSTView::setTree 显示
+    void    saveVersion(BinarySearchTree& version);       // 把当前内容保存为版本 version
+
+    // 拆分与合并（切换为树堆策略）；批量插入与范围删除只在树堆策略下拆分合并，不切换策略
+    void    split(int key, BinarySearchTree& right);      // 拆分：不小于 key 的节点移到 right
+    bool    join(BinarySearchTree& right);                // 合并：right 整体接到右侧并清空
+    void    insertBatch(const QVector<int>& values);      // 批量插入
+    int     eraseRange(int low, int high);                // 批量删除 [low, high] 内的节点
+
+    // 批量修改：期间只累计变化，结束时合并发出一次 treeChanged
+    class   BatchGuard;                                   // 批量修改的作用域守卫
+    void    beginBatch();                                 // 开始批量修改，可以嵌套
+    void    endBatch();                                   // 结束批量修改
+    bool    inBatch() const { return batchDepth > 0; }    // 是否处于批量修改中
+
+    // 只读快照：有快照时查找走 Eytzinger 数组，树的内容变化后快照作废
+    void    freezeSnapshot();                                     // 把当前内容冻结为只读快照
+    bool    hasSnapshot() const { return snapshotValid; }         // 是否有有效的快照
+    const SnapshotIndex& getSnapshot() const { return snapshot; } // 获取快照
+    bool    contains(int value) const;                            // 值是否在树中（不伸展、不计深度）
+    bool    lowerBound(int value, int& result) const;             // 不小于 value 的最小值
+    QVector<int> collectValues(int low, int high) const;          // [low, high] 内的值，重复的值按次数展开
+
+    // 学习型索引：之后只有插入时仍然可用，查不到的值退回树中查找；有删除时作废
+    void    freezeLearnedIndex();                                        // 用当前内容训练学习型索引
+    bool    hasLearnedIndex() const { return learnedValid; }             // 是否有可用的学习型索引
+    const LearnedIndex& getLearnedIndex() const { return learnedIndex; } // 获取学习型索引
+    int     countRange(int low, int high) const;                         // [low, high] 内的元素数
+
+    // 顺序统计
+    int     rank(int value) const;                        // 小于 value 的元素数
+    bool    select(int k, int& value) const;              // 第 k 小的值（k 从1开始）
+    bool    sample(int& value) const;                     // 等概率随机取一个值
+
+    // 内存池统计
+    quint64 getAllocationCount() const { return core.getNodePool().getAllocationCount(); } // 累计节点分配次数
+    qint64  getBytesReserved() const   { return core.getNodePool().getBytesReserved(); }   // 节点占用的内存字节数
+    const NodePool& getNodePool() const { return core.getNodePool(); }                     // 获取节点内存池
+    int     getNodeSize() const        { return sizeof(TreeNode); }                        // 单个节点的字节数
 
     // 动画控制
     void startFindAnimation(int value);                            // 开始查找动画
     void startInsertAnimation(int value);                          // 开始插入动画
     void startDeleteAnimation(int value);                          // 开始删除动画
     void startBalanceAnimation();                                  // 开始平衡动画
+    void startSelectAnimation(int k);                              // 开始选择第 k 小动画
     void setAnimationSpeed(int speed) { animationSpeed = speed; }  // 设置动画速度
     void stopAnimation();                                          // 停止动画
 
     bool isAnimating() const { return isAnimationRunning; }        // 获取动画状态
 
 signals:
-    void treeChanged();                                                 // 树结构变化信号
+    void treeChanged(const TreeChange& change = TreeChange());          // 树结构变化信号，附带变化摘要
     void animationStep(QString description, int highlightedValue = -1); // 动画步骤信号
     void animationFinished();                                           // 动画完成信号
     void highlightNode(int value);                                      // 高亮节点信号
@@ -59,7 +170,8 @@ signals:
     void highlightPath(const QVector<int>& path);                       // 高亮路径信号
 
 private:
-    TreeNode* root;          // 根节点指针
+    SearchTree<int> core;    // 树本身
+    int balanceThreads;      // 平衡与批量建树使用的线程数
     int animationSpeed;      // 动画速度
     bool isAnimationRunning; // 动画运行状态标志
 
@@ -68,23 +180,41 @@ private:
     QVector<QPair<QString, int>> animationSteps; // 动画步骤列表
     int currentStep;                             // 当前动画步骤索引
 
-    // 待操作的值
-    int pendingInsertValue;                                     // 待插入的值
-    int pendingDeleteValue;                                     // 待删除的值
+    // 动画结束后执行的操作
+    enum class PendingAction { None, Find, Insert, Delete, Balance };
+    PendingAction pendingAction;                    // 待执行的操作
+    int           pendingValue;                     // 待插入或删除的值
+
+    // 只读快照
+    SnapshotIndex snapshot;      // 冻结的只读快照
+    bool          snapshotValid; // 快照是否与树的内容一致
+
+    // 学习型索引
+    LearnedIndex learnedIndex;      // 学习型索引
+    bool         learnedValid;      // 学习型索引是否可用（建立后没有删除过节点）
+    int          learnedInsertions; // 建立学习型索引后插入的节点数
+
+    bool learnedExact() const { return learnedValid && learnedInsertions == 0; } // 学习型索引是否与树的内容一致
+
+    // 已发布版本
+    TreePublisher publisher;  // 版本发布者
+    bool          publishing; // 是否在树变化时发布版本
+
+    void publishVersion(); // 发布当前内容
+
+    // 批量修改
+    int        batchDepth;                              // 批量修改的嵌套层数
+    TreeChange pendingChange;                           // 批量修改中累计的变化
+    void       notifyChanged(const TreeChange& change); // 发出或累计一次树变化
 
-    TreeNode* insertNode(TreeNode* node, int value, int depth);                    // 递归插入节点
-    bool      findNode(TreeNode* node, int value, int& depth, QVector<int>& path); // 递归查找节点
-    TreeNode* deleteNode(TreeNode* node, int value);                               // 递归删除节点
-    void      inOrderTraversal(TreeNode* node, QString& result);                   // 中序遍历
-    void      clearTree(TreeNode* node);                                           // 递归清空树
+    void       ensureTreap();                           // 不是树堆时切换为树堆并发出树变化信号
 
-    // 平衡相关方法
-    void storeNodesInOrder(TreeNode* node, QVector<int>& values);                     // 按顺序存储节点值
-    TreeNode* buildBalancedTree(QVector<int>& values, int start, int end, int depth); // 构建平衡树
+    // 撤销与重做
+    EditHistory history;   // 撤销、重做历史
+    bool        replaying; // 是否正在执行撤销或重做（此时不再记录）
 
-    // 高度更新方法
-    void updateDepths(TreeNode* node, int depth); // 更新节点深度
-    int  calculateHeight(TreeNode* node);         // 计算树高度
+    bool isRecording() const { return !replaying && history.getBudget() > 0; } // 修改是否需要记录
+    void replay(const EditHistory::Record& record, bool forward);              // 执行一条记录或它的逆操作
 
     // 动画步骤
     void processNextAnimationStep();    // 处理下一个动画步骤
@@ -92,12 +222,26 @@ private:
     void animateInsertion(int value);   // 生成插入动画步骤
     void animateDeletion(int value);    // 生成删除动画步骤
     void animateBalancing();            // 生成平衡动画步骤
-
-    // 查找路径
-    bool findNodeWithPath(TreeNode* node, int value, QVector<int>& path); // 查找节点并记录路径
+    void animateSelect(int k);          // 生成选择动画步骤
 
     QVector<int> currentPath; // 当前动画路径
-    void storeNodesInOrderForAnimation(TreeNode* node, QVector<int>& values); // 为动画按顺序存储节点
+};
+
+/***************************************************************************
+  类名称：BinarySearchTree::BatchGuard
+  功    能：批量修改的作用域守卫
+  说    明：构造时开始批量修改，析构时结束，提前返回时也不会漏掉 endBatch
+***************************************************************************/
+class BinarySearchTree::BatchGuard {
+public:
+    explicit BatchGuard(BinarySearchTree& tree) : tree(tree) { tree.beginBatch(); } // 开始批量修改
+    ~BatchGuard() { tree.endBatch(); }                                              // 结束批量修改
+
+    BatchGuard(const BatchGuard&) = delete;
+    BatchGuard& operator=(const BatchGuard&) = delete;
+
+private:
+    BinarySearchTree& tree; // 被批量修改的树
 };
 
 #endif // BINARYSEARCHTREE_H
\ No newline at end of file
@@ -0,0 +1,147 @@
+﻿/***************************************************************************
+  文件名称：ConcurrentBenchmark.cpp
+  功    能：无锁并发树、按值域分片的树与加锁的 SearchTree 在多线程下的吞吐量对比
+  说    明：命令行程序，CMake 中打开 BSTDISPLAY_BUILD_BENCHMARK 才会构建；
+            用法：ConcurrentBenchmark [最大线程数]，线程数从1开始逐次翻倍（默认为硬件线程数），
+            每个线程数下依次测 100%、90%、50%、0% 查找的操作比例
+***************************************************************************/
+#include <QElapsedTimer>
+#include <QVector>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "ConcurrentTree.h"
+#include "ShardedTree.h"
+#include "SearchTree.h"
+
+const int KeyRange        = 1 << 20; // 键的取值范围 [0, KeyRange)，预先插入一半
+const int OperationsTotal = 4000000; // 每项测试的总操作数，平均分给各线程
+const int ShardCount      = 64;      // 分片树的分片数，按值域均分
+
+/***************************************************************************
+  类名称：LockedTree
+  功    能：用一把互斥锁保护的 AVL 树，作为对比的基准
+  说    明：查找也要加锁，因为 SearchTree 的查找不保证与修改并发安全
+***************************************************************************/
+class LockedTree {
+public:
+    LockedTree() { tree.setBalancePolicy(BalancePolicy::AVL); } // 构造函数
+
+    bool insert(int value)   { std::lock_guard<std::mutex> lock(mutex); return tree.insert(value); }   // 插入
+    bool remove(int value)   { std::lock_guard<std::mutex> lock(mutex); return tree.remove(value); }   // 删除
+    bool contains(int value) { std::lock_guard<std::mutex> lock(mutex); return tree.contains(value); } // 查找
+
+private:
+    std::mutex      mutex; // 保护整棵树的锁
+    SearchTree<int> tree;  // 树本身
+};
+
+/***************************************************************************
+  函数名称：run
+  功    能：多个线程同时对一棵树做混合操作，测量吞吐量
+  输入参数：tree - 被测的树，threadCount - 线程数，readPercent - 查找操作的百分比
+  返 回 值：double - 每秒完成的百万次操作数
+  说    明：先插入一半的键；修改操作中插入与删除各半，树的大小大致保持不变；
+            各线程用不同的随机数种子，等全部线程就绪后同时开始
+***************************************************************************/
+template <typename Tree>
+static double run(Tree& tree, int threadCount, int readPercent) {
+    std::mt19937 generator(2024);
+    std::uniform_int_distribution<int> keys(0, KeyRange - 1);
+    for (int i = 0; i < KeyRange / 2; i++) {
+        tree.insert(keys(generator));
+    }
+
+    std::atomic<int>  ready(0);
+    std::atomic<bool> start(false);
+    std::atomic<int>  hits(0);
+    int operations = OperationsTotal / threadCount;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 local(t + 1);
+            std::uniform_int_distribution<int> localKeys(0, KeyRange - 1);
+            std::uniform_int_distribution<int> percent(0, 99);
+            int found = 0;
+
+            ready.fetch_add(1);
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+
+            for (int i = 0; i < operations; i++) {
+                int key = localKeys(local);
+                int op  = percent(local);
+                if (op < readPercent) {
+                    found += tree.contains(key) ? 1 : 0;
+                }
+                else if ((op - readPercent) % 2 == 0) {
+                    tree.insert(key);
+                }
+                else {
+                    tree.remove(key);
+                }
+            }
+            hits.fetch_add(found);
+        });
+    }
+
+    while (ready.load() < threadCount) {
+        std::this_thread::yield();
+    }
+    QElapsedTimer timer;
+    timer.start();
+    start.store(true);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    qint64 elapsed = std::max<qint64>(timer.nsecsElapsed(), 1);
+
+    return static_cast<double>(operations) * threadCount * 1000.0 / elapsed;
+}
+
+/***************************************************************************
+  函数名称：main
+  功    能：按线程数与读写比例依次测试并输出结果表
+  输入参数：argc, argv - 命令行参数
+  返 回 值：int - 程序退出码
+  说    明：每一格都重新建树；最后两列为无锁树、分片树相对加锁树的倍数
+***************************************************************************/
+int main(int argc, char* argv[]) {
+    int hardware   = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    int maxThreads = argc > 1 ? std::atoi(argv[1]) : hardware;
+    maxThreads = std::max(1, std::min(maxThreads, 256));
+
+    const int readPercents[] = { 100, 90, 50, 0 };
+
+    std::printf("%8s %6s | %12s %12s %12s | %9s %9s\n", "threads", "read%", "lock-free", "sharded", "mutex", "lock-free", "sharded");
+    std::printf("%8s %6s | %38s | %19s\n", "", "", "throughput (Mops/s)", "speedup vs mutex");
+
+    for (int threadCount = 1; threadCount <= maxThreads; threadCount *= 2) {
+        for (int readPercent : readPercents) {
+            double lockFree, sharded, locked;
+            {
+                ConcurrentTree tree;
+                lockFree = run(tree, threadCount, readPercent);
+            }
+            {
+                ShardedTree tree(ShardCount, 0, KeyRange - 1);
+                sharded = run(tree, threadCount, readPercent);
+            }
+            {
+                LockedTree tree;
+                locked = run(tree, threadCount, readPercent);
+            }
+            std::printf("%8d %6d | %12.2f %12.2f %12.2f | %8.2fx %8.2fx\n", threadCount, readPercent,
+                lockFree, sharded, locked, lockFree / locked, sharded / locked);
+        }
+    }
+
+    return 0;
+}
\ No newline at end of file
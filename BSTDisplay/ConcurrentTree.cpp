@@ -0,0 +1,609 @@
+﻿/***************************************************************************
+  文件名称：ConcurrentTree.cpp
+  功    能：无锁并发二叉搜索树的实现文件
+  说    明：孩子指针的最低两位用作标记：第0位为删除标记，第1位为冻结标记，带标记的边不再改变；
+            三个哨兵键大于所有 int，根节点和它的左孩子永远不会被摘除，查找路径总能找到祖先；
+            纪元回收采用三个待回收列表轮换：全局纪元推进到 e 时，纪元 e-2 中摘下的节点已没有线程能访问
+***************************************************************************/
+
+#include "ConcurrentTree.h"
+#include <limits>
+#include <thread>
+#include <vector>
+
+static const quintptr FlagBit = 1;                 // 删除标记：边指向的叶子已被逻辑删除
+static const quintptr TagBit  = 2;                 // 冻结标记：边所在的父节点即将被摘除
+static const quintptr MarkBits = FlagBit | TagBit; // 两个标记位
+
+static const qint64 Infinity0 = static_cast<qint64>(std::numeric_limits<int>::max()) + 1; // 哨兵键，大于所有值
+static const qint64 Infinity1 = Infinity0 + 1;                                             // 哨兵键
+static const qint64 Infinity2 = Infinity0 + 2;                                             // 哨兵键，根节点的键
+
+static const int AdvanceInterval = 64; // 每回收这么多个节点尝试推进一次全局纪元
+
+// 节点：叶子的两个孩子为空；内部节点的左子树键小于自身，右子树键不小于自身
+struct ConcurrentTree::Node {
+    const qint64          key;      // 键（内部节点为路由键）
+    std::atomic<quintptr> child[2]; // 左右孩子指针，低两位为标记
+
+    explicit Node(qint64 key, Node* left = nullptr, Node* right = nullptr) : key(key) {
+        child[0].store(reinterpret_cast<quintptr>(left), std::memory_order_relaxed);
+        child[1].store(reinterpret_cast<quintptr>(right), std::memory_order_relaxed);
+    }
+
+    bool isLeaf() const { return child[0].load(std::memory_order_relaxed) == 0; } // 是否为叶子（叶子的孩子不会改变）
+};
+
+// 查找路径上的四个关键节点：successor 是最后一条没有冻结标记的边指向的节点，ancestor 是它的父节点
+struct ConcurrentTree::SeekRecord {
+    Node*    ancestor;  // 摘除时被修改的节点
+    Node*    successor; // 摘除时被替换的节点
+    Node*    parent;    // 叶子的父节点
+    Node*    leaf;      // 查找到的叶子
+    quintptr leafEdge;  // 父节点指向叶子的边（含标记）
+};
+
+// 线程记录：只有所属线程写 limbo，其他字段供其他线程读取
+struct ConcurrentTree::ThreadRecord {
+    std::atomic<quint64> epoch{0};        // 登记的纪元，0 表示不在访问中
+    std::atomic<quint64> sequence{0};     // 修改序号，修改进行中为奇数
+    std::atomic<bool>    inUse{false};    // 是否被某个线程领取
+    std::vector<Node*>   limbo[3];        // 按摘下时的纪元分组的待回收节点
+    quint64              limboEpoch = 0;  // 上次清理待回收列表时的纪元
+    int                  retired = 0;     // 上次尝试推进纪元以来回收的节点数
+    ThreadRecord*        next = nullptr;  // 记录链表中的下一个
+};
+
+// 纪元与线程记录；线程缓存持有它的弱引用，线程结束时借此归还记录
+struct ConcurrentTree::Domain {
+    const quint64              id;               // 全局唯一的编号，线程缓存据此识别
+    std::atomic<quint64>       epoch{1};         // 全局纪元
+    std::atomic<ThreadRecord*> records{nullptr}; // 线程记录链表，只增不减
+    std::atomic<int>           recordCount{0};   // 线程记录数
+
+    Domain();
+    ~Domain();
+
+    void retire(ThreadRecord* thread, Node* node); // 把摘下的节点放入待回收列表
+    void tryAdvance();                             // 所有访问中的线程都已跟上时推进全局纪元
+};
+
+// 每个线程的记录缓存，线程结束时归还领取的记录
+namespace {
+struct ThreadCacheEntry {
+    quint64             id;     // 树的编号
+    std::weak_ptr<void> owner;  // 树的纪元与线程记录
+    void*               record; // 领取的线程记录
+    std::atomic<bool>*  inUse;  // 线程记录的领取标志
+};
+
+struct ThreadCache {
+    std::vector<ThreadCacheEntry> entries; // 本线程访问过的树
+
+    ~ThreadCache();
+};
+
+thread_local ThreadCache threadCache;     // 本线程的记录缓存
+std::atomic<quint64>     nextDomainId{1}; // 下一棵树的编号
+}
+
+/***************************************************************************
+  函数名称：ThreadCache::~ThreadCache
+  功    能：线程结束时归还线程记录
+  输入参数：
+  返 回 值：
+  说    明：树已析构的记录随树一起释放，不需要归还；记录中的待回收节点留给下一个领取者
+***************************************************************************/
+ThreadCache::~ThreadCache() {
+    for (ThreadCacheEntry& entry : entries) {
+        std::shared_ptr<void> owner = entry.owner.lock();
+        if (owner) {
+            entry.inUse->store(false);
+        }
+    }
+}
+
+/***************************************************************************
+  函数名称：ConcurrentTree::Domain::Domain
+  功    能：构造函数
+  输入参数：
+  返 回 值：
+  说    明：
+***************************************************************************/
+ConcurrentTree::Domain::Domain() :
+    id(nextDomainId.fetch_add(1))
+{
+}
+
+/***************************************************************************
+  函数名称：ConcurrentTree::Domain::~Domain
+  功    能：析构函数，释放线程记录和其中的待回收节点
+  输入参数：
+  返 回 值：
+  说    明：
+***************************************************************************/
+ConcurrentTree::Domain::~Domain() {
+    ThreadRecord* record = records.load();
+    while (record != nullptr) {
+        ThreadRecord* next = record->next;
+        for (std::vector<Node*>& list : record->limbo) {
+            for (Node* node : list) {
+                delete node;
+            }
+        }
+        delete record;
+        record = next;
+    }
+}
+
+/***************************************************************************
+  函数名称：ConcurrentTree::Domain::retire
+  功    能：把摘下的节点放入待回收列表
+  输入参数：thread - 调用线程的记录（已登记纪元），node - 已不可达的节点
+  返 回 值：
+  说    明：节点已摘下，还能访问到它的线程登记的纪元都不大于此时的全局纪元 G，
+            放入 G 对应的列表，全局纪元推进到 G+2 后才会释放
+***************************************************************************/
+void ConcurrentTree::Domain::retire(ThreadRecord* thread, Node* node) {
+    quint64 current = epoch.load();
+    thread->limbo[current % 3].push_back(node);
+
+    if (++thread->retired >= AdvanceInterval) {
+        thread->retired = 0;
+        tryAdvance();
+    }
+}
+
+/***************************************************************************
+  函数名称：ConcurrentTree::Domain::tryAdvance
+  功    能：尝试推进全局纪元
+  输入参数：
+  返 回 值：
+  说    明：只要还有访问中的线程停留在旧纪元就不推进
+***************************************************************************/
+void ConcurrentTree::Domain::tryAdvance() {
+    quint64 current = epoch.load();
+    for (ThreadRecord* record = records.load(); record != nullptr; record = record->next) {
+        quint64 pinned = record->epoch.load();
+        if (pinned != 0 && pinned != current) {
+            return;
+        }
+    }
+    epoch.compare_exchange_strong(current, current + 1);
+}
+
+/***************************************************************************
+  类名称：ConcurrentTree::Guard
+  功    能：登记纪元的作用域守卫
+  说    明：构造时登记当前全局纪元，纪元变化后先释放本线程两个纪元以前摘下的节点；
+            析构时撤销登记
+***************************************************************************/
+class ConcurrentTree::Guard {
+public:
+    Guard(Domain& domain, ThreadRecord* thread) : thread(thread) {
+        quint64 current;
+        do {
+            current = domain.epoch.load();
+            thread->epoch.store(current);
+        } while (domain.epoch.load() != current);
+
+        if (thread->limboEpoch != current) {
+            thread->limboEpoch = current;
+            std::vector<Node*>& expired = thread->limbo[(current + 1) % 3];
+            for (Node* node : expired) {
+                delete node;
+            }
+            expired.clear();
+        }
+    }
+
+    ~Guard() { thread->epoch.store(0, std::memory_order_release); }
+
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+private:
+    ThreadRecord* thread; // 登记的线程记录
+};
+
+/***************************************************************************
+  函数名称：ConcurrentTree::ConcurrentTree
+  功    能：构造函数，建立哨兵节点
+  输入参数：
+  返 回 值：
+  说    明：根 (∞2) 的左孩子为 S (∞1)、右孩子为叶子 ∞2；S 的两个孩子为叶子 ∞0 和 ∞1，
+            真实的值都插在叶子 ∞0 所在的位置
+***************************************************************************/
+ConcurrentTree::ConcurrentTree() :
+    domain(std::make_shared<Domain>())
+{
+    Node* sentinel = new Node(Infinity1, new Node(Infinity0), new Node(Infinity1));
+    root = new Node(Infinity2, sentinel, new Node(Infinity2));
+}
+
+/***************************************************************************
+  函数名称：ConcurrentTree::~ConcurrentTree
+  功    能：析构函数，释放所有节点
+  输入参数：
+  返 回 值：
+  说    明：迭代释放仍然可达的节点（包括打了删除标记还没摘除的叶子），待回收节点随纪元状态释放
+***************************************************************************/
+ConcurrentTree::~ConcurrentTree() {
+    std::vector<Node*> stack;
+    stack.push_back(root);
+    while (!stack.empty()) {
+        Node* node = stack.back();
+        stack.pop_back();
+        for (std::atomic<quintptr>& edge : node->child) {
+            Node* child = reinterpret_cast<Node*>(edge.load() & ~MarkBits);
+            if (child != nullptr) {
+                stack.push_back(child);
+            }
+        }
+        delete node;
+    }
+}
+
+/***************************************************************************
+  函数名称：ConcurrentTree::acquireRecord
+  功    能：取得调用线程的线程记录
+  输入参数：
+  返 回 值：ThreadRecord* - 线程记录
+  说    明：先查本线程的缓存；第一次访问时领取一个空闲记录，没有空闲记录时新建并挂到链表头部
+***************************************************************************/
+ConcurrentTree::ThreadRecord* ConcurrentTree::acquireRecord() const {
+    std::vector<ThreadCacheEntry>& entries = threadCache.entries;
+    for (const ThreadCacheEntry& entry : entries) {
+        if (entry.id == domain->id) {
+            return static_cast<ThreadRecord*>(entry.record);
+        }
+    }
+
+    ThreadRecord* record = nullptr;
+    for (ThreadRecord* candidate = domain->records.load(); candidate != nullptr; candidate = candidate->next) {
+        bool expected = false;
+        if (candidate->inUse.compare_exchange_strong(expected, true)) {
+            record = candidate;
+            break;
+        }
+    }
+
+    if (record == nullptr) {
+        record = new ThreadRecord;
+        record->inUse.store(true);
+        ThreadRecord* head = domain->records.load();
+        do {
+            record->next = head;
+        } while (!domain->records.compare_exchange_weak(head, record));
+        domain->recordCount.fetch_add(1);
+    }
+
+    // 顺便清掉已析构的树的缓存项
+    for (size_t i = 0; i < entries.size(); ) {
+        if (entries[i].owner.expired()) {
+            entries[i] = entries.back();
+            entries.pop_back();
+        }
+        else {
+            i++;
+        }
+    }
+    entries.push_back(ThreadCacheEntry{ domain->id, std::weak_ptr<void>(domain), record, &record->inUse });
+    return record;
+}
+
+/***************************************************************************
+  函数名称：ConcurrentTree::seek
+  功    能：沿查找路径下行到叶子
+  输入参数：key - 要查找的键，record - 用于返回路径上的关键节点
+  返 回 值：
+  说    明：successor 为路径上最后一条没有冻结标记的边指向的节点，
+            从 successor 到 parent 的边都带冻结标记，不会再改变
+***************************************************************************/
+void ConcurrentTree::seek(qint64 key, SeekRecord& record) const {
+    Node* sentinel = reinterpret_cast<Node*>(root->child[0].load(std::memory_order_acquire) & ~MarkBits);
+
+    record.ancestor  = root;
+    record.successor = sentinel;
+    record.parent    = sentinel;
+
+    quintptr parentEdge = sentinel->child[0].load(std::memory_order_acquire);
+    record.leaf = reinterpret_cast<Node*>(parentEdge & ~MarkBits);
+
+    quintptr currentEdge = record.leaf->child[key < record.leaf->key ? 0 : 1].load(std::memory_order_acquire);
+    Node*    current     = reinterpret_cast<Node*>(currentEdge & ~MarkBits);
+
+    while (current != nullptr) {
+        if ((parentEdge & TagBit) == 0) {
+            record.ancestor  = record.parent;
+            record.successor = record.leaf;
+        }
+        record.parent = record.leaf;
+        record.leaf   = current;
+        parentEdge    = currentEdge;
+
+        currentEdge = current->child[key < current->key ? 0 : 1].load(std::memory_order_acquire);
+        current     = reinterpret_cast<Node*>(currentEdge & ~MarkBits);
+    }
+
+    record.leafEdge = parentEdge;
+}
+
+/***************************************************************************
+  函数名称：ConcurrentTree::cleanup
+  功    能：摘除打了删除标记的叶子
+  输入参数：key - 删除的键，record - 查找路径，thread - 调用线程的记录
+  返 回 值：bool - 本线程的 CAS 是否成功摘除了节点
+  说    明：给叶子的兄弟边打冻结标记，再把兄弟（保留其删除标记）接到 ancestor 下替换 successor；
+            键一侧的边没有删除标记时说明是在帮另一侧的删除，保留键一侧；
+            CAS 成功的线程独自负责回收从 successor 到 parent 的内部节点和挂在它们下面被删除的叶子
+***************************************************************************/
+bool ConcurrentTree::cleanup(qint64 key, const SeekRecord& record, ThreadRecord* thread) {
+    Node* ancestor  = record.ancestor;
+    Node* successor = record.successor;
+    Node* parent    = record.parent;
+
+    std::atomic<quintptr>& successorEdge = ancestor->child[key < ancestor->key ? 0 : 1];
+
+    int childSide = key < parent->key ? 0 : 1;
+    std::atomic<quintptr>* siblingEdge = &parent->child[1 - childSide];
+    if ((parent->child[childSide].load() & FlagBit) == 0) {
+        siblingEdge = &parent->child[childSide];
+    }
+
+    siblingEdge->fetch_or(TagBit);
+    quintptr siblingValue = siblingEdge->load();
+    Node*    kept         = reinterpret_cast<Node*>(siblingValue & ~MarkBits);
+
+    quintptr expected = reinterpret_cast<quintptr>(successor);
+    if (!successorEdge.compare_exchange_strong(expected, reinterpret_cast<quintptr>(kept) | (siblingValue & FlagBit))) {
+        return false;
+    }
+
+    // 摘下的链上每个内部节点另一侧都是被删除的叶子
+    Node* node = successor;
+    while (node != parent) {
+        int   side = key < node->key ? 0 : 1;
+        Node* next = reinterpret_cast<Node*>(node->child[side].load() & ~MarkBits);
+        domain->retire(thread, reinterpret_cast<Node*>(node->child[1 - side].load() & ~MarkBits));
+        domain->retire(thread, node);
+        node = next;
+    }
+
+    Node* left = reinterpret_cast<Node*>(parent->child[0].load() & ~MarkBits);
+    domain->retire(thread, left == kept ? reinterpret_cast<Node*>(parent->child[1].load() & ~MarkBits) : left);
+    domain->retire(thread, parent);
+    return true;
+}
+
+/***************************************************************************
+  函数名称：ConcurrentTree::insert
+  功    能：插入值
+  输入参数：value - 要插入的值
+  返 回 值：bool - 是否插入（值已存在时返回false）
+  说    明：用新的内部节点（孩子为原叶子和新叶子）替换父节点指向叶子的边；
+            边带标记时先帮忙完成那次删除再重试；失败重试时复用已分配的节点
+***************************************************************************/
+bool ConcurrentTree::insert(int value) {
+    ThreadRecord* thread = acquireRecord();
+    Guard guard(*domain, thread);
+    thread->sequence.store(thread->sequence.load(std::memory_order_relaxed) + 1);
+
+    qint64     key = value;
+    Node*      newLeaf     = nullptr;
+    Node*      newInternal = nullptr;
+    SeekRecord record;
+    bool       inserted;
+
+    for (;;) {
+        seek(key, record);
+        Node* leaf = record.leaf;
+
+        if (leaf->key == key) {
+            if ((record.leafEdge & FlagBit) == 0) {
+                inserted = false;
+                break;
+            }
+            cleanup(key, record, thread);
+            continue;
+        }
+
+        if (newLeaf == nullptr) {
+            newLeaf = new Node(key);
+        }
+        delete newInternal;
+        newInternal = key < leaf->key ? new Node(leaf->key, newLeaf, leaf) : new Node(key, leaf, newLeaf);
+
+        Node*                  parent    = record.parent;
+        std::atomic<quintptr>& childEdge = parent->child[key < parent->key ? 0 : 1];
+        quintptr               expected  = reinterpret_cast<quintptr>(leaf);
+        if (childEdge.compare_exchange_strong(expected, reinterpret_cast<quintptr>(newInternal))) {
+            newLeaf     = nullptr;
+            newInternal = nullptr;
+            inserted    = true;
+            break;
+        }
+
+        if ((expected & ~MarkBits) == reinterpret_cast<quintptr>(leaf) && (expected & MarkBits) != 0) {
+            cleanup(key, record, thread);
+        }
+    }
+
+    delete newLeaf;
+    delete newInternal;
+    thread->sequence.store(thread->sequence.load(std::memory_order_relaxed) + 1);
+    return inserted;
+}
+
+/***************************************************************************
+  函数名称：ConcurrentTree::remove
+  功    能：删除值
+  输入参数：value - 要删除的值
+  返 回 值：bool - 是否删除（值不存在时返回false）
+  说    明：注入阶段给指向叶子的边打删除标记，这一步即为删除生效的时刻；
+            清理阶段反复尝试摘除，直到本线程摘除成功或发现叶子已被其他线程帮忙摘除
+***************************************************************************/
+bool ConcurrentTree::remove(int value) {
+    ThreadRecord* thread = acquireRecord();
+    Guard guard(*domain, thread);
+    thread->sequence.store(thread->sequence.load(std::memory_order_relaxed) + 1);
+
+    qint64     key    = value;
+    Node*      target = nullptr;
+    SeekRecord record;
+    bool       removed;
+
+    for (;;) {
+        seek(key, record);
+
+        if (target == nullptr) {
+            Node* leaf = record.leaf;
+            if (leaf->key != key) {
+                removed = false;
+                break;
+            }
+
+            Node*                  parent    = record.parent;
+            std::atomic<quintptr>& childEdge = parent->child[key < parent->key ? 0 : 1];
+            quintptr               expected  = reinterpret_cast<quintptr>(leaf);
+            if (childEdge.compare_exchange_strong(expected, reinterpret_cast<quintptr>(leaf) | FlagBit)) {
+                target = leaf;
+                if (cleanup(key, record, thread)) {
+                    removed = true;
+                    break;
+                }
+            }
+            else if ((expected & ~MarkBits) == reinterpret_cast<quintptr>(leaf) && (expected & MarkBits) != 0) {
+                cleanup(key, record, thread);
+            }
+        }
+        else {
+            if (record.leaf != target || cleanup(key, record, thread)) {
+                removed = true;
+                break;
+            }
+        }
+    }
+
+    thread->sequence.store(thread->sequence.load(std::memory_order_relaxed) + 1);
+    return removed;
+}
+
+/***************************************************************************
+  函数名称：ConcurrentTree::contains
+  功    能：值是否在树中
+  输入参数：value - 要查找的值
+  返 回 值：bool - 是否找到
+  说    明：只读下行到叶子，不写任何共享数据；打了删除标记的叶子视为已删除
+***************************************************************************/
+bool ConcurrentTree::contains(int value) const {
+    ThreadRecord* thread = acquireRecord();
+    Guard guard(*domain, thread);
+
+    qint64   key  = value;
+    quintptr edge = root->child[0].load(std::memory_order_acquire);
+    Node*    node = reinterpret_cast<Node*>(edge & ~MarkBits);
+    while (!node->isLeaf()) {
+        edge = node->child[key < node->key ? 0 : 1].load(std::memory_order_acquire);
+        node = reinterpret_cast<Node*>(edge & ~MarkBits);
+    }
+    return node->key == key && (edge & FlagBit) == 0;
+}
+
+/***************************************************************************
+  函数名称：ConcurrentTree::collect
+  功    能：中序取出没有删除标记的叶子
+  输入参数：values - 用于返回有序的值
+  返 回 值：
+  说    明：调用者须已登记纪元；用显式栈遍历，跳过哨兵叶子
+***************************************************************************/
+void ConcurrentTree::collect(QVector<int>& values) const {
+    values.clear();
+
+    std::vector<quintptr> stack;
+    stack.push_back(root->child[0].load(std::memory_order_acquire));
+    while (!stack.empty()) {
+        quintptr edge = stack.back();
+        stack.pop_back();
+
+        Node* node = reinterpret_cast<Node*>(edge & ~MarkBits);
+        if (node->isLeaf()) {
+            if ((edge & FlagBit) == 0 && node->key < Infinity0) {
+                values.append(static_cast<int>(node->key));
+            }
+            continue;
+        }
+        stack.push_back(node->child[1].load(std::memory_order_acquire));
+        stack.push_back(node->child[0].load(std::memory_order_acquire));
+    }
+}
+
+/***************************************************************************
+  函数名称：ConcurrentTree::readSequences
+  功    能：读取各线程的修改序号
+  输入参数：sequences - 用于返回按记录链表顺序排列的序号
+  返 回 值：bool - 没有修改正在进行时返回true
+  说    明：
+***************************************************************************/
+bool ConcurrentTree::readSequences(QVector<quint64>& sequences) const {
+    sequences.clear();
+    for (ThreadRecord* record = domain->records.load(); record != nullptr; record = record->next) {
+        quint64 sequence = record->sequence.load();
+        if (sequence % 2 != 0) {
+            return false;
+        }
+        sequences.append(sequence);
+    }
+    return true;
+}
+
+/***************************************************************************
+  函数名称：ConcurrentTree::snapshot
+  功    能：有序取出全部值
+  输入参数：values - 用于返回有序的值
+  返 回 值：bool - 是否为一致快照
+  说    明：采集前后各读一次所有线程的修改序号，两次相同且期间没有修改进行中，
+            说明采集到的正是某一时刻的内容；最多尝试 SnapshotAttempts 次，
+            仍不成功时返回最后一次的弱一致结果
+***************************************************************************/
+bool ConcurrentTree::snapshot(QVector<int>& values) const {
+    ThreadRecord* thread = acquireRecord();
+    Guard guard(*domain, thread);
+
+    QVector<quint64> before, after;
+    for (int attempt = 0; attempt < SnapshotAttempts; attempt++) {
+        if (!readSequences(before)) {
+            std::this_thread::yield();
+            continue;
+        }
+        collect(values);
+        if (readSequences(after) && before == after) {
+            return true;
+        }
+    }
+
+    collect(values);
+    return false;
+}
+
+/***************************************************************************
+  函数名称：ConcurrentTree::getEpoch
+  功    能：获取当前全局纪元
+  输入参数：
+  返 回 值：quint64 - 全局纪元
+  说    明：
+***************************************************************************/
+quint64 ConcurrentTree::getEpoch() const {
+    return domain->epoch.load();
+}
+
+/***************************************************************************
+  函数名称：ConcurrentTree::getThreadRecords
+  功    能：获取已创建的线程记录数
+  输入参数：
+  返 回 值：int - 线程记录数
+  说    明：线程结束后记录会被后来的线程复用，记录数不超过同时访问的线程数的峰值
+***************************************************************************/
+int ConcurrentTree::getThreadRecords() const {
+    return domain->recordCount.load();
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+﻿/***************************************************************************
+  文件名称：ConcurrentTree.h
+  功    能：无锁并发二叉搜索树的声明文件
+  说    明：Natarajan–Mittal 外部二叉搜索树：值只存在叶子中，内部节点只作路由；
+            删除先给指向叶子的边打删除标记（flag），再给兄弟边打冻结标记（tag），
+            最后用一次 CAS 把兄弟提升到祖先下面，任何线程遇到标记都可以帮忙完成；
+            摘下的节点按纪元回收，读者在访问期间登记纪元，不需要任何锁
+***************************************************************************/
+
+#ifndef CONCURRENTTREE_H
+#define CONCURRENTTREE_H
+
+#include <atomic>
+#include <memory>
+#include <QVector>
+
+/***************************************************************************
+  类名称：ConcurrentTree
+  功    能：多线程同时插入、删除、查找的整数集合
+  说    明：接口与 BinarySearchTree 的 insert/remove/contains 相同，可以在任意线程上调用；
+            每个线程第一次访问某棵树时领取一个线程记录，线程结束时归还；
+            快照用双重采集校验：采集前后各线程的修改序号都没有变化才算一致，
+            写入持续不断时退化为弱一致（采集期间一直存在的值一定在内，一直不存在的一定不在）；
+            析构时不能有其他线程仍在访问
+***************************************************************************/
+class ConcurrentTree {
+public:
+    ConcurrentTree();  // 构造函数
+    ~ConcurrentTree(); // 析构函数，释放所有节点
+
+    ConcurrentTree(const ConcurrentTree&) = delete;
+    ConcurrentTree& operator=(const ConcurrentTree&) = delete;
+
+    bool insert(int value);         // 插入，值已存在时返回false
+    bool remove(int value);         // 删除，值不存在时返回false
+    bool contains(int value) const; // 值是否在树中
+
+    bool    snapshot(QVector<int>& values) const; // 有序取出全部值，返回是否为一致快照
+    quint64 getEpoch() const;                     // 当前全局纪元
+    int     getThreadRecords() const;             // 已创建的线程记录数
+
+    static const int SnapshotAttempts = 16; // 一致快照的最多尝试次数
+
+private:
+    struct Node;         // 节点
+    struct SeekRecord;   // 查找路径上的四个关键节点
+    struct ThreadRecord; // 线程记录：登记的纪元、修改序号和待回收节点
+    struct Domain;       // 纪元与线程记录，与各线程的缓存共同持有
+    class  Guard;        // 登记纪元的作用域守卫
+
+    Node*                   root;   // 哨兵根节点
+    std::shared_ptr<Domain> domain; // 纪元与线程记录
+
+    ThreadRecord* acquireRecord() const;                                               // 取得调用线程的线程记录
+    void          seek(qint64 key, SeekRecord& record) const;                          // 沿查找路径下行到叶子
+    bool          cleanup(qint64 key, const SeekRecord& record, ThreadRecord* thread); // 摘除打了删除标记的叶子
+    void          collect(QVector<int>& values) const;                                 // 中序取出没有删除标记的叶子
+    bool          readSequences(QVector<quint64>& sequences) const;                    // 读取各线程的修改序号，有修改进行中时返回false
+};
+
+#endif // CONCURRENTTREE_H
\ No newline at end of file
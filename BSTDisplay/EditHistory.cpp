@@ -0,0 +1,182 @@
+﻿/***************************************************************************
+  文件名称：EditHistory.cpp
+  功    能：撤销、重做历史的实现文件
+  说    明：
+***************************************************************************/
+
+#include "EditHistory.h"
+
+/***************************************************************************
+  函数名称：EditHistory::Record::getBytes
+  功    能：计算记录占用的内存字节数
+  输入参数：
+  返 回 值：qint64 - 字节数
+  说    明：记录本身加上两段编码后的有序值
+***************************************************************************/
+qint64 EditHistory::Record::getBytes() const {
+    return static_cast<qint64>(sizeof(Record)) + removed.size() + added.size();
+}
+
+/***************************************************************************
+  函数名称：EditHistory::EditHistory
+  功    能：构造函数，创建空历史
+  输入参数：budget - 内存上限（字节）
+  返 回 值：
+  说    明：
+***************************************************************************/
+EditHistory::EditHistory(qint64 budget) :
+    budget(budget), bytesUsed(0)
+{
+}
+
+/***************************************************************************
+  函数名称：EditHistory::push
+  功    能：记录一次新的修改
+  输入参数：record - 修改记录
+  返 回 值：
+  说    明：新的修改之后原有的重做分支不再有效，清空重做栈；
+            单条记录就超过上限时它自己也会被丢弃，这次修改无法撤销
+***************************************************************************/
+void EditHistory::push(const Record& record) {
+    for (const Record& dropped : redoStack) {
+        bytesUsed -= dropped.getBytes();
+    }
+    redoStack.clear();
+
+    undoStack.append(record);
+    bytesUsed += record.getBytes();
+    trim();
+}
+
+/***************************************************************************
+  函数名称：EditHistory::undo
+  功    能：取出最近一次修改
+  输入参数：record - 用于返回修改记录
+  返 回 值：bool - 是否有可撤销的修改
+  说    明：记录移入重做栈，占用的内存不变
+***************************************************************************/
+bool EditHistory::undo(Record& record) {
+    if (undoStack.isEmpty()) {
+        return false;
+    }
+
+    record = undoStack.takeLast();
+    redoStack.append(record);
+    return true;
+}
+
+/***************************************************************************
+  函数名称：EditHistory::redo
+  功    能：取出最近一次撤销的修改
+  输入参数：record - 用于返回修改记录
+  返 回 值：bool - 是否有可重做的修改
+  说    明：记录移回撤销栈，占用的内存不变
+***************************************************************************/
+bool EditHistory::redo(Record& record) {
+    if (redoStack.isEmpty()) {
+        return false;
+    }
+
+    record = redoStack.takeLast();
+    undoStack.append(record);
+    return true;
+}
+
+/***************************************************************************
+  函数名称：EditHistory::clear
+  功    能：清空历史
+  输入参数：
+  返 回 值：
+  说    明：
+***************************************************************************/
+void EditHistory::clear() {
+    undoStack.clear();
+    redoStack.clear();
+    bytesUsed = 0;
+}
+
+/***************************************************************************
+  函数名称：EditHistory::setBudget
+  功    能：设置历史的内存上限
+  输入参数：bytes - 内存上限（字节），为0时不再保留历史
+  返 回 值：
+  说    明：上限降低后立即丢弃超出的旧记录
+***************************************************************************/
+void EditHistory::setBudget(qint64 bytes) {
+    budget = bytes > 0 ? bytes : 0;
+    trim();
+}
+
+/***************************************************************************
+  函数名称：EditHistory::trim
+  功    能：超出内存上限时丢弃最早的记录
+  输入参数：
+  返 回 值：
+  说    明：先丢弃撤销栈底部最早的修改，仍然超出时再丢弃重做栈底部最远的修改
+***************************************************************************/
+void EditHistory::trim() {
+    while (bytesUsed > budget && !undoStack.isEmpty()) {
+        bytesUsed -= undoStack.takeFirst().getBytes();
+    }
+    while (bytesUsed > budget && !redoStack.isEmpty()) {
+        bytesUsed -= redoStack.takeFirst().getBytes();
+    }
+}
+
+/***************************************************************************
+  函数名称：EditHistory::packValues
+  功    能：把有序值差分后编码
+  输入参数：sortedValues - 从小到大排列的值（可以重复）
+  返 回 值：QByteArray - 编码结果
+  说    明：翻转符号位把 int 保序地映射为无符号数，相邻两值的差按每字节7位的变长整数存放，
+            稠密的值每个只占1字节；解码时依次累加
+***************************************************************************/
+QByteArray EditHistory::packValues(const QVector<int>& sortedValues) {
+    QByteArray data;
+    data.reserve(sortedValues.size() + 8);
+
+    quint32 previous = 0;
+    for (int value : sortedValues) {
+        quint32 current = static_cast<quint32>(value) ^ 0x80000000u;
+        quint32 delta   = current - previous;
+        previous = current;
+
+        while (delta >= 0x80) {
+            data.append(static_cast<char>((delta & 0x7f) | 0x80));
+            delta >>= 7;
+        }
+        data.append(static_cast<char>(delta));
+    }
+
+    return data;
+}
+
+/***************************************************************************
+  函数名称：EditHistory::unpackValues
+  功    能：解码出有序值
+  输入参数：data - packValues 的编码结果
+  返 回 值：QVector<int> - 从小到大排列的值
+  说    明：
+***************************************************************************/
+QVector<int> EditHistory::unpackValues(const QByteArray& data) {
+    QVector<int> values;
+    values.reserve(data.size());
+
+    quint32 previous = 0;
+    int     position = 0;
+    while (position < data.size()) {
+        quint32 delta = 0;
+        int     shift = 0;
+        quint8  byte;
+        do {
+            byte   = static_cast<quint8>(data[position++]);
+            delta |= static_cast<quint32>(byte & 0x7f) << shift;
+            shift += 7;
+        } while ((byte & 0x80) && position < data.size());
+
+        previous += delta;
+        values.append(static_cast<int>(previous ^ 0x80000000u));
+    }
+
+    return values;
+}
\ No newline at end of file
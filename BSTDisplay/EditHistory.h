@@ -0,0 +1,73 @@
+﻿/***************************************************************************
+  文件名称：EditHistory.h
+  功    能：撤销、重做历史的声明文件
+  说    明：按操作记录每次修改，撤销时执行它的逆操作，不保存整棵树；
+            单个值的插入、删除只记这个值，整体替换、批量插入和范围删除各记一条，
+            附带被移走或新增的有序值，差分后按变长整数编码；
+            历史占用的内存超过上限时从最早的记录开始丢弃
+***************************************************************************/
+
+#ifndef EDITHISTORY_H
+#define EDITHISTORY_H
+
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+
+/***************************************************************************
+  类名称：EditHistory
+  功    能：撤销栈与重做栈
+  说    明：只负责保存记录，逆操作由 BinarySearchTree 执行；
+            新的修改清空重做栈，撤销把记录移入重做栈，重做再移回撤销栈
+***************************************************************************/
+class EditHistory {
+public:
+    // 一次修改
+    struct Record {
+        enum class Kind : quint8 {
+            Insert,      // 插入值 low，逆操作为删除
+            Remove,      // 删除值 low，逆操作为插入
+            Replace,     // 整体替换（清空、用一组值构建、复制）：removed 为原内容，added 为新内容
+            InsertBatch, // 批量插入：added 为实际新增的值，逆操作为逐个删除
+            EraseRange   // 删除 [low, high] 内的值：removed 为被删除的值，逆操作为批量插入
+        };
+
+        Kind       kind = Kind::Insert; // 修改类型
+        int        low  = 0;            // 插入或删除的值，范围删除的下界
+        int        high = 0;            // 范围删除的上界
+        QByteArray removed;             // 被移走的有序值（编码后）
+        QByteArray added;               // 新增的有序值（编码后）
+
+        qint64 getBytes() const; // 记录占用的内存字节数
+    };
+
+    explicit EditHistory(qint64 budget = DefaultBudget); // 构造函数
+
+    void push(const Record& record); // 记录一次新的修改，清空重做栈
+    bool undo(Record& record);       // 取出最近一次修改，移入重做栈
+    bool redo(Record& record);       // 取出最近一次撤销的修改，移回撤销栈
+    void clear();                    // 清空历史
+
+    bool   canUndo() const       { return !undoStack.isEmpty(); } // 是否可以撤销
+    bool   canRedo() const       { return !redoStack.isEmpty(); } // 是否可以重做
+    int    getUndoCount() const  { return undoStack.size(); }     // 可撤销的步数
+    int    getRedoCount() const  { return redoStack.size(); }     // 可重做的步数
+    qint64 getBytesUsed() const  { return bytesUsed; }            // 历史占用的内存字节数
+    qint64 getBudget() const     { return budget; }               // 内存上限
+    void   setBudget(qint64 bytes);                               // 设置内存上限，超出的旧记录被丢弃
+
+    static QByteArray   packValues(const QVector<int>& sortedValues); // 有序值差分后编码
+    static QVector<int> unpackValues(const QByteArray& data);         // 解码出有序值
+
+    static const qint64 DefaultBudget = 8 * 1024 * 1024; // 默认内存上限（字节）
+
+private:
+    QList<Record> undoStack; // 撤销栈，最近的修改在末尾
+    QList<Record> redoStack; // 重做栈，最近撤销的修改在末尾
+    qint64        budget;    // 内存上限
+    qint64        bytesUsed; // 两个栈中记录占用的内存
+
+    void trim(); // 超出上限时丢弃最早的记录
+};
+
+#endif // EDITHISTORY_H
\ No newline at end of file
@@ -0,0 +1,112 @@
+﻿/***************************************************************************
+  文件名称：KeyTraits.h
+  功    能：树的键类型特性
+  说    明：KeyTraits 给出键的显示文本和散列值，KeyOrder 包装比较器；
+            算术类型的键在编译期选用按值传递、直接比较的版本，其他类型按引用传递并调用比较器
+***************************************************************************/
+
+#ifndef KEYTRAITS_H
+#define KEYTRAITS_H
+
+#include <QString>
+#include <QDebug>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+
+/***************************************************************************
+  类名称：KeyTraits
+  功    能：键的显示与散列
+  说    明：通用版本用 QDebug 输出显示文本、用 std::hash 求散列值；
+            算术类型、QString 和 std::string 另有特化；其他键类型可以自行特化
+***************************************************************************/
+template <typename Key, typename Enable = void>
+struct KeyTraits {
+    static QString toString(const Key& key) {
+        QString text;
+        QDebug(&text).noquote().nospace() << key;
+        return text;
+    }
+
+    static quint64 hash(const Key& key) {
+        return static_cast<quint64>(std::hash<Key>()(key));
+    }
+};
+
+// 算术类型：数字直接转为文本，散列值即数值本身的位模式，之后再统一混合
+template <typename Key>
+struct KeyTraits<Key, typename std::enable_if<std::is_arithmetic<Key>::value>::type> {
+    static QString toString(Key key) {
+        return QString::number(key);
+    }
+
+    static quint64 hash(Key key) {
+        quint64 bits = 0;
+        std::memcpy(&bits, &key, sizeof(Key) < sizeof(bits) ? sizeof(Key) : sizeof(bits));
+        return bits;
+    }
+};
+
+template <>
+struct KeyTraits<QString> {
+    static QString toString(const QString& key) {
+        return key;
+    }
+
+    static quint64 hash(const QString& key) {
+        return static_cast<quint64>(qHash(key));
+    }
+};
+
+template <>
+struct KeyTraits<std::string> {
+    static QString toString(const std::string& key) {
+        return QString::fromStdString(key);
+    }
+
+    static quint64 hash(const std::string& key) {
+        return static_cast<quint64>(std::hash<std::string>()(key));
+    }
+};
+
+/***************************************************************************
+  类名称：KeyOrder
+  功    能：键的比较
+  说    明：compare 返回负数、0、正数分别表示小于、等于、大于，查找循环只比较一次即可决定方向；
+            通用版本持有比较器，键按引用传递，等于即“互不小于”
+***************************************************************************/
+template <typename Key, typename Compare,
+          bool Arithmetic = std::is_arithmetic<Key>::value && std::is_same<Compare, std::less<Key>>::value>
+class KeyOrder {
+public:
+    typedef const Key& Arg; // 参数传递方式
+
+    explicit KeyOrder(const Compare& comparator = Compare()) : comparator(comparator) {}
+
+    bool less(Arg a, Arg b) const { return comparator(a, b); }                                    // a 是否小于 b
+    int  compare(Arg a, Arg b) const { return comparator(a, b) ? -1 : (comparator(b, a) ? 1 : 0); } // 三路比较
+
+private:
+    Compare comparator; // 比较器
+};
+
+/***************************************************************************
+  类名称：KeyOrder（算术类型特化）
+  功    能：算术类型按 std::less 比较
+  说    明：键按值传递，不经比较器间接调用；三路比较先判相等，查找循环编译后与手写的整数比较相同；
+            树的下降是指针追逐，改成条件传送反而使预测执行无法提前取下一层节点，
+            实测比带分支的版本慢，无分支查找留给 SnapshotIndex 的连续数组
+***************************************************************************/
+template <typename Key, typename Compare>
+class KeyOrder<Key, Compare, true> {
+public:
+    typedef Key Arg; // 参数传递方式
+
+    explicit KeyOrder(const Compare& = Compare()) {}
+
+    bool less(Key a, Key b) const { return a < b; }                            // a 是否小于 b
+    int  compare(Key a, Key b) const { return a == b ? 0 : (a < b ? -1 : 1); } // 三路比较
+};
+
+#endif // KEYTRAITS_H
\ No newline at end of file
@@ -0,0 +1,254 @@
+﻿/***************************************************************************
+  文件名称：LearnedIndex.cpp
+  功    能：学习型索引快照的实现文件
+  说    明：
+***************************************************************************/
+
+#include "LearnedIndex.h"
+#include <QVarLengthArray>
+#include <algorithm>
+#include <cmath>
+
+const int LeafTargetSize = 64; // 平均每个叶子模型负责的值个数
+
+/***************************************************************************
+  函数名称：fitLine
+  功    能：对一段有序值做最小二乘直线拟合
+  输入参数：keys - 有序值，start, end - 拟合的范围 [start, end)，scale - 位置的缩放系数，
+            slope, intercept - 用于返回拟合结果（位置 ≈ slope * 值 + intercept）
+  返 回 值：
+  说    明：先求均值再求协方差，两遍扫描，避免大数相减的精度损失；
+            值全相同时斜率为0，截距取平均位置
+***************************************************************************/
+static void fitLine(const std::vector<int>& keys, int start, int end, double scale, double& slope, double& intercept) {
+    const double count = end - start;
+    double meanKey = 0, meanPosition = 0;
+    for (int i = start; i < end; i++) {
+        meanKey      += keys[i];
+        meanPosition += i;
+    }
+    meanKey      /= count;
+    meanPosition  = meanPosition / count * scale;
+
+    double covariance = 0, variance = 0;
+    for (int i = start; i < end; i++) {
+        double dx = keys[i] - meanKey;
+        covariance += dx * (i * scale - meanPosition);
+        variance   += dx * dx;
+    }
+
+    slope     = variance > 0 ? covariance / variance : 0;
+    intercept = meanPosition - slope * meanKey;
+}
+
+/***************************************************************************
+  函数名称：LearnedIndex::LearnedIndex
+  功    能：构造函数，创建空索引
+  输入参数：
+  返 回 值：
+  说    明：
+***************************************************************************/
+LearnedIndex::LearnedIndex() :
+    rootSlope(0), rootIntercept(0)
+{
+}
+
+/***************************************************************************
+  函数名称：LearnedIndex::build
+  功    能：按中序取出树的内容并训练模型
+  输入参数：pool - 节点内存池，root - 树的根节点下标，count - 树的节点数
+  返 回 值：
+  说    明：根模型把位置缩放到 [0, 叶子数) 后拟合；按根模型把各值分到叶子，
+            值有序且根模型单调，各叶子的段依次相连，空叶子的段长度为0、位于下一段的起点；
+            最后逐个叶子拟合，整体 O(n)
+***************************************************************************/
+void LearnedIndex::build(const NodePool& pool, NodeIndex root, int count) {
+    clear();
+    keys.reserve(count);
+
+    QVarLengthArray<NodeIndex, 64> stack;
+    NodeIndex node = root;
+    while (node != NullNode || !stack.isEmpty()) {
+        while (node != NullNode) {
+            stack.append(node);
+            node = pool[node].left;
+        }
+
+        node = stack.last();
+        stack.removeLast();
+        keys.push_back(pool[node].key);
+        node = pool[node].right;
+    }
+
+    if (keys.empty()) {
+        return;
+    }
+
+    const int leafCount = std::max(1, count / LeafTargetSize);
+    fitLine(keys, 0, count, static_cast<double>(leafCount) / count, rootSlope, rootIntercept);
+
+    leaves.assign(leafCount, Leaf());
+    int position = 0;
+    for (int i = 0; i < leafCount; i++) {
+        leaves[i].start = position;
+        while (position < count && leafOf(keys[position]) == i) {
+            position++;
+        }
+        leaves[i].end = position;
+        fitLeaf(leaves[i]);
+    }
+}
+
+/***************************************************************************
+  函数名称：LearnedIndex::fitLeaf
+  功    能：在叶子负责的一段上拟合并计算偏差
+  输入参数：leaf - 叶子模型，start 和 end 已设置
+  返 回 值：
+  说    明：偏差用与查找时相同的 predict 计算，保证段内每个值的实际位置都落在预测范围内
+***************************************************************************/
+void LearnedIndex::fitLeaf(Leaf& leaf) {
+    leaf.slope     = 0;
+    leaf.intercept = leaf.start;
+    leaf.errorLow  = 0;
+    leaf.errorHigh = 0;
+    if (leaf.start == leaf.end) {
+        return;
+    }
+
+    fitLine(keys, leaf.start, leaf.end, 1.0, leaf.slope, leaf.intercept);
+
+    leaf.errorLow  = leaf.end;
+    leaf.errorHigh = -leaf.end;
+    for (int i = leaf.start; i < leaf.end; i++) {
+        int error = static_cast<int>(i - predict(leaf, keys[i]));
+        leaf.errorLow  = std::min(leaf.errorLow, error);
+        leaf.errorHigh = std::max(leaf.errorHigh, error);
+    }
+}
+
+/***************************************************************************
+  函数名称：LearnedIndex::clear
+  功    能：清空索引
+  输入参数：
+  返 回 值：
+  说    明：整块归还数组内存
+***************************************************************************/
+void LearnedIndex::clear() {
+    std::vector<int>().swap(keys);
+    std::vector<Leaf>().swap(leaves);
+    rootSlope     = 0;
+    rootIntercept = 0;
+}
+
+/***************************************************************************
+  函数名称：LearnedIndex::getMaxError
+  功    能：获取叶子模型的最大预测偏差
+  输入参数：
+  返 回 值：int - 各叶子中 errorHigh - errorLow 的最大值，即局部查找的最大范围
+  说    明：
+***************************************************************************/
+int LearnedIndex::getMaxError() const {
+    int maxError = 0;
+    for (const Leaf& leaf : leaves) {
+        maxError = std::max(maxError, leaf.errorHigh - leaf.errorLow);
+    }
+    return maxError;
+}
+
+/***************************************************************************
+  函数名称：LearnedIndex::getBytesReserved
+  功    能：获取索引占用的内存字节数
+  输入参数：
+  返 回 值：qint64 - 字节数
+  说    明：
+***************************************************************************/
+qint64 LearnedIndex::getBytesReserved() const {
+    return static_cast<qint64>(keys.capacity()) * static_cast<qint64>(sizeof(int)) +
+        static_cast<qint64>(leaves.capacity()) * static_cast<qint64>(sizeof(Leaf));
+}
+
+/***************************************************************************
+  函数名称：LearnedIndex::leafOf
+  功    能：根模型：计算值所属的叶子序号
+  输入参数：value - 值
+  返 回 值：int - 叶子序号，截断到 [0, 叶子数)
+  说    明：斜率非负，序号随值单调不减
+***************************************************************************/
+int LearnedIndex::leafOf(int value) const {
+    double predicted = std::floor(rootSlope * value + rootIntercept);
+    const double last = static_cast<double>(leaves.size() - 1);
+    return static_cast<int>(std::max(0.0, std::min(predicted, last)));
+}
+
+/***************************************************************************
+  函数名称：LearnedIndex::predict
+  功    能：叶子模型：预测值在有序数组中的位置
+  输入参数：leaf - 叶子模型，value - 值
+  返 回 值：qint64 - 预测位置（未截断）
+  说    明：
+***************************************************************************/
+qint64 LearnedIndex::predict(const Leaf& leaf, int value) const {
+    return static_cast<qint64>(std::floor(leaf.slope * value + leaf.intercept));
+}
+
+/***************************************************************************
+  函数名称：LearnedIndex::lowerBound
+  功    能：查找第一个不小于 value 的位置
+  输入参数：value - 要查找的值
+  返 回 值：int - 位置，等于小于 value 的值的个数
+  说    明：根模型单调，小于 value 的叶子里的值都更小、更大的叶子里的值都更大，答案一定在所属叶子的
+            [start, end] 内；先在预测位置加减偏差的小范围内二分，
+            value 不在索引中时预测可能越出这个范围，检查两端不满足再退回整段二分
+***************************************************************************/
+int LearnedIndex::lowerBound(int value) const {
+    if (keys.empty()) {
+        return 0;
+    }
+
+    const Leaf& leaf = leaves[leafOf(value)];
+    if (leaf.start == leaf.end) {
+        return leaf.start;
+    }
+
+    qint64 predicted = predict(leaf, value);
+    qint64 low  = std::max<qint64>(leaf.start, std::min<qint64>(leaf.end, predicted + leaf.errorLow));
+    qint64 high = std::max<qint64>(leaf.start, std::min<qint64>(leaf.end, predicted + leaf.errorHigh + 1));
+
+    const int* base = keys.data();
+    int position = static_cast<int>(std::lower_bound(base + low, base + high, value) - base);
+
+    bool tooFar   = position > leaf.start && base[position - 1] >= value;
+    bool tooClose = position < leaf.end && base[position] < value;
+    if (tooFar || tooClose) {
+        position = static_cast<int>(std::lower_bound(base + leaf.start, base + leaf.end, value) - base);
+    }
+    return position;
+}
+
+/***************************************************************************
+  函数名称：LearnedIndex::contains
+  功    能：检查值是否在索引中
+  输入参数：value - 要查找的值
+  返 回 值：bool - 是否存在
+  说    明：
+***************************************************************************/
+bool LearnedIndex::contains(int value) const {
+    int position = lowerBound(value);
+    return position < size() && keys[position] == value;
+}
+
+/***************************************************************************
+  函数名称：LearnedIndex::valueAt
+  功    能：获取有序数组中某个位置的值
+  输入参数：position - 位置（从0开始），value - 用于返回值
+  返 回 值：bool - 位置是否有效
+  说    明：
+***************************************************************************/
+bool LearnedIndex::valueAt(int position, int& value) const {
+    if (position < 0 || position >= size()) {
+        return false;
+    }
+
+    value = keys[position];
+    return true;
+}
\ No newline at end of file
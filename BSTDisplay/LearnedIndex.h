@@ -0,0 +1,60 @@
+﻿/***************************************************************************
+  文件名称：LearnedIndex.h
+  功    能：学习型索引快照的声明文件
+  说    明：两级递归模型索引（RMI）：根模型把值映射到某个叶子模型，
+            叶子模型用线性函数预测值在有序数组中的位置，再在误差范围内局部查找
+***************************************************************************/
+
+#ifndef LEARNEDINDEX_H
+#define LEARNEDINDEX_H
+
+#include <vector>
+#include "NodePool.h"
+
+/***************************************************************************
+  类名称：LearnedIndex
+  功    能：基于分段线性模型的只读有序索引
+  说    明：根模型对全部数据做最小二乘拟合，斜率非负，值越大分到的叶子序号越大，
+            因此每个叶子负责有序数组中连续的一段；叶子模型在自己的一段上拟合，
+            并记下预测位置的最大偏差，查找只需在偏差范围内二分；
+            建立时两遍扫描，O(n)
+***************************************************************************/
+class LearnedIndex {
+public:
+    LearnedIndex(); // 构造函数
+
+    void build(const NodePool& pool, NodeIndex root, int count); // 按中序取出树的内容并训练模型
+    void clear();                                                // 清空索引
+
+    bool   isEmpty() const      { return keys.empty(); }                    // 索引是否为空
+    int    size() const         { return static_cast<int>(keys.size()); }   // 值的个数
+    int    getLeafCount() const { return static_cast<int>(leaves.size()); } // 叶子模型个数
+    int    getMaxError() const;                                             // 叶子模型的最大预测偏差
+    qint64 getBytesReserved() const;                                        // 索引占用的内存字节数
+
+    int  lowerBound(int value) const;             // 第一个不小于 value 的位置，即小于 value 的值的个数
+    bool contains(int value) const;               // 值是否在索引中
+    bool valueAt(int position, int& value) const; // 有序数组中某个位置的值
+
+private:
+    // 叶子模型：负责有序数组中 [start, end) 一段
+    struct Leaf {
+        double slope;     // 斜率
+        double intercept; // 截距
+        int    start;     // 负责段的起始位置
+        int    end;       // 负责段的结束位置（不含）
+        int    errorLow;  // 实际位置减预测位置的最小值
+        int    errorHigh; // 实际位置减预测位置的最大值
+    };
+
+    std::vector<int>  keys;          // 有序的值
+    std::vector<Leaf> leaves;        // 叶子模型
+    double            rootSlope;     // 根模型斜率
+    double            rootIntercept; // 根模型截距
+
+    int    leafOf(int value) const;                    // 根模型：值所属的叶子序号
+    qint64 predict(const Leaf& leaf, int value) const; // 叶子模型：预测位置
+    void   fitLeaf(Leaf& leaf);                        // 在叶子负责的一段上拟合并计算偏差
+};
+
+#endif // LEARNEDINDEX_H
\ No newline at end of file
@@ -0,0 +1,514 @@
+﻿/***************************************************************************
+  文件名称：NodePool.h
+  功    能：树节点内存池的声明与实现
+  说    明：所有节点存放在一个连续数组中，节点之间用 32 位下标链接，
+            释放的节点通过空闲链表回收，清空时整体释放；
+            多棵树可以共用同一份节点存储，拆分、合并时节点无需搬动；
+            持久化的多个版本还可以共用同一个节点，被多处引用的节点另有引用计数；
+            扩容时换用新数组，旧数组由仍在其他线程上读取它的只读视图持有；
+            内存池按节点类型参数化，成员函数随模板定义在头文件中
+***************************************************************************/
+
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+
+#include <QtGlobal>
+#include <QHash>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <type_traits>
+#include "TreeNode.h"
+
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
+
+/***************************************************************************
+  类名称：BasicNodePool
+  功    能：树节点的连续数组内存池
+  说    明：节点以下标访问，数组扩容后下标依然有效；键和映射值都是平凡类型时节点可平凡复制，
+            整棵树可以随内存池一次 memcpy 完成复制；
+            复制内存池得到独立的副本，shareWith 则让两个内存池共用同一份存储，
+            viewOf 只共用节点数组，得到可以在其他线程上读取的只读视图；
+            节点默认只被一处引用，被多个版本共用的节点才在散列表中记录额外的引用数，
+            没有版本时不占空间，保存版本也不需要遍历节点
+***************************************************************************/
+template <typename Node>
+class BasicNodePool {
+public:
+    typedef typename Node::KeyType Key; // 键类型
+
+    BasicNodePool();                                      // 构造函数
+    BasicNodePool(const BasicNodePool& other);            // 复制出独立的副本
+    BasicNodePool& operator=(const BasicNodePool& other); // 复制出独立的副本
+
+    // 共用存储
+    void shareWith(const BasicNodePool& other);                                      // 与另一个内存池共用存储
+    bool isShared() const { return data.use_count() > 1; }                           // 存储是否被多个内存池共用
+    bool sharesWith(const BasicNodePool& other) const { return data == other.data; } // 是否与另一个内存池共用存储
+    void viewOf(const BasicNodePool& other);                                         // 只读地共用另一个内存池当前的节点数组
+
+    // 多版本共用节点
+    void addRef(NodeIndex index);                                       // 增加节点的引用数
+    bool dropRef(NodeIndex index);                                      // 减少节点的引用数，返回是否已无引用
+    bool isNodeShared(NodeIndex index) const;                           // 节点是否被多处引用
+    bool hasSharedNodes() const { return !data->sharedRefs.isEmpty(); } // 存储中是否有被多处引用的节点
+    int  getSharedNodes() const { return data->sharedRefs.size(); }     // 被多处引用的节点数
+
+    NodeIndex allocate(const Key& key);       // 分配节点
+    NodeIndex allocateBlock(int count);       // 在数组末尾分配 count 个下标连续的节点，返回第一个下标
+    void      release(NodeIndex index);       // 回收节点到空闲链表
+    void      clear();                        // 释放所有节点
+    void      reserve(int nodeCount);         // 预留节点容量
+
+    Node&       operator[](NodeIndex index)       { return data->nodes[index]; } // 按下标访问节点
+    const Node& operator[](NodeIndex index) const { return data->nodes[index]; } // 按下标访问节点
+    void        prefetch(NodeIndex index) const;                                 // 预取节点所在的缓存行
+
+    // 统计信息
+    quint64 getAllocationCount() const { return data->allocationCount; } // 累计分配次数
+    quint64 getReleaseCount() const    { return data->releaseCount; }    // 累计回收次数
+    quint64 getGrowthCount() const     { return data->growthCount; }     // 累计扩容次数
+    int     getLiveNodes() const       { return data->liveNodes; }       // 当前存活节点数
+    int     getCapacity() const;                                         // 当前可容纳的节点数
+    qint64  getBytesReserved() const;                                    // 当前占用的内存字节数
+
+private:
+    // 节点存储，可被多个内存池共用
+    struct Storage {
+        std::shared_ptr<std::vector<Node>> array;    // 节点数组，长度即容量，创建后不再改变长度
+        Node*                              nodes;    // 数组首地址，0 号槽位为空节点
+        int                                used;     // 已分配出的槽位数（含0号空节点），之后的槽位为默认节点
+        NodeIndex                          freeList; // 空闲链表头（借用 left 下标串联）
+
+        QHash<NodeIndex, quint32> sharedRefs; // 被多处引用的节点的额外引用数（引用数减1），只被一处引用的节点不在表中
+
+        quint64 allocationCount; // 累计分配次数
+        quint64 releaseCount;    // 累计回收次数
+        quint64 growthCount;     // 累计扩容次数
+        int     liveNodes;       // 当前存活节点数
+
+        Storage();
+        Storage(const Storage& other);            // 复制节点，得到独立的数组
+        Storage& operator=(const Storage&) = delete;
+        void addNullNode();                       // 换用只有 0 号空节点的新数组
+        void grow(int capacity);                  // 换用容量为 capacity 的新数组
+    };
+
+    std::shared_ptr<Storage> data; // 节点存储
+};
+
+typedef BasicNodePool<TreeNode> NodePool; // 界面使用的整数树内存池
+
+static_assert(std::is_trivially_copyable<TreeNode>::value, "TreeNode must stay memcpy-able");
+static_assert(sizeof(TreeNode) == 24, "TreeNode must stay 24 bytes");
+
+/***************************************************************************
+  函数名称：BasicNodePool::Storage::Storage
+  功    能：构造函数，初始化节点存储
+  输入参数：
+  返 回 值：
+  说    明：放入 0 号空节点槽位，之后分配的节点下标从 1 开始
+***************************************************************************/
+template <typename Node>
+BasicNodePool<Node>::Storage::Storage() :
+    nodes(nullptr)      , used(0),
+    freeList(NullNode)  , allocationCount(0),
+    releaseCount(0)     , growthCount(0),
+    liveNodes(0)
+{
+    addNullNode();
+}
+
+/***************************************************************************
+  函数名称：BasicNodePool::Storage::Storage
+  功    能：复制构造函数
+  输入参数：other - 被复制的存储
+  返 回 值：
+  说    明：只复制已分配出的槽位，新数组的容量即为槽位数
+***************************************************************************/
+template <typename Node>
+BasicNodePool<Node>::Storage::Storage(const Storage& other) :
+    array(std::make_shared<std::vector<Node>>(other.nodes, other.nodes + other.used)),
+    nodes(array->data())                   , used(other.used),
+    freeList(other.freeList)               , sharedRefs(other.sharedRefs),
+    allocationCount(other.allocationCount) , releaseCount(other.releaseCount),
+    growthCount(other.growthCount)         , liveNodes(other.liveNodes)
+{
+}
+
+/***************************************************************************
+  函数名称：BasicNodePool::Storage::addNullNode
+  功    能：换用只有 0 号空节点槽位的新数组
+  输入参数：
+  返 回 值：
+  说    明：空节点的子树高度和重复次数为0，读取空孩子的统计信息时无需判空；
+            空节点的键为默认值，键类型须可默认构造；原数组被只读视图共用时不受影响
+***************************************************************************/
+template <typename Node>
+void BasicNodePool<Node>::Storage::addNullNode() {
+    array = std::make_shared<std::vector<Node>>(1, Node(Key()));
+    nodes = array->data();
+    used  = 1;
+    nodes[NullNode].height = 0;
+    nodes[NullNode].count  = 0;
+    nodes[NullNode].weight = 0;
+}
+
+/***************************************************************************
+  函数名称：BasicNodePool::Storage::grow
+  功    能：换用更大的节点数组
+  输入参数：capacity - 新数组的槽位数
+  返 回 值：
+  说    明：已分配出的槽位复制到新数组，下标不变；不原地扩容，
+            原数组被只读视图共用时仍原样保留，由最后一个视图释放
+***************************************************************************/
+template <typename Node>
+void BasicNodePool<Node>::Storage::grow(int capacity) {
+    std::shared_ptr<std::vector<Node>> grown = std::make_shared<std::vector<Node>>();
+    grown->reserve(capacity);
+    grown->assign(nodes, nodes + used);
+    grown->resize(capacity, Node(Key()));
+
+    array = std::move(grown);
+    nodes = array->data();
+    growthCount++;
+}
+
+/***************************************************************************
+  函数名称：BasicNodePool::BasicNodePool
+  功    能：构造函数，初始化内存池
+  输入参数：
+  返 回 值：
+  说    明：创建一份独占的节点存储
+***************************************************************************/
+template <typename Node>
+BasicNodePool<Node>::BasicNodePool() :
+    data(std::make_shared<Storage>())
+{
+}
+
+/***************************************************************************
+  函数名称：BasicNodePool::BasicNodePool
+  功    能：复制构造函数
+  输入参数：other - 被复制的内存池
+  返 回 值：
+  说    明：复制出独立的节点存储，之后两者互不影响；
+            副本只属于一棵树，树中的节点各只有一个父节点，原存储中其他版本的引用不再计入
+***************************************************************************/
+template <typename Node>
+BasicNodePool<Node>::BasicNodePool(const BasicNodePool& other) :
+    data(std::make_shared<Storage>(*other.data))
+{
+    data->sharedRefs.clear();
+}
+
+/***************************************************************************
+  函数名称：BasicNodePool::operator=
+  功    能：复制赋值
+  输入参数：other - 被复制的内存池
+  返 回 值：BasicNodePool& - 自身
+  说    明：复制出独立的节点存储，其他版本的引用不再计入；共用存储时不影响其他内存池
+***************************************************************************/
+template <typename Node>
+BasicNodePool<Node>& BasicNodePool<Node>::operator=(const BasicNodePool& other) {
+    if (this != &other) {
+        data = std::make_shared<Storage>(*other.data);
+        data->sharedRefs.clear();
+    }
+    return *this;
+}
+
+/***************************************************************************
+  函数名称：BasicNodePool::shareWith
+  功    能：与另一个内存池共用节点存储
+  输入参数：other - 要共用存储的内存池
+  返 回 值：
+  说    明：原存储不再被本内存池引用；拆分出的树与原树共用存储，节点无需搬动
+***************************************************************************/
+template <typename Node>
+void BasicNodePool<Node>::shareWith(const BasicNodePool& other) {
+    data = other.data;
+}
+
+/***************************************************************************
+  函数名称：BasicNodePool::viewOf
+  功    能：只读地共用另一个内存池当前的节点数组
+  输入参数：other - 被共用数组的内存池
+  返 回 值：
+  说    明：视图有自己的存储对象，other 之后扩容换用新数组、清空换用新存储都不影响视图，
+            视图可以在其他线程上读取；other 仍会改写数组中的槽位，
+            调用者须保证视图可达的节点不被改写（由节点引用数保证）；视图不能分配或回收节点
+***************************************************************************/
+template <typename Node>
+void BasicNodePool<Node>::viewOf(const BasicNodePool& other) {
+    std::shared_ptr<Storage> view = std::make_shared<Storage>();
+    view->array = other.data->array;
+    view->nodes = other.data->nodes;
+    view->used  = other.data->used;
+    data = std::move(view);
+}
+
+/***************************************************************************
+  函数名称：BasicNodePool::addRef
+  功    能：增加节点的引用数
+  输入参数：index - 节点下标
+  返 回 值：
+  说    明：保存版本时根节点、复制节点时它的两个孩子多了一处引用；空节点不计引用
+***************************************************************************/
+template <typename Node>
+void BasicNodePool<Node>::addRef(NodeIndex index) {
+    if (index != NullNode) {
+        data->sharedRefs[index]++;
+    }
+}
+
+/***************************************************************************
+  函数名称：BasicNodePool::dropRef
+  功    能：减少节点的引用数
+  输入参数：index - 节点下标
+  返 回 值：bool - 减少前是否只有这一处引用，此时调用者应回收节点；空节点返回false
+  说    明：只被一处引用的节点不在散列表中，返回true且不做修改；
+            额外引用数减到0时从散列表中删除，节点重新变为只被一处引用
+***************************************************************************/
+template <typename Node>
+bool BasicNodePool<Node>::dropRef(NodeIndex index) {
+    if (index == NullNode) {
+        return false;
+    }
+    if (data->sharedRefs.isEmpty()) {
+        return true;
+    }
+
+    auto it = data->sharedRefs.find(index);
+    if (it == data->sharedRefs.end()) {
+        return true;
+    }
+    if (--it.value() == 0) {
+        data->sharedRefs.erase(it);
+    }
+    return false;
+}
+
+/***************************************************************************
+  函数名称：BasicNodePool::isNodeShared
+  功    能：检查节点是否被多处引用
+  输入参数：index - 节点下标
+  返 回 值：bool - 被多个版本共用时返回true
+  说    明：没有版本时散列表为空，只需一次判断
+***************************************************************************/
+template <typename Node>
+inline bool BasicNodePool<Node>::isNodeShared(NodeIndex index) const {
+    return !data->sharedRefs.isEmpty() && data->sharedRefs.contains(index);
+}
+
+/***************************************************************************
+  函数名称：BasicNodePool::allocate
+  功    能：分配一个树节点
+  输入参数：key - 节点的键
+  返 回 值：NodeIndex - 新节点下标
+  说    明：优先复用空闲链表中的槽位，否则追加到数组末尾；
+            扩容会使之前取得的节点引用失效，但下标始终有效
+***************************************************************************/
+template <typename Node>
+NodeIndex BasicNodePool<Node>::allocate(const Key& key) {
+    Storage&  storage = *data;
+    NodeIndex index;
+
+    if (storage.freeList != NullNode) {
+        index = storage.freeList;
+        storage.freeList = storage.nodes[index].left;
+        storage.nodes[index] = Node(key);
+    }
+    else {
+        if (storage.used == static_cast<int>(storage.array->size())) {
+            storage.grow(storage.used * 2);
+        }
+        index = static_cast<NodeIndex>(storage.used++);
+        storage.nodes[index] = Node(key);
+    }
+
+    storage.allocationCount++;
+    storage.liveNodes++;
+    return index;
+}
+
+/***************************************************************************
+  函数名称：BasicNodePool::allocateBlock
+  功    能：在数组末尾分配一段下标连续的节点
+  输入参数：count - 节点数
+  返 回 值：NodeIndex - 第一个节点的下标
+  说    明：不使用空闲链表；节点的键为默认值，由调用者逐个写入，
+            各节点互不相关，可以由多个线程分段写入
+***************************************************************************/
+template <typename Node>
+NodeIndex BasicNodePool<Node>::allocateBlock(int count) {
+    Storage&  storage = *data;
+    NodeIndex first   = static_cast<NodeIndex>(storage.used);
+
+    if (storage.used + count > static_cast<int>(storage.array->size())) {
+        storage.grow(std::max(storage.used + count, storage.used * 2));
+    }
+    storage.used += count;
+
+    storage.allocationCount += count;
+    storage.liveNodes       += count;
+    return first;
+}
+
+/***************************************************************************
+  函数名称：BasicNodePool::release
+  功    能：回收一个树节点
+  输入参数：index - 要回收的节点下标
+  返 回 值：
+  说    明：槽位挂入空闲链表，供之后的分配复用；
+            键或映射值持有资源（如字符串）时先换成默认值，及时释放
+***************************************************************************/
+template <typename Node>
+void BasicNodePool<Node>::release(NodeIndex index) {
+    if (index == NullNode) {
+        return;
+    }
+
+    Storage& storage = *data;
+    if (!std::is_trivially_destructible<Node>::value) {
+        storage.nodes[index] = Node(Key());
+    }
+    storage.nodes[index].left = storage.freeList;
+    storage.freeList = index;
+
+    storage.releaseCount++;
+    storage.liveNodes--;
+}
+
+/***************************************************************************
+  函数名称：BasicNodePool::clear
+  功    能：释放内存池中的所有节点
+  输入参数：
+  返 回 值：
+  说    明：换用只有 0 号空节点的新数组，原数组没有只读视图时整块归还；
+            存储被共用时其他内存池的节点仍在使用，改为换用一份新的存储
+***************************************************************************/
+template <typename Node>
+void BasicNodePool<Node>::clear() {
+    if (isShared()) {
+        data = std::make_shared<Storage>();
+        return;
+    }
+
+    Storage& storage = *data;
+    storage.addNullNode();
+    storage.sharedRefs.clear();
+
+    storage.freeList = NullNode;
+    storage.releaseCount += storage.liveNodes;
+    storage.liveNodes = 0;
+}
+
+/***************************************************************************
+  函数名称：BasicNodePool::reserve
+  功    能：预留节点容量
+  输入参数：nodeCount - 需要容纳的节点数
+  返 回 值：
+  说    明：批量建树前调用，避免逐步扩容
+***************************************************************************/
+template <typename Node>
+void BasicNodePool<Node>::reserve(int nodeCount) {
+    Storage& storage = *data;
+    if (nodeCount + 1 > static_cast<int>(storage.array->size())) {
+        storage.grow(nodeCount + 1);
+    }
+}
+
+/***************************************************************************
+  函数名称：BasicNodePool::prefetch
+  功    能：预取节点所在的缓存行
+  输入参数：index - 节点下标
+  返 回 值：
+  说    明：只是提示，不访问节点内容；交错推进多路查找时提前取下一层的节点
+***************************************************************************/
+template <typename Node>
+inline void BasicNodePool<Node>::prefetch(NodeIndex index) const {
+#if defined(_MSC_VER)
+    _mm_prefetch(reinterpret_cast<const char*>(data->nodes + index), _MM_HINT_T0);
+#else
+    __builtin_prefetch(data->nodes + index);
+#endif
+}
+
+/***************************************************************************
+  函数名称：BasicNodePool::getCapacity
+  功    能：获取当前可容纳的节点数
+  输入参数：
+  返 回 值：int - 节点数（不含 0 号空节点）
+  说    明：
+***************************************************************************/
+template <typename Node>
+int BasicNodePool<Node>::getCapacity() const {
+    return static_cast<int>(data->array->size()) - 1;
+}
+
+/***************************************************************************
+  函数名称：BasicNodePool::getBytesReserved
+  功    能：获取内存池当前占用的内存字节数
+  输入参数：
+  返 回 值：qint64 - 字节数
+  说    明：按数组容量计算，包括空闲链表和尚未使用的部分；不含键在节点外持有的内存
+***************************************************************************/
+template <typename Node>
+qint64 BasicNodePool<Node>::getBytesReserved() const {
+    return static_cast<qint64>(data->array->size()) * static_cast<qint64>(sizeof(Node));
+}
+
+struct NodeView;
+struct NodeArrow;
+
+/***************************************************************************
+  类名称：NodeHandle
+  功    能：只读节点句柄
+  说    明：由内存池指针、节点下标和节点深度组成，供视图等外部代码遍历树；
+            用法与 TreeNode* 相同，支持 node->left、node->value 和 if (!node)；
+            节点本身不存深度，句柄从根开始逐层向下时顺带算出
+***************************************************************************/
+class NodeHandle {
+public:
+    NodeHandle() : pool(nullptr), index(NullNode), depth(0) {}
+    NodeHandle(const NodePool* pool, NodeIndex index, int depth) : pool(pool), index(index), depth(depth) {}
+
+    explicit operator bool() const { return index != NullNode; }
+    bool operator==(const NodeHandle& other) const { return index == other.index && pool == other.pool; }
+    bool operator!=(const NodeHandle& other) const { return !(*this == other); }
+
+    NodeArrow operator->() const; // 访问节点字段
+
+    NodeIndex getIndex() const { return index; } // 获取节点下标
+    int       getDepth() const { return depth; } // 获取节点深度
+
+private:
+    const NodePool* pool;  // 所属内存池
+    NodeIndex       index; // 节点下标
+    int             depth; // 节点深度（根节点深度为1）
+};
+
+// 通过句柄看到的节点内容，孩子同样以句柄给出；value 为节点的键，count 为重复次数
+struct NodeView {
+    int        value;
+    NodeHandle left;
+    NodeHandle right;
+    int        depth;
+    int        count;
+};
+
+// operator-> 的返回值，持有一份 NodeView
+struct NodeArrow {
+    NodeView view;
+    const NodeView* operator->() const { return &view; }
+};
+
+inline NodeArrow NodeHandle::operator->() const {
+    const TreeNode& node = (*pool)[index];
+    return NodeArrow{ NodeView{ node.key, NodeHandle(pool, node.left, depth + 1), NodeHandle(pool, node.right, depth + 1), depth, node.count } };
+}
+
+#endif // NODEPOOL_H
\ No newline at end of file
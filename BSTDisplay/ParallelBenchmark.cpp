@@ -0,0 +1,175 @@
+﻿/***************************************************************************
+  文件名称：ParallelBenchmark.cpp
+  功    能：多线程平衡相对单线程 DSW 的加速比，以及批量建树各阶段的耗时
+  说    明：命令行程序，CMake 中打开 BSTDISPLAY_BUILD_BENCHMARK 才会构建；
+            用法：ParallelBenchmark [节点数] [最大线程数]，默认 4000000 个节点、硬件线程数，
+            线程数从1开始逐次翻倍，1个线程时即为 DSW
+***************************************************************************/
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include "ParallelSort.h"
+#include "SearchTree.h"
+
+const int Repeats = 3; // 每个线程数重复测量的次数，取最短的一次
+
+/***************************************************************************
+  函数名称：sameTree
+  功    能：比较两棵树的结构是否完全相同
+  输入参数：first, second - 由同一棵树复制后分别平衡得到的两棵树
+  返 回 值：bool - 根、每个节点的孩子、统计信息和颜色都相同时返回true
+  说    明：复制保留节点下标，平衡不重新分配节点，两棵树的下标可以直接对照
+***************************************************************************/
+static bool sameTree(const SearchTree<int>& first, const SearchTree<int>& second) {
+    if (first.getRootIndex() != second.getRootIndex()) {
+        return false;
+    }
+
+    const NodePool& a = first.getNodePool();
+    const NodePool& b = second.getNodePool();
+    QVector<NodeIndex> stack;
+    stack.append(first.getRootIndex());
+    while (!stack.isEmpty()) {
+        NodeIndex node = stack.takeLast();
+        if (node == NullNode) {
+            continue;
+        }
+        const TreeNode& x = a[node];
+        const TreeNode& y = b[node];
+        if (x.key != y.key || x.left != y.left || x.right != y.right || x.height != y.height ||
+            x.red != y.red || x.count != y.count || x.weight != y.weight) {
+            return false;
+        }
+        stack.append(x.left);
+        stack.append(x.right);
+    }
+    return true;
+}
+
+/***************************************************************************
+  函数名称：sameShape
+  功    能：比较两棵树的形状和各位置上的值是否相同
+  输入参数：first, second - 两棵树，node1, node2 - 两棵树中对应位置的节点
+  返 回 值：bool - 两棵子树形状相同、对应节点的值和颜色都相同时返回true
+  说    明：批量建树重新分配节点，下标与平衡得到的树不同，只能按位置对照
+***************************************************************************/
+static bool sameShape(const SearchTree<int>& first, NodeIndex node1, const SearchTree<int>& second, NodeIndex node2) {
+    const NodePool& a = first.getNodePool();
+    const NodePool& b = second.getNodePool();
+    QVector<NodeIndex> stack;
+    stack.append(node1);
+    stack.append(node2);
+    while (!stack.isEmpty()) {
+        NodeIndex y = stack.takeLast();
+        NodeIndex x = stack.takeLast();
+        if ((x == NullNode) != (y == NullNode)) {
+            return false;
+        }
+        if (x == NullNode) {
+            continue;
+        }
+        if (a[x].key != b[y].key || a[x].red != b[y].red || a[x].weight != b[y].weight) {
+            return false;
+        }
+        stack.append(a[x].left);
+        stack.append(b[y].left);
+        stack.append(a[x].right);
+        stack.append(b[y].right);
+    }
+    return true;
+}
+
+/***************************************************************************
+  函数名称：main
+  功    能：按线程数依次测量平衡的耗时并输出结果表
+  输入参数：argc, argv - 命令行参数
+  返 回 值：int - 程序退出码
+  说    明：不平衡策略下随机插入建成源树，每次从它复制一份再平衡；
+            每个线程数的结果都与 DSW 的结果逐节点比较；
+            批量建树以插入源树的全部随机数（含重复）的文本为输入，结果也与 DSW 的结果按位置比较
+***************************************************************************/
+int main(int argc, char* argv[]) {
+    int nodeCount  = argc > 1 ? std::atoi(argv[1]) : 4000000;
+    int maxThreads = argc > 2 ? std::atoi(argv[2]) : static_cast<int>(std::thread::hardware_concurrency());
+    nodeCount  = std::max(1, nodeCount);
+    maxThreads = std::max(1, std::min(maxThreads, 256));
+
+    SearchTree<int> source;
+    QByteArray text;
+    std::mt19937 generator(2024);
+    while (source.getNodeCount() < nodeCount) {
+        int value = static_cast<int>(generator());
+        source.insert(value);
+        text += QByteArray::number(value);
+        text += ' ';
+    }
+
+    std::printf("%d nodes, height %d before balance\n", source.getNodeCount(), source.getHeight());
+    std::printf("%8s | %10s %8s | %s\n", "threads", "time (ms)", "speedup", "same as DSW");
+
+    SearchTree<int> reference;
+    double baseline = 0;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        double best = 0;
+        SearchTree<int> tree;
+        for (int repeat = 0; repeat < Repeats; repeat++) {
+            tree.copyFrom(source);
+            QElapsedTimer timer;
+            timer.start();
+            tree.balance(threads);
+            double elapsed = timer.nsecsElapsed() / 1e6;
+            best = repeat == 0 ? elapsed : std::min(best, elapsed);
+        }
+
+        if (threads == 1) {
+            reference.copyFrom(tree);
+            baseline = best;
+        }
+        std::printf("%8d | %10.1f %7.2fx | %s\n", threads, best, baseline / best,
+            sameTree(reference, tree) ? "yes" : "NO");
+    }
+
+    std::printf("\nbulk build from %d bytes of text\n", static_cast<int>(text.size()));
+    std::printf("%8s | %9s %9s %9s %9s %9s | %s\n", "threads", "parse", "sort", "dedup", "build", "total", "same as DSW");
+
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        double best[4] = { 0, 0, 0, 0 };
+        double bestTotal = 0;
+        SearchTree<int> tree;
+        for (int repeat = 0; repeat < Repeats; repeat++) {
+            double elapsed[4];
+            QElapsedTimer timer;
+            timer.start();
+            QVector<int> values, unique;
+            ParallelSort::parseValues(text, values, threads);
+            elapsed[0] = timer.nsecsElapsed() / 1e6;
+
+            timer.restart();
+            ParallelSort::radixSort(values, threads);
+            elapsed[1] = timer.nsecsElapsed() / 1e6;
+
+            timer.restart();
+            ParallelSort::uniqueSorted(values, unique, nullptr, threads);
+            elapsed[2] = timer.nsecsElapsed() / 1e6;
+
+            timer.restart();
+            tree.assignSorted(unique, nullptr, threads);
+            elapsed[3] = timer.nsecsElapsed() / 1e6;
+
+            double total = elapsed[0] + elapsed[1] + elapsed[2] + elapsed[3];
+            if (repeat == 0 || total < bestTotal) {
+                bestTotal = total;
+                std::copy(elapsed, elapsed + 4, best);
+            }
+        }
+
+        std::printf("%8d | %9.1f %9.1f %9.1f %9.1f %9.1f | %s\n", threads, best[0], best[1], best[2], best[3], bestTotal,
+            sameShape(reference, reference.getRootIndex(), tree, tree.getRootIndex()) ? "yes" : "NO");
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,294 @@
+﻿/***************************************************************************
+  文件名称：ParallelSort.cpp
+  功    能：多线程解析、基数排序与去重的实现文件
+  说    明：每个阶段先把数组按下标均分为若干块，第0块在调用线程上处理，其余各块各开一个线程，
+            全部结束后再进入下一阶段；块与块之间的衔接（写入位置、跨块的重复值）由各块的计数前缀和确定
+***************************************************************************/
+
+#include "ParallelSort.h"
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <vector>
+
+/***************************************************************************
+  函数名称：chunkCount
+  功    能：确定分块数
+  输入参数：count - 元素数，threads - 可用的线程数
+  返 回 值：int - 分块数，至少为1
+  说    明：元素少于 SequentialCutoff 时只分一块；每块至少有 SequentialCutoff/4 个元素
+***************************************************************************/
+static int chunkCount(int count, int threads) {
+    if (threads <= 1 || count < ParallelSort::SequentialCutoff) {
+        return 1;
+    }
+    return std::max(1, std::min(threads, count / (ParallelSort::SequentialCutoff / 4)));
+}
+
+/***************************************************************************
+  函数名称：chunkBegin
+  功    能：第 chunk 块的起始下标
+  输入参数：count - 元素数，chunks - 分块数，chunk - 块号（可以等于 chunks，即末尾）
+  返 回 值：int - 起始下标
+  说    明：
+***************************************************************************/
+static int chunkBegin(int count, int chunks, int chunk) {
+    return static_cast<int>(static_cast<qint64>(count) * chunk / chunks);
+}
+
+/***************************************************************************
+  函数名称：runChunks
+  功    能：每块一个线程执行 work，全部结束后返回
+  输入参数：chunks - 分块数，work - 以块号为参数的处理函数
+  返 回 值：
+  说    明：第0块在调用线程上执行，只有一块时不创建线程
+***************************************************************************/
+template <typename Work>
+static void runChunks(int chunks, Work work) {
+    std::vector<std::thread> workers;
+    for (int chunk = 1; chunk < chunks; chunk++) {
+        workers.emplace_back(work, chunk);
+    }
+    work(0);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+/***************************************************************************
+  函数名称：isSeparator
+  功    能：字符是否为数之间的分隔符
+  输入参数：c - 字符
+  返 回 值：bool - 空白、逗号或分号时返回true
+  说    明：
+***************************************************************************/
+static bool isSeparator(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v' || c == ',' || c == ';';
+}
+
+/***************************************************************************
+  函数名称：parseRange
+  功    能：解析文本中的一段
+  输入参数：text - 文本，begin, end - 段的范围（两端都落在分隔符处或文本两端），values - 用于追加解析结果
+  返 回 值：bool - 段中全是合法的整数时返回true
+  说    明：每个数为可选的正负号加至少一位数字，超出 int 范围视为无效
+***************************************************************************/
+static bool parseRange(const char* text, int begin, int end, QVector<int>& values) {
+    int i = begin;
+    while (i < end) {
+        if (isSeparator(text[i])) {
+            i++;
+            continue;
+        }
+
+        bool negative = false;
+        if (text[i] == '+' || text[i] == '-') {
+            negative = text[i] == '-';
+            i++;
+        }
+
+        qint64 value  = 0;
+        int    digits = 0;
+        while (i < end && text[i] >= '0' && text[i] <= '9') {
+            value = value * 10 + (text[i] - '0');
+            if (value > static_cast<qint64>(std::numeric_limits<int>::max()) + 1) {
+                return false;
+            }
+            digits++;
+            i++;
+        }
+        if (digits == 0 || (i < end && !isSeparator(text[i]))) {
+            return false;
+        }
+
+        value = negative ? -value : value;
+        if (value > std::numeric_limits<int>::max()) {
+            return false;
+        }
+        values.append(static_cast<int>(value));
+    }
+    return true;
+}
+
+/***************************************************************************
+  函数名称：ParallelSort::parseValues
+  功    能：解析以空白、逗号或分号分隔的整数
+  输入参数：text - 文本，values - 用于返回解析结果（按文本中的顺序），threads - 可用的线程数
+  返 回 值：bool - 文本中全是合法的整数时返回true，否则 values 为空
+  说    明：按字节均分后把每块的起点后移到下一个分隔符，数不会跨块；
+            各块解析到自己的数组中，再按各块的个数并行拼接
+***************************************************************************/
+bool ParallelSort::parseValues(const QByteArray& text, QVector<int>& values, int threads) {
+    const char* data   = text.constData();
+    const int   length = static_cast<int>(text.size());
+    const int   chunks = chunkCount(length, threads);
+
+    QVector<int> bounds(chunks + 1);
+    bounds[0]      = 0;
+    bounds[chunks] = length;
+    for (int chunk = 1; chunk < chunks; chunk++) {
+        int position = std::max(chunkBegin(length, chunks, chunk), bounds[chunk - 1]);
+        while (position < length && !isSeparator(data[position])) {
+            position++;
+        }
+        bounds[chunk] = position;
+    }
+
+    std::vector<QVector<int>> parts(chunks);
+    std::vector<char>         valid(chunks, 1);
+    runChunks(chunks, [&](int chunk) {
+        parts[chunk].reserve((bounds[chunk + 1] - bounds[chunk]) / 4);
+        valid[chunk] = parseRange(data, bounds[chunk], bounds[chunk + 1], parts[chunk]) ? 1 : 0;
+    });
+
+    values.clear();
+    if (std::find(valid.begin(), valid.end(), 0) != valid.end()) {
+        return false;
+    }
+
+    QVector<int> offsets(chunks + 1, 0);
+    for (int chunk = 0; chunk < chunks; chunk++) {
+        offsets[chunk + 1] = offsets[chunk] + parts[chunk].size();
+    }
+    values.resize(offsets[chunks]);
+
+    int* output = values.data();
+    runChunks(chunks, [&](int chunk) {
+        std::copy(parts[chunk].cbegin(), parts[chunk].cend(), output + offsets[chunk]);
+    });
+    return true;
+}
+
+/***************************************************************************
+  函数名称：ParallelSort::radixSort
+  功    能：从小到大排序
+  输入参数：values - 要排序的值，threads - 可用的线程数
+  返 回 值：
+  说    明：翻转符号位把 int 保序地映射为无符号数，按 RadixBits 位一轮做最低位优先的基数排序；
+            每轮各块先统计本块的各位值个数，按“位值优先、块号其次”求前缀和得到各块的写入起点，
+            再各自按原顺序分发，保持稳定；某一轮所有元素的位值相同时跳过这一轮；
+            元素少于 SequentialCutoff 时直接用 std::sort
+***************************************************************************/
+void ParallelSort::radixSort(QVector<int>& values, int threads) {
+    const int count = values.size();
+    if (count < SequentialCutoff) {
+        std::sort(values.begin(), values.end());
+        return;
+    }
+
+    const int     chunks  = chunkCount(count, threads);
+    const int     buckets = 1 << RadixBits;
+    const quint32 signBit = 0x80000000u;
+
+    std::vector<quint32> keys(count), buffer(count);
+    int* data = values.data();
+    runChunks(chunks, [&](int chunk) {
+        for (int i = chunkBegin(count, chunks, chunk), end = chunkBegin(count, chunks, chunk + 1); i < end; i++) {
+            keys[i] = static_cast<quint32>(data[i]) ^ signBit;
+        }
+    });
+
+    std::vector<int> histogram(static_cast<size_t>(chunks) * buckets);
+    for (int shift = 0; shift < 32; shift += RadixBits) {
+        std::fill(histogram.begin(), histogram.end(), 0);
+        runChunks(chunks, [&](int chunk) {
+            int* local = histogram.data() + static_cast<size_t>(chunk) * buckets;
+            for (int i = chunkBegin(count, chunks, chunk), end = chunkBegin(count, chunks, chunk + 1); i < end; i++) {
+                local[(keys[i] >> shift) & (buckets - 1)]++;
+            }
+        });
+
+        // 前缀和：位值 d 的第 c 块从所有更小位值和同位值的前面各块之后开始写
+        bool skip = false;
+        int  offset = 0;
+        for (int digit = 0; digit < buckets; digit++) {
+            int digitTotal = 0;
+            for (int chunk = 0; chunk < chunks; chunk++) {
+                int& slot = histogram[static_cast<size_t>(chunk) * buckets + digit];
+                int  size = slot;
+                slot        = offset;
+                offset     += size;
+                digitTotal += size;
+            }
+            if (digitTotal == count) {
+                skip = true;
+            }
+        }
+        if (skip) {
+            continue;
+        }
+
+        runChunks(chunks, [&](int chunk) {
+            int* next = histogram.data() + static_cast<size_t>(chunk) * buckets;
+            for (int i = chunkBegin(count, chunks, chunk), end = chunkBegin(count, chunks, chunk + 1); i < end; i++) {
+                buffer[next[(keys[i] >> shift) & (buckets - 1)]++] = keys[i];
+            }
+        });
+        keys.swap(buffer);
+    }
+
+    runChunks(chunks, [&](int chunk) {
+        for (int i = chunkBegin(count, chunks, chunk), end = chunkBegin(count, chunks, chunk + 1); i < end; i++) {
+            data[i] = static_cast<int>(keys[i] ^ signBit);
+        }
+    });
+}
+
+/***************************************************************************
+  函数名称：ParallelSort::uniqueSorted
+  功    能：有序数组去重
+  输入参数：sorted - 从小到大排列的值，unique - 用于返回不同的值，
+            counts - 不为空时用于返回每个值的重复次数，threads - 可用的线程数
+  返 回 值：int - 不同值的个数
+  说    明：与前一个元素不同的位置是一段相等值的起点；各块先数出本块的起点个数，
+            前缀和即为各块的写入位置，再各自写出起点上的值；重复次数为相邻两个起点之差
+***************************************************************************/
+int ParallelSort::uniqueSorted(const QVector<int>& sorted, QVector<int>& unique, QVector<int>* counts, int threads) {
+    const int  count  = sorted.size();
+    const int  chunks = chunkCount(count, threads);
+    const int* data   = sorted.constData();
+
+    QVector<int> offsets(chunks + 1, 0);
+    runChunks(chunks, [&](int chunk) {
+        int starts = 0;
+        for (int i = chunkBegin(count, chunks, chunk), end = chunkBegin(count, chunks, chunk + 1); i < end; i++) {
+            if (i == 0 || data[i] != data[i - 1]) {
+                starts++;
+            }
+        }
+        offsets[chunk + 1] = starts;
+    });
+    for (int chunk = 0; chunk < chunks; chunk++) {
+        offsets[chunk + 1] += offsets[chunk];
+    }
+
+    const int total = offsets[chunks];
+    unique.resize(total);
+    std::vector<int> startIndex(counts != nullptr ? total + 1 : 0);
+
+    int* output = unique.data();
+    runChunks(chunks, [&](int chunk) {
+        int position = offsets[chunk];
+        for (int i = chunkBegin(count, chunks, chunk), end = chunkBegin(count, chunks, chunk + 1); i < end; i++) {
+            if (i == 0 || data[i] != data[i - 1]) {
+                if (counts != nullptr) {
+                    startIndex[position] = i;
+                }
+                output[position++] = data[i];
+            }
+        }
+    });
+
+    if (counts != nullptr) {
+        startIndex[total] = count;
+        counts->resize(total);
+        int* repeat = counts->data();
+        const int groups = chunkCount(total, threads);
+        runChunks(groups, [&](int chunk) {
+            for (int i = chunkBegin(total, groups, chunk), end = chunkBegin(total, groups, chunk + 1); i < end; i++) {
+                repeat[i] = startIndex[i + 1] - startIndex[i];
+            }
+        });
+    }
+    return total;
+}
\ No newline at end of file
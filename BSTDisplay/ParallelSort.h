@@ -0,0 +1,32 @@
+﻿/***************************************************************************
+  文件名称：ParallelSort.h
+  功    能：多线程解析、基数排序与去重的声明文件
+  说    明：批量建树的前三个阶段：把文本解析为整数、按基数排序、把有序数组去重
+***************************************************************************/
+
+#ifndef PARALLELSORT_H
+#define PARALLELSORT_H
+
+#include <QByteArray>
+#include <QVector>
+
+/***************************************************************************
+  类名称：ParallelSort
+  功    能：整数数组的多线程预处理
+  说    明：只有静态成员；各函数把数组均分给若干线程，线程只在阶段之间汇合，
+            结果与单线程时完全相同；元素少于 SequentialCutoff 或只有一个线程时不分线程
+***************************************************************************/
+class ParallelSort {
+public:
+    static bool parseValues(const QByteArray& text, QVector<int>& values, int threads);                         // 解析以空白、逗号或分号分隔的整数
+    static void radixSort(QVector<int>& values, int threads);                                                   // 从小到大排序
+    static int  uniqueSorted(const QVector<int>& sorted, QVector<int>& unique, QVector<int>* counts, int threads); // 有序数组去重，返回不同值的个数
+
+    static const int SequentialCutoff = 1 << 16; // 元素少于这个数时不分线程
+    static const int RadixBits        = 8;       // 每轮排序的位数，int 分4轮
+
+private:
+    ParallelSort() = delete;
+};
+
+#endif // PARALLELSORT_H
\ No newline at end of file
@@ -0,0 +1,2802 @@
+﻿/***************************************************************************
+  文件名称：SearchTree.h
+  功    能：通用二叉搜索树模板的声明与实现，包含节点的插入、删除、查找、平衡等操作
+  说    明：按键类型、映射值类型和比较器参数化，成员函数随模板定义在头文件中；
+            只负责树本身，不发信号、不做动画，界面使用的 BinarySearchTree 是 SearchTree<int> 的包装
+***************************************************************************/
+
+#ifndef SEARCHTREE_H
+#define SEARCHTREE_H
+
+#include <QString>
+#include <QVector>
+#include <QVarLengthArray>
+#include <QPair>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "TreeNode.h"
+#include "NodePool.h"
+#include "KeyTraits.h"
+
+typedef QVarLengthArray<NodeIndex, 64> NodePath;   // 从根向下经过的节点下标
+
+// 自平衡策略
+enum class BalancePolicy {
+    None,       // 普通二叉搜索树，不做自平衡
+    AVL,        // AVL 树，左右子树高度差不超过1
+    RedBlack,   // 红黑树
+    Splay,      // 伸展树，每次访问把节点伸展到根
+    Scapegoat,  // 替罪羊树，过深时局部重建
+    Treap       // 树堆，按优先级保持堆序，支持拆分与合并
+};
+const int BalancePolicyCount = 6;   // 自平衡策略的个数
+
+// 自平衡开销统计
+struct BalanceStats {
+    quint64 operations = 0;   // 改变了树的插入、删除次数（伸展树还包括查找）
+    quint64 rotations  = 0;   // 累计旋转次数
+    quint64 rebuilds   = 0;   // 局部重建次数（替罪羊树）
+    quint64 rebuiltNodes = 0; // 局部重建涉及的节点数（替罪羊树）
+};
+
+// 结构调整（旋转、伸展、重建）的一个步骤，供动画逐步播放
+template <typename Key>
+struct TreeStep {
+    QString description; // 步骤说明
+    Key     key;         // 要高亮的节点的键
+    bool    highlighted; // 是否有要高亮的节点
+};
+
+/***************************************************************************
+  类名称：SearchTree
+  功    能：通用二叉搜索树数据结构实现
+  说    明：Key 为键类型（须可默认构造），Value 为映射值类型（NoValue 表示只存键的集合），
+            Compare 为键的严格弱序；节点存放在 BasicNodePool 中，支持六种自平衡策略、
+            树堆的拆分合并和顺序统计；算术类型的键按值传递并直接比较；
+            多重集合模式下重复的键只增加节点的重复次数，名次和随机抽样按重复次数加权；
+            保存的版本与原树共用节点，之后的修改先复制被共用的节点（写时复制）
+***************************************************************************/
+template <typename Key, typename Value = NoValue, typename Compare = std::less<Key>>
+class SearchTree {
+public:
+    typedef BasicTreeNode<Key, Value>            Node;    // 节点类型
+    typedef BasicNodePool<Node>                  Pool;    // 内存池类型
+    typedef typename KeyOrder<Key, Compare>::Arg KeyArg;  // 键的参数传递方式
+    typedef QVarLengthArray<Key, 32>             KeyPath; // 查找路径上的键，较浅的路径不申请堆内存
+    typedef TreeStep<Key>                        Step;    // 结构调整步骤
+
+    explicit SearchTree(const Compare& comparator = Compare()); // 构造函数
+    ~SearchTree();                                               // 析构函数
+
+    //基本操作
+    bool    insert(KeyArg key, const Value& value = Value());            // 插入节点，键已存在时集合不插入、多重集合增加重复次数
+    bool    remove(KeyArg key);                                          // 删除节点，多重集合先减少重复次数
+    bool    find(KeyArg key, int& depth);                                // 查找节点，伸展树策略下伸展到根
+    bool    findNode(KeyArg key, int& depth) const;                      // 迭代查找节点（不伸展）
+    int     findMany(const QVector<Key>& keys, QVector<int>& depths) const; // 批量查找，交错推进多路查找
+    bool    contains(KeyArg key) const;                                  // 键是否在树中
+    Value*       findValue(KeyArg key);                                  // 键对应的映射值，不存在时为空
+    const Value* findValue(KeyArg key) const;                            // 键对应的映射值，不存在时为空
+    void    clear();                                                     // 清空树
+    void    assign(const QVector<Key>& keys);                            // 用一组键整体替换树的内容
+    void    assignSorted(const QVector<Key>& keys, const QVector<int>* counts, int threads); // 用严格递增的键多线程整体替换树的内容
+    void    copyFrom(const SearchTree& other);                           // 整体复制另一棵树
+    void    balance(int threads = 1);                                    // 平衡树操作，threads 大于1时多线程重建
+    QString toString() const;                                            // 中序的键和深度
+
+    bool        isEmpty() const      { return root == NullNode; }          // 检查树是否为空
+    int         getNodeCount() const { return nodeCount; }                 // 获取节点数
+    int         getHeight() const    { return nodePool[root].height; }     // 获取树的高度
+    NodeIndex   getRootIndex() const { return root; }                      // 获取根节点下标
+    const Pool& getNodePool() const  { return nodePool; }                  // 获取节点内存池
+
+    // 自平衡策略
+    void          setBalancePolicy(BalancePolicy policy);            // 切换自平衡策略
+    BalancePolicy getBalancePolicy() const { return balancePolicy; } // 获取当前自平衡策略
+    BalanceStats  getBalanceStats(BalancePolicy policy) const;       // 获取某一策略的旋转统计
+    void          resetBalanceStats();                               // 清零旋转统计
+
+    // 多重集合
+    void    setMultiset(bool enabled);                              // 切换多重集合模式
+    bool    isMultiset() const    { return multiset; }              // 是否为多重集合模式
+    int     getTotalCount() const { return nodePool[root].weight; } // 计入重复次数的元素总数
+    int     count(KeyArg key) const;                                // 键的重复次数，不存在时为0
+
+    // 持久化版本：保存版本 O(1)，不平衡和 AVL 策略下的插入、删除只复制查找路径上被共用的节点
+    void    saveVersion(SearchTree& version);             // 把当前内容保存为版本 version，两者共用全部节点
+    bool    isVersioned() const { return nodePool.hasSharedNodes(); } // 节点存储中是否有被多个版本共用的节点
+
+    // 拆分与合并（切换为树堆策略）
+    void    split(KeyArg key, SearchTree& right);         // 拆分：不小于 key 的节点移到 right
+    bool    join(SearchTree& right);                      // 合并：right 整体接到右侧并清空
+    int     insertBatch(const QVector<Key>& keys);        // 批量插入，返回新增的元素数
+    int     eraseRange(KeyArg low, KeyArg high);          // 批量删除 [low, high] 内的元素，返回删除的元素数
+
+    // 顺序统计（多重集合按重复次数加权）
+    bool    lowerBound(KeyArg key, Key& result) const;    // 不小于 key 的最小键
+    int     rank(KeyArg key) const;                       // 小于 key 的元素数
+    bool    select(int k, Key& key) const;                // 第 k 小的元素（k 从1开始）
+    bool    sample(Key& key) const;                       // 等概率随机取一个元素
+
+    // 查找路径
+    bool    findPath(KeyArg key, KeyPath& path) const;    // 查找节点并记录路径
+    bool    selectPath(int k, KeyPath& path) const;       // 选择第 k 小节点并记录路径
+
+    // 结构调整步骤
+    void          setRecordSteps(bool record) { recordSteps = record; } // 是否记录旋转等调整步骤
+    QVector<Step> takeSteps();                                          // 取出并清空已记录的步骤
+
+    // 中序遍历，传给 visit 的参数为 (节点, 深度)
+    template <typename Visitor>
+    void        visitInOrder(Visitor visit) const { visitSubtree(nodePool, root, visit); }
+    template <typename Visitor>
+    static void visitSubtree(const Pool& pool, NodeIndex node, Visitor visit);
+
+private:
+    static constexpr double ScapegoatAlpha = 0.7; // 替罪羊树的平衡系数，孩子子树超过父子树的这一比例即视为失衡
+    static constexpr int    FindGroupSize  = 16;  // 批量查找时同时推进的查找路数
+
+    NodeIndex              root;      // 根节点下标
+    Pool                   nodePool;  // 节点内存池
+    int                    nodeCount; // 节点数（不计重复次数）
+    KeyOrder<Key, Compare> keyOrder;  // 键的比较
+    bool                   multiset;  // 是否为多重集合模式
+
+    // 自平衡
+    BalancePolicy balancePolicy;                    // 当前自平衡策略
+    BalanceStats  balanceStats[BalancePolicyCount]; // 按策略分别累计的旋转统计
+    bool          recordSteps;                      // 是否记录调整步骤
+    QVector<Step> steps;                            // 本次操作产生的调整步骤
+    int           maxNodeCount;                     // 替罪羊树上次整体重建以来的最大节点数
+    QVector<NodeIndex> rebuildBuffer;               // 局部重建时暂存子树节点，重复使用
+
+    bool      insertNode(KeyArg key, const Value& value);        // 迭代插入节点
+    bool      splayInsert(KeyArg key, const Value& value);       // 伸展树插入
+    bool      splayDelete(KeyArg key);                           // 伸展树删除
+    bool      treapInsert(KeyArg key, const Value& value);       // 树堆插入
+    bool      treapDelete(KeyArg key);                           // 树堆删除
+    bool      deleteNode(KeyArg key);                            // 迭代删除节点
+    bool      adjustCount(KeyArg key, int delta);                // 修改已有键的重复次数
+    NodeIndex locate(KeyArg key) const;                          // 查找节点下标，不存在时为空节点
+    int       countNodes(NodeIndex node) const;                  // 子树的节点数
+    void      clearTree(NodeIndex node);                         // 迭代回收子树节点（被共用的节点只减少引用数）
+    void      addStep(const QString& description, NodeIndex node); // 记录一个调整步骤
+
+    // 平衡相关方法
+    int       treeToVine();                  // 右旋把整棵树拉直成右链，返回旋转次数
+    NodeIndex compressVine(int count);       // 沿右链左旋 count 次，返回第一个上移的节点
+    void      updateSubtree(NodeIndex node); // 刷新整棵子树的统计信息
+
+    // 多线程平衡：按子树节点数并行取出中序，再并行链接成与 DSW 相同的完全二叉树
+    static const int ParallelCutoff = 1 << 15; // 子树节点数少于这个数时不再分出线程
+    void      flattenParallel(NodeIndex node, NodeIndex* order, int threads);                        // 按子树节点数把子树的中序写入 order（限于集合）
+    NodeIndex linkComplete(const NodeIndex* order, int count, int depth, int redDepth, int threads); // 把有序节点链接成完全二叉树
+
+    // 统计信息维护
+    void updateNodeInfo(NodeIndex node);      // 由孩子重新计算节点的统计信息
+    void updatePath(const NodePath& path);    // 自下而上刷新路径上各节点的统计信息
+    int  balanceFactor(NodeIndex node) const; // 左子树高度减右子树高度
+
+    // 旋转与自平衡
+    NodeIndex rotateLeft(NodeIndex node);                                             // 左旋，返回新的子树根
+    NodeIndex rotateRight(NodeIndex node);                                            // 右旋，返回新的子树根
+    void      replaceChild(NodeIndex parent, NodeIndex oldChild, NodeIndex newChild); // 把父节点指向旧孩子的链接改为新孩子
+    NodeIndex rebalanceAVL(NodeIndex node);                                           // 刷新并在失衡时旋转单个节点
+    void      rebalanceAVLPath(const NodePath& path);                                 // 自下而上恢复路径上的 AVL 平衡
+    void      fixRedBlackInsert(NodeIndex node, NodePath& path);                      // 插入红节点后恢复红黑性质
+    void      fixRedBlackDelete(NodeIndex node, bool isLeft, NodePath& path);         // 摘除黑节点后恢复红黑性质
+    void      colorBalancedTree();                                                    // 为完全平衡的树着色
+    NodeIndex splayNode(NodeIndex node, KeyArg key, int& depth);                      // 自顶向下伸展，返回新的子树根
+
+    // 原地重建
+    void      rebuildScapegoat(NodeIndex created, const NodePath& path); // 插入过深时重建替罪羊子树
+    NodeIndex rebuildSubtree(NodeIndex node);                            // 原地重建子树，返回新的子树根
+    void      flattenSubtree(NodeIndex node);                            // 把子树按中序取到暂存缓冲区
+    NodeIndex linkBalanced(int start, int end);                          // 把暂存的有序节点链接成平衡树
+    NodeIndex linkTreap();                                               // 把暂存的有序节点链接成树堆
+    void      allocateSorted(const QVector<Key>& keys);                  // 排序后按顺序分配节点，重复的键合并
+
+    // 树堆拆分与合并
+    static quint64 treapPriority(KeyArg key);                // 树堆节点的优先级
+    void      splitNode(NodeIndex node, KeyArg key, NodeIndex& left, NodeIndex& right, NodeIndex* equal = nullptr); // 按 key 拆分子树
+    NodeIndex joinNodes(NodeIndex left, NodeIndex right);    // 合并两棵树堆，left 的键全部小于 right
+    NodeIndex unionNodes(NodeIndex first, NodeIndex second); // 求两棵树堆的并，重复的节点被回收
+    void      ensureTreap();                                 // 不是树堆时切换为树堆
+
+    // 写时复制
+    NodeIndex ownNode(NodeIndex node);                       // 取得节点的独占副本
+    NodeIndex ownChild(NodeIndex parent, bool isLeft);       // 取得孩子的独占副本并接回父节点
+    void      ownPath(KeyArg key, bool successor);           // 复制查找路径上被共用的节点
+    void      prepareUpdate(KeyArg key, bool successor);     // 插入、删除前按策略复制被共用的节点
+    void      ownSubtree(NodeIndex node);                    // 复制子树中所有被共用的节点
+    void      detach();                                      // 复制所有被共用的节点，不再与其他版本共用
+};
+
+/***************************************************************************
+  函数名称：SearchTree::visitSubtree
+  功    能：迭代中序遍历子树
+  输入参数：pool - 节点内存池，node - 子树根节点下标，visit - 对每个节点调用的函数
+  返 回 值：
+  说    明：用显式栈代替递归，退化成链的树也不会栈溢出；
+            节点深度随遍历一起算出，传给 visit 的参数为 (节点, 深度)，子树根深度为1
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+template <typename Visitor>
+void SearchTree<Key, Value, Compare>::visitSubtree(const Pool& pool, NodeIndex node, Visitor visit) {
+    QVarLengthArray<QPair<NodeIndex, int>, 64> stack;
+    int depth = 1;
+
+    while (node != NullNode || !stack.isEmpty()) {
+        while (node != NullNode) {
+            stack.append(qMakePair(node, depth));
+            node = pool[node].left;
+            depth++;
+        }
+
+        node  = stack.last().first;
+        depth = stack.last().second;
+        stack.removeLast();
+        visit(pool[node], depth);
+        node = pool[node].right;
+        depth++;
+    }
+}
+
+/***************************************************************************
+  函数名称：SearchTree::treapPriority
+  功    能：计算树堆节点的优先级
+  输入参数：key - 节点的键
+  返 回 值：quint64 - 优先级
+  说    明：优先级由键的散列值与进程内随机种子混合得出，不占节点空间；
+            混合是 64 位上的双射，散列值不同的键优先级不同（整数键一定不同），
+            同一个键在所有同类型的树中优先级一致，拆分、合并后堆序依然成立
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+quint64 SearchTree<Key, Value, Compare>::treapPriority(KeyArg key) {
+    static const quint64 seed = QRandomGenerator::global()->generate64();
+
+    quint64 hash = KeyTraits<Key>::hash(key) ^ seed;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::SearchTree
+  功    能：构造函数，初始化二叉搜索树
+  输入参数：comparator - 键的比较器
+  返 回 值：
+  说    明：初始化根节点为空，不做自平衡
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+SearchTree<Key, Value, Compare>::SearchTree(const Compare& comparator) :
+    root(NullNode)        , nodeCount(0),
+    keyOrder(comparator)  , multiset(false),
+    balancePolicy(BalancePolicy::None),
+    recordSteps(false)    , maxNodeCount(0)
+{
+}
+
+/***************************************************************************
+  函数名称：SearchTree::~SearchTree
+  功    能：析构函数
+  输入参数：
+  返 回 值：
+  说    明：节点内存由内存池随对象一起整块释放；
+            与其他树共用节点存储时把自己的节点还给空闲链表
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+SearchTree<Key, Value, Compare>::~SearchTree() {
+    if (nodePool.isShared()) {
+        clearTree(root);
+    }
+}
+
+/***************************************************************************
+  函数名称：SearchTree::clear
+  功    能：清空树中的所有节点
+  输入参数：
+  返 回 值：
+  说    明：整块释放内存池并将根节点设为空；
+            与其他树共用节点存储时先把自己的节点还给空闲链表，再换用新的存储
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::clear() {
+    if (nodePool.isShared()) {
+        clearTree(root);
+    }
+    nodePool.clear();
+    root = NullNode;
+    nodeCount = 0;
+    maxNodeCount = 0;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::allocateSorted
+  功    能：排序后按顺序分配节点，放入暂存缓冲区
+  输入参数：keys - 要分配的键（可以无序、重复）
+  返 回 值：
+  说    明：已经有序的输入跳过排序；有序后相邻两键“前者不小于后者”即为相等，
+            相等的一段只分配一个节点，多重集合模式下以段长为重复次数，集合模式下丢弃重复；
+            节点尚未链接，由调用者链接成树
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::allocateSorted(const QVector<Key>& keys) {
+    QVector<Key> sorted = keys;
+    auto less = [this](KeyArg a, KeyArg b) { return keyOrder.less(a, b); };
+    if (!std::is_sorted(sorted.begin(), sorted.end(), less)) {
+        std::sort(sorted.begin(), sorted.end(), less);
+    }
+
+    rebuildBuffer.clear();
+    for (int i = 0; i < sorted.size();) {
+        int end = i + 1;
+        while (end < sorted.size() && !keyOrder.less(sorted[i], sorted[end])) {
+            end++;
+        }
+
+        NodeIndex node = nodePool.allocate(sorted[i]);
+        nodePool[node].count = multiset ? end - i : 1;
+        rebuildBuffer.append(node);
+        i = end;
+    }
+}
+
+/***************************************************************************
+  函数名称：SearchTree::assign
+  功    能：用一组键整体替换树的内容
+  输入参数：keys - 新的键（可以无序、重复）
+  返 回 值：
+  说    明：排序后按顺序分配节点，下标连续，重复的键合并为一个节点；
+            再像局部重建一样取中间节点为根链接，排序之后 O(n) 建成完全平衡的树，
+            树堆策略下改为按优先级链接；映射值为默认值
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::assign(const QVector<Key>& keys) {
+    if (nodePool.isShared()) {
+        clearTree(root);
+    }
+    nodePool.clear();
+
+    nodePool.reserve(keys.size());
+    allocateSorted(keys);
+
+    if (balancePolicy == BalancePolicy::Treap) {
+        root = linkTreap();
+    }
+    else {
+        root = linkBalanced(0, rebuildBuffer.size() - 1);
+    }
+
+    nodeCount    = rebuildBuffer.size();
+    maxNodeCount = nodeCount;
+    if (balancePolicy == BalancePolicy::RedBlack) {
+        colorBalancedTree();
+    }
+}
+
+/***************************************************************************
+  函数名称：SearchTree::assignSorted
+  功    能：用一组严格递增的键整体替换树的内容
+  输入参数：keys - 新的键（已排序去重），counts - 多重集合模式下各键的重复次数（为空时均为1），
+            threads - 可用的线程数
+  返 回 值：
+  说    明：一次分配下标连续的全部节点，各线程分段写入键；再用 linkComplete 链接成完全二叉树，
+            形状与 balance 的结果相同；节点数不小于 2*ParallelCutoff 时分线程，
+            树堆策略下按优先级链接（单线程）；映射值为默认值
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::assignSorted(const QVector<Key>& keys, const QVector<int>* counts, int threads) {
+    if (nodePool.isShared()) {
+        clearTree(root);
+    }
+    nodePool.clear();
+
+    const int count = keys.size();
+    nodeCount    = count;
+    maxNodeCount = count;
+    root         = NullNode;
+    if (count == 0) {
+        return;
+    }
+
+    nodePool.reserve(count);
+    NodeIndex first = nodePool.allocateBlock(count);
+    rebuildBuffer.resize(count);
+
+    int        chunks = threads > 1 && count >= ParallelCutoff * 2 ? threads : 1;
+    NodeIndex* order  = rebuildBuffer.data();
+    auto fill = [&](int chunk) {
+        int begin = static_cast<int>(static_cast<qint64>(count) * chunk / chunks);
+        int end   = static_cast<int>(static_cast<qint64>(count) * (chunk + 1) / chunks);
+        for (int i = begin; i < end; i++) {
+            Node& node = nodePool[first + i];
+            node = Node(keys[i]);
+            if (multiset && counts != nullptr) {
+                node.count  = (*counts)[i];
+                node.weight = node.count;
+            }
+            order[i] = first + i;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int chunk = 1; chunk < chunks; chunk++) {
+        workers.emplace_back(fill, chunk);
+    }
+    fill(0);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    if (balancePolicy == BalancePolicy::Treap) {
+        root = linkTreap();
+    }
+    else {
+        int height = 1;
+        while ((1 << height) - 1 < count) {
+            height++;
+        }
+        int redDepth = balancePolicy == BalancePolicy::RedBlack ? height : 0;
+        root = linkComplete(order, count, 1, redDepth, threads);
+    }
+    rebuildBuffer.clear();
+}
+
+/***************************************************************************
+  函数名称：SearchTree::copyFrom
+  功    能：整体复制另一棵树
+  输入参数：other - 被复制的树
+  返 回 值：
+  说    明：节点以下标链接，复制内存池即完成整棵树的复制；
+            自平衡策略一并复制，保证树的性质与策略一致
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::copyFrom(const SearchTree& other) {
+    if (&other == this) {
+        return;
+    }
+
+    if (nodePool.isShared()) {
+        clearTree(root);
+    }
+    nodePool  = other.nodePool;
+    root      = other.root;
+    nodeCount = other.nodeCount;
+    keyOrder  = other.keyOrder;
+    multiset  = other.multiset;
+    balancePolicy = other.balancePolicy;
+    maxNodeCount  = other.maxNodeCount;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::insert
+  功    能：插入新节点到二叉搜索树中
+  输入参数：key - 要插入的键，value - 映射值
+  返 回 值：bool - 是否插入了新节点
+  说    明：迭代插入，只访问查找路径上的节点；键已存在时不插入，也不改动原有的映射值
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+bool SearchTree<Key, Value, Compare>::insert(KeyArg key, const Value& value) {
+    if (nodePool.hasSharedNodes()) {
+        prepareUpdate(key, false);
+    }
+    return insertNode(key, value);
+}
+
+/***************************************************************************
+  函数名称：SearchTree::remove
+  功    能：从二叉搜索树中删除指定键的节点
+  输入参数：key - 要删除的键
+  返 回 值：bool - 是否删除了节点
+  说    明：节点深度在遍历时才计算，删除后无需刷新
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+bool SearchTree<Key, Value, Compare>::remove(KeyArg key) {
+    if (nodePool.hasSharedNodes()) {
+        prepareUpdate(key, true);
+    }
+    return deleteNode(key);
+}
+
+/***************************************************************************
+  函数名称：SearchTree::find
+  功    能：在二叉搜索树中查找指定键
+  输入参数：key - 要查找的键，depth - 用于返回节点深度
+  返 回 值：bool - 是否找到节点
+  说    明：迭代查找节点，不记录路径，整个过程不申请内存；深度即查找经过的层数；
+            伸展树策略下把访问到的节点伸展到根，深度为伸展前的层数，伸展只改动查找路径，先复制路径上被共用的节点
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+bool SearchTree<Key, Value, Compare>::find(KeyArg key, int& depth) {
+    if (balancePolicy != BalancePolicy::Splay) {
+        return findNode(key, depth);
+    }
+
+    if (root == NullNode) {
+        return false;
+    }
+
+    if (nodePool.hasSharedNodes()) {
+        ownPath(key, false);
+    }
+
+    int level;
+    root = splayNode(root, key, level);
+    balanceStats[static_cast<int>(balancePolicy)].operations++;
+
+    if (keyOrder.compare(key, nodePool[root].key) != 0) {
+        return false;
+    }
+    depth = level;
+    return true;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::findNode
+  功    能：迭代查找二叉搜索树中的节点
+  输入参数：key - 要查找的键，depth - 用于返回节点深度
+  返 回 值：bool - 是否找到节点
+  说    明：每层只做一次三路比较，据此向左子树或右子树下降，找到时以经过的层数作为深度
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+bool SearchTree<Key, Value, Compare>::findNode(KeyArg key, int& depth) const {
+    NodeIndex node  = root;
+    int       level = 1;
+
+    while (node != NullNode) {
+        const Node& current = nodePool[node];
+        int         order   = keyOrder.compare(key, current.key);
+
+        if (order == 0) {
+            depth = level;
+            return true;
+        }
+
+        node = order < 0 ? current.left : current.right;
+        level++;
+    }
+
+    return false;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::locate
+  功    能：查找节点下标
+  输入参数：key - 要查找的键
+  返 回 值：NodeIndex - 节点下标，不存在时为空节点
+  说    明：
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+NodeIndex SearchTree<Key, Value, Compare>::locate(KeyArg key) const {
+    NodeIndex node = root;
+
+    while (node != NullNode) {
+        const Node& current = nodePool[node];
+        int         order   = keyOrder.compare(key, current.key);
+
+        if (order == 0) {
+            break;
+        }
+        node = order < 0 ? current.left : current.right;
+    }
+
+    return node;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::countNodes
+  功    能：求子树的节点数
+  输入参数：node - 子树根节点下标
+  返 回 值：int - 子树的节点数（不计重复次数）
+  说    明：节点不存子树节点数；集合的重复次数都为1，直接取重复次数之和，O(1)；
+            多重集合用显式栈数出子树的节点，O(m)
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+int SearchTree<Key, Value, Compare>::countNodes(NodeIndex node) const {
+    if (!multiset) {
+        return nodePool[node].weight;
+    }
+
+    int count = 0;
+    visitSubtree(nodePool, node, [&count](const Node&, int) { count++; });
+    return count;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::adjustCount
+  功    能：修改已有键的重复次数
+  输入参数：key - 键，delta - 重复次数的增量
+  返 回 值：bool - 是否修改成功
+  说    明：键不存在或修改后重复次数小于1时不修改；
+            树的形状不变，只需把增量加到键所在节点及其祖先的重复次数之和上，O(树高)
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+bool SearchTree<Key, Value, Compare>::adjustCount(KeyArg key, int delta) {
+    NodePath  path;
+    NodeIndex node = root;
+    int       order;
+
+    while (node != NullNode && (order = keyOrder.compare(key, nodePool[node].key)) != 0) {
+        path.append(node);
+        node = order < 0 ? nodePool[node].left : nodePool[node].right;
+    }
+
+    if (node == NullNode || nodePool[node].count + delta < 1) {
+        return false;
+    }
+
+    nodePool[node].count  += delta;
+    nodePool[node].weight += delta;
+    for (NodeIndex ancestor : path) {
+        nodePool[ancestor].weight += delta;
+    }
+
+    balanceStats[static_cast<int>(balancePolicy)].operations++;
+    return true;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::count
+  功    能：查询键的重复次数
+  输入参数：key - 要查找的键
+  返 回 值：int - 重复次数，键不存在时为0
+  说    明：集合中存在的键重复次数恒为1；空节点的重复次数为0，无需判空
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+int SearchTree<Key, Value, Compare>::count(KeyArg key) const {
+    return nodePool[locate(key)].count;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::contains
+  功    能：检查键是否在树中
+  输入参数：key - 要查找的键
+  返 回 值：bool - 是否存在
+  说    明：伸展树策略下也不伸展
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+bool SearchTree<Key, Value, Compare>::contains(KeyArg key) const {
+    return locate(key) != NullNode;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::findValue
+  功    能：获取键对应的映射值
+  输入参数：key - 要查找的键
+  返 回 值：Value* - 映射值，键不存在时为空
+  说    明：返回的指针在下一次插入前有效（插入可能使内存池扩容）；不伸展；
+            映射值可能被改写，与其他版本共用的路径先复制
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+Value* SearchTree<Key, Value, Compare>::findValue(KeyArg key) {
+    if (nodePool.hasSharedNodes()) {
+        ownPath(key, false);
+    }
+    NodeIndex node = locate(key);
+    return node == NullNode ? nullptr : &nodePool[node].value;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::findValue
+  功    能：获取键对应的映射值
+  输入参数：key - 要查找的键
+  返 回 值：const Value* - 映射值，键不存在时为空
+  说    明：
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+const Value* SearchTree<Key, Value, Compare>::findValue(KeyArg key) const {
+    NodeIndex node = locate(key);
+    return node == NullNode ? nullptr : &nodePool[node].value;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::findMany
+  功    能：批量查找一组键
+  输入参数：keys - 要查找的键，depths - 用于返回每个键的深度
+  返 回 值：int - 找到的键的个数
+  说    明：同时推进 FindGroupSize 路互不相关的查找，每路走一层后预取下一层的节点，
+            轮到它时节点多半已在缓存中，一路的缓存未命中与其他路的比较重叠；
+            某一路结束后立即换上下一个键；depths[i] 与 find 的深度相同，未找到为0；
+            只读，伸展树策略下也不伸展
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+int SearchTree<Key, Value, Compare>::findMany(const QVector<Key>& keys, QVector<int>& depths) const {
+    struct Lookup {
+        NodeIndex node;  // 当前节点
+        int       level; // 当前节点的深度
+        int       slot;  // 在 keys 中的位置
+    };
+
+    Lookup group[FindGroupSize];
+    int    active = 0;
+    int    next   = 0;
+    int    found  = 0;
+
+    depths.resize(keys.size());
+    while (active < FindGroupSize && next < keys.size()) {
+        group[active++] = Lookup{ root, 1, next };
+        next++;
+    }
+
+    while (active > 0) {
+        for (int i = 0; i < active;) {
+            Lookup&     lookup  = group[i];
+            const Node& current = nodePool[lookup.node];
+            int         order   = lookup.node == NullNode ? 0 : keyOrder.compare(keys[lookup.slot], current.key);
+
+            if (order != 0) {
+                lookup.node = order < 0 ? current.left : current.right;
+                lookup.level++;
+                nodePool.prefetch(lookup.node);
+                i++;
+                continue;
+            }
+
+            if (lookup.node != NullNode) {
+                depths[lookup.slot] = lookup.level;
+                found++;
+            }
+            else {
+                depths[lookup.slot] = 0;
+            }
+
+            // 这一路结束，换上下一个键；没有剩余的键时用最后一路填补空位
+            if (next < keys.size()) {
+                lookup = Lookup{ root, 1, next };
+                next++;
+                i++;
+            }
+            else {
+                lookup = group[--active];
+            }
+        }
+    }
+
+    return found;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::toString
+  功    能：获取二叉搜索树的字符串表示
+  输入参数：
+  返 回 值：QString - 中序遍历结果，树为空时为空字符串
+  说    明：每个节点输出为“键(深度) ”，重复多次的键输出为“键×次数(深度) ”，键的文本由 KeyTraits 给出
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+QString SearchTree<Key, Value, Compare>::toString() const {
+    QString result;
+    visitInOrder([&result](const Node& current, int depth) {
+        result += KeyTraits<Key>::toString(current.key);
+        if (current.count > 1) {
+            result += QString::fromUtf8("×") + QString::number(current.count);
+        }
+        result += "(" + QString::number(depth) + ") ";
+    });
+    return result;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::lowerBound
+  功    能：查找不小于 key 的最小键
+  输入参数：key - 要查找的键，result - 用于返回找到的键
+  返 回 值：bool - 是否存在这样的键
+  说    明：沿树下降，每次向左走时记下当前节点
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+bool SearchTree<Key, Value, Compare>::lowerBound(KeyArg key, Key& result) const {
+    NodeIndex node  = root;
+    NodeIndex found = NullNode;
+    while (node != NullNode) {
+        const Node& current = nodePool[node];
+        if (keyOrder.less(current.key, key)) {
+            node = current.right;
+        }
+        else {
+            found = node;
+            node  = current.left;
+        }
+    }
+
+    if (found == NullNode) {
+        return false;
+    }
+    result = nodePool[found].key;
+    return true;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::rank
+  功    能：统计树中小于指定键的元素数
+  输入参数：key - 比较的键
+  返 回 值：int - 小于 key 的元素数
+  说    明：沿查找路径下降，每次向右走时累加左子树和当前节点的重复次数，O(树高)；
+            集合的重复次数都为1，即为节点数
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+int SearchTree<Key, Value, Compare>::rank(KeyArg key) const {
+    NodeIndex node  = root;
+    int       count = 0;
+
+    while (node != NullNode) {
+        const Node& current = nodePool[node];
+        int         order   = keyOrder.compare(key, current.key);
+
+        if (order <= 0) {
+            if (order == 0) {
+                return count + nodePool[current.left].weight;
+            }
+            node = current.left;
+        }
+        else {
+            count += nodePool[current.left].weight + current.count;
+            node = current.right;
+        }
+    }
+
+    return count;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::select
+  功    能：查找第 k 小的元素
+  输入参数：k - 名次（从1开始），key - 用于返回找到的键
+  返 回 值：bool - k 是否在有效范围内
+  说    明：比较 k 与左子树的重复次数之和决定向左、向右或停在当前节点，O(树高)；
+            多重集合中重复 c 次的键占据连续 c 个名次
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+bool SearchTree<Key, Value, Compare>::select(int k, Key& key) const {
+    if (k < 1 || k > getTotalCount()) {
+        return false;
+    }
+
+    NodeIndex node = root;
+
+    while (node != NullNode) {
+        const Node& current = nodePool[node];
+        int leftWeight = nodePool[current.left].weight;
+
+        if (k <= leftWeight) {
+            node = current.left;
+        }
+        else if (k <= leftWeight + current.count) {
+            key = current.key;
+            return true;
+        }
+        else {
+            k -= leftWeight + current.count;
+            node = current.right;
+        }
+    }
+
+    return false;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::sample
+  功    能：等概率随机取出树中的一个元素
+  输入参数：key - 用于返回取到的键
+  返 回 值：bool - 树非空时返回true
+  说    明：随机生成名次后调用 select，O(树高)；多重集合中键被取到的概率与重复次数成正比
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+bool SearchTree<Key, Value, Compare>::sample(Key& key) const {
+    if (nodeCount == 0) {
+        return false;
+    }
+
+    int k = static_cast<int>(QRandomGenerator::global()->bounded(static_cast<quint32>(getTotalCount()))) + 1;
+    return select(k, key);
+}
+
+/***************************************************************************
+  函数名称：SearchTree::findPath
+  功    能：迭代查找节点并记录查找路径
+  输入参数：key - 要查找的键，path - 用于记录查找路径
+  返 回 值：bool - 是否找到节点
+  说    明：根据比较结果向左子树或右子树下降，记录路径但不设置深度；
+            路径使用内联缓冲区，较浅的树不会申请堆内存
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+bool SearchTree<Key, Value, Compare>::findPath(KeyArg key, KeyPath& path) const {
+    NodeIndex node = root;
+
+    while (node != NullNode) {
+        const Node& current = nodePool[node];
+        int         order   = keyOrder.compare(key, current.key);
+
+        // 记录路径
+        path.append(current.key);
+
+        if (order == 0) {
+            return true;
+        }
+
+        node = order < 0 ? current.left : current.right;
+    }
+
+    return false;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::selectPath
+  功    能：选择第 k 小的节点并记录访问路径
+  输入参数：k - 名次（从1开始），path - 用于记录访问路径
+  返 回 值：bool - 是否找到节点
+  说    明：与 select 的下降过程相同，额外记录经过的键，供动画高亮使用
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+bool SearchTree<Key, Value, Compare>::selectPath(int k, KeyPath& path) const {
+    if (k < 1 || k > getTotalCount()) {
+        return false;
+    }
+
+    NodeIndex node = root;
+
+    while (node != NullNode) {
+        const Node& current = nodePool[node];
+        int leftWeight = nodePool[current.left].weight;
+
+        // 记录路径
+        path.append(current.key);
+
+        if (k <= leftWeight) {
+            node = current.left;
+        }
+        else if (k <= leftWeight + current.count) {
+            return true;
+        }
+        else {
+            k -= leftWeight + current.count;
+            node = current.right;
+        }
+    }
+
+    return false;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::takeSteps
+  功    能：取出已记录的调整步骤
+  输入参数：
+  返 回 值：QVector<Step> - 自上次取出以来记录的步骤
+  说    明：取出后清空
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+QVector<typename SearchTree<Key, Value, Compare>::Step> SearchTree<Key, Value, Compare>::takeSteps() {
+    QVector<Step> taken;
+    taken.swap(steps);
+    return taken;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::addStep
+  功    能：记录一个调整步骤
+  输入参数：description - 步骤说明，node - 要高亮的节点（为空表示不高亮）
+  返 回 值：
+  说    明：只在 recordSteps 打开时由调用者调用
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::addStep(const QString& description, NodeIndex node) {
+    steps.append(Step{ description, nodePool[node].key, node != NullNode });
+}
+
+/***************************************************************************
+  函数名称：SearchTree::insertNode
+  功    能：迭代插入节点到二叉搜索树中
+  输入参数：key - 要插入的键，value - 映射值
+  返 回 值：bool - 是否插入了新节点
+  说    明：沿查找路径下降到空位置后挂上新节点，如果键已存在则不插入，多重集合模式下增加其重复次数；
+            分配节点可能使内存池扩容，因此只记录路径上的下标，分配后再写回链接；
+            最后按自平衡策略自下而上刷新路径上的统计信息并恢复平衡
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+bool SearchTree<Key, Value, Compare>::insertNode(KeyArg key, const Value& value) {
+    if (balancePolicy == BalancePolicy::Splay) {
+        return splayInsert(key, value);
+    }
+    if (balancePolicy == BalancePolicy::Treap) {
+        return treapInsert(key, value);
+    }
+
+    NodePath  path;
+    NodeIndex node   = root;
+    bool      isLeft = false;
+
+    while (node != NullNode) {
+        const Node& current = nodePool[node];
+        int         order   = keyOrder.compare(key, current.key);
+        if (order == 0) {
+            return multiset && adjustCount(key, 1); // 键已存在，集合不插入
+        }
+
+        path.append(node);
+        isLeft = order < 0;
+        node   = isLeft ? current.left : current.right;
+    }
+
+    NodeIndex created = nodePool.allocate(key);
+    setPayload(nodePool[created], value);
+    nodeCount++;
+
+    if (path.isEmpty()) {
+        root = created;
+    }
+    else if (isLeft) {
+        nodePool[path.last()].left = created;
+    }
+    else {
+        nodePool[path.last()].right = created;
+    }
+
+    switch (balancePolicy) {
+    case BalancePolicy::AVL:
+        rebalanceAVLPath(path);
+        break;
+    case BalancePolicy::RedBlack:
+        nodePool[created].red = 1;  // 新节点为红色
+        updatePath(path);
+        fixRedBlackInsert(created, path);
+        break;
+    case BalancePolicy::Scapegoat:
+        updatePath(path);
+        maxNodeCount = std::max(maxNodeCount, nodeCount);
+        rebuildScapegoat(created, path);
+        break;
+    default:
+        updatePath(path);
+        break;
+    }
+
+    balanceStats[static_cast<int>(balancePolicy)].operations++;
+    return true;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::deleteNode
+  功    能：迭代删除二叉搜索树中的节点
+  输入参数：key - 要删除的键
+  返 回 值：bool - 是否删除了节点
+  说    明：多重集合中重复多次的键只减少一次重复次数，不摘除节点；
+            否则先下降找到要删除的节点，有两个子节点时用后继节点的键、映射值和重复次数覆盖当前节点，
+            转而摘除后继节点，这样被摘除的节点至多只有一个孩子，用孩子顶替它即可；
+            摘除后按自平衡策略自下而上刷新路径上的统计信息并恢复平衡
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+bool SearchTree<Key, Value, Compare>::deleteNode(KeyArg key) {
+    if (balancePolicy == BalancePolicy::Splay) {
+        return splayDelete(key);
+    }
+    if (multiset && adjustCount(key, -1)) {
+        return true;
+    }
+    if (balancePolicy == BalancePolicy::Treap) {
+        return treapDelete(key);
+    }
+
+    NodePath  path;
+    NodeIndex node = root;
+    int       order;
+
+    while (node != NullNode && (order = keyOrder.compare(key, nodePool[node].key)) != 0) {
+        path.append(node);
+        node = order < 0 ? nodePool[node].left : nodePool[node].right;
+    }
+
+    if (node == NullNode) {
+        return false;
+    }
+
+    nodeCount--;
+
+    if (nodePool[node].left != NullNode && nodePool[node].right != NullNode) {
+        path.append(node);
+        NodeIndex successor = nodePool[node].right;
+        while (nodePool[successor].left != NullNode) {
+            path.append(successor);
+            successor = nodePool[successor].left;
+        }
+
+        Node& target = nodePool[node];
+        Node& source = nodePool[successor];
+        target.key   = std::move(source.key);
+        target.count = source.count;
+        static_cast<NodePayload<Value>&>(target) = std::move(static_cast<NodePayload<Value>&>(source));
+        node = successor;
+    }
+
+    // 被摘除的节点至多有一个孩子
+    const Node& removed = nodePool[node];
+    NodeIndex parent     = path.isEmpty() ? NullNode : path.last();
+    NodeIndex child      = removed.left != NullNode ? removed.left : removed.right;
+    bool      removedRed = removed.red;
+    bool      isLeft     = parent != NullNode && nodePool[parent].left == node;
+
+    replaceChild(parent, node, child);
+    nodePool.release(node);
+
+    switch (balancePolicy) {
+    case BalancePolicy::AVL:
+        rebalanceAVLPath(path);
+        break;
+    case BalancePolicy::RedBlack:
+        updatePath(path);
+        if (!removedRed) {
+            fixRedBlackDelete(child, isLeft, path);
+        }
+        break;
+    case BalancePolicy::Scapegoat:
+        updatePath(path);
+        // 删除过多后整棵树重建，保证树高仍为 O(log n)
+        if (nodeCount < ScapegoatAlpha * maxNodeCount) {
+            detach();
+            root = rebuildSubtree(root);
+            maxNodeCount = nodeCount;
+        }
+        break;
+    default:
+        updatePath(path);
+        break;
+    }
+
+    balanceStats[static_cast<int>(balancePolicy)].operations++;
+    return true;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::splayInsert
+  功    能：伸展树插入
+  输入参数：key - 要插入的键，value - 映射值
+  返 回 值：bool - 是否插入了新节点
+  说    明：先按 key 伸展，根即为 key 的前驱或后继；键已存在时它被伸展到根，
+            多重集合模式下增加根的重复次数即可；否则新节点成为根，原根连同它一侧的子树挂到新节点下
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+bool SearchTree<Key, Value, Compare>::splayInsert(KeyArg key, const Value& value) {
+    int depth;
+    if (root != NullNode) {
+        root = splayNode(root, key, depth);
+        if (keyOrder.compare(key, nodePool[root].key) == 0) {
+            if (!multiset) {
+                return false;   // 键已存在，集合不插入
+            }
+            nodePool[root].count++;
+            updateNodeInfo(root);
+            balanceStats[static_cast<int>(balancePolicy)].operations++;
+            return true;
+        }
+    }
+
+    NodeIndex created = nodePool.allocate(key);
+    setPayload(nodePool[created], value);
+    nodeCount++;
+
+    if (root != NullNode) {
+        Node& top  = nodePool[root];
+        Node& node = nodePool[created];
+        if (keyOrder.less(key, top.key)) {
+            node.left  = top.left;
+            node.right = root;
+            top.left   = NullNode;
+        }
+        else {
+            node.right = top.right;
+            node.left  = root;
+            top.right  = NullNode;
+        }
+        updateNodeInfo(root);
+        updateNodeInfo(created);
+    }
+    root = created;
+
+    balanceStats[static_cast<int>(balancePolicy)].operations++;
+    return true;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::splayDelete
+  功    能：伸展树删除
+  输入参数：key - 要删除的键
+  返 回 值：bool - 是否删除了节点
+  说    明：先把 key 伸展到根，重复多次时只减少根的重复次数，否则摘除根；再在左子树中伸展最大键，
+            它没有右孩子，把右子树接上即可；未找到时树也已被伸展
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+bool SearchTree<Key, Value, Compare>::splayDelete(KeyArg key) {
+    if (root == NullNode) {
+        return false;
+    }
+
+    int depth;
+    root = splayNode(root, key, depth);
+    balanceStats[static_cast<int>(balancePolicy)].operations++;
+    if (keyOrder.compare(key, nodePool[root].key) != 0) {
+        return false;
+    }
+    if (nodePool[root].count > 1) {
+        nodePool[root].count--;
+        updateNodeInfo(root);
+        return true;
+    }
+
+    // 伸展左子树前先复制键，回收根后 key 可能引用的就是根的键
+    Key       target = key;
+    NodeIndex left   = nodePool[root].left;
+    NodeIndex right  = nodePool[root].right;
+    nodePool.release(root);
+    nodeCount--;
+
+    if (left == NullNode) {
+        root = right;
+        return true;
+    }
+
+    // key 大于左子树中所有键，伸展后左子树的最大键成为根；伸展经过的右脊不在第一次伸展的路径上，先复制
+    root = left;
+    if (nodePool.hasSharedNodes()) {
+        ownPath(target, false);
+    }
+    root = splayNode(root, target, depth);
+    nodePool[root].right = right;
+    updateNodeInfo(root);
+    return true;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::treapInsert
+  功    能：树堆插入
+  输入参数：key - 要插入的键，value - 映射值
+  返 回 值：bool - 是否插入了新节点
+  说    明：沿查找路径下降到第一个优先级低于新节点的位置，把该处子树按 key 拆分，
+            两半分别作为新节点的左右子树；期望 O(log n)，不需要旋转；
+            键已存在时多重集合模式下增加其重复次数
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+bool SearchTree<Key, Value, Compare>::treapInsert(KeyArg key, const Value& value) {
+    int depth;
+    if (findNode(key, depth)) {
+        return multiset && adjustCount(key, 1); // 键已存在，集合不插入
+    }
+
+    quint64   priority = treapPriority(key);
+    NodePath  path;
+    NodeIndex node     = root;
+    bool      isLeft   = false;
+
+    while (node != NullNode && treapPriority(nodePool[node].key) > priority) {
+        path.append(node);
+        isLeft = keyOrder.less(key, nodePool[node].key);
+        node   = isLeft ? nodePool[node].left : nodePool[node].right;
+    }
+
+    NodeIndex left, right;
+    splitNode(node, key, left, right);
+
+    NodeIndex created = nodePool.allocate(key);
+    setPayload(nodePool[created], value);
+    nodePool[created].left  = left;
+    nodePool[created].right = right;
+    updateNodeInfo(created);
+    nodeCount++;
+
+    if (path.isEmpty()) {
+        root = created;
+    }
+    else if (isLeft) {
+        nodePool[path.last()].left = created;
+    }
+    else {
+        nodePool[path.last()].right = created;
+    }
+    updatePath(path);
+
+    balanceStats[static_cast<int>(balancePolicy)].operations++;
+    return true;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::treapDelete
+  功    能：树堆删除
+  输入参数：key - 要删除的键
+  返 回 值：bool - 是否删除了节点
+  说    明：找到节点后把它的左右子树合并，顶替它的位置
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+bool SearchTree<Key, Value, Compare>::treapDelete(KeyArg key) {
+    NodePath  path;
+    NodeIndex node = root;
+    int       order;
+
+    while (node != NullNode && (order = keyOrder.compare(key, nodePool[node].key)) != 0) {
+        path.append(node);
+        node = order < 0 ? nodePool[node].left : nodePool[node].right;
+    }
+
+    if (node == NullNode) {
+        return false;
+    }
+
+    NodeIndex joined = joinNodes(nodePool[node].left, nodePool[node].right);
+    replaceChild(path.isEmpty() ? NullNode : path.last(), node, joined);
+    nodePool.release(node);
+    nodeCount--;
+    updatePath(path);
+
+    balanceStats[static_cast<int>(balancePolicy)].operations++;
+    return true;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::clearTree
+  功    能：迭代回收子树的所有节点
+  输入参数：node - 子树根节点下标
+  返 回 值：
+  说    明：有左孩子时右旋把左孩子提上来，没有左孩子时回收当前节点并转向右孩子；
+            不需要栈，退化成链的树也能在 O(n) 时间内回收完；
+            遇到被其他版本共用的节点只减少它的引用数，整棵子树留给其他版本，也不做旋转
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::clearTree(NodeIndex node) {
+    // dropRef 对独占的节点没有副作用，对共用的节点减少引用数，之后当作空子树
+    if (!nodePool.dropRef(node)) {
+        return;
+    }
+
+    while (node != NullNode) {
+        Node& current = nodePool[node];
+
+        if (current.left != NullNode) {
+            NodeIndex left = current.left;
+            if (!nodePool.dropRef(left)) {
+                current.left = NullNode;
+                continue;
+            }
+            current.left = nodePool[left].right;
+            nodePool[left].right = node;
+            node = left;
+        }
+        else {
+            NodeIndex right = current.right;
+            nodePool.release(node);
+            node = nodePool.dropRef(right) ? right : NullNode;
+        }
+    }
+}
+
+/***************************************************************************
+  函数名称：SearchTree::treeToVine
+  功    能：把整棵树右旋拉直成一条右链
+  输入参数：
+  返 回 值：int - 右旋次数
+  说    明：DSW 算法的第一阶段，沿右链向下，有左孩子就在该处右旋；
+            父节点为空表示当前节点是根，不需要额外的伪根节点；
+            旋转时不刷新统计信息，由 balance 在最后统一刷新
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+int SearchTree<Key, Value, Compare>::treeToVine() {
+    NodeIndex parent = NullNode;
+    NodeIndex node   = root;
+    int rotations = 0;
+
+    while (node != NullNode) {
+        NodeIndex left = nodePool[node].left;
+
+        if (left != NullNode) {
+            nodePool[node].left  = nodePool[left].right;
+            nodePool[left].right = node;
+            replaceChild(parent, node, left);
+            node = left;
+            rotations++;
+        }
+        else {
+            parent = node;
+            node   = nodePool[node].right;
+        }
+    }
+
+    return rotations;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::compressVine
+  功    能：沿根的右链做一轮压缩
+  输入参数：count - 本轮左旋次数
+  返 回 值：NodeIndex - 本轮第一个上移的节点（用于动画高亮）
+  说    明：DSW 算法的第二阶段，从根开始每隔一个节点左旋一次，
+            右链长度减半，被旋下的节点成为上移节点的左孩子
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+NodeIndex SearchTree<Key, Value, Compare>::compressVine(int count) {
+    NodeIndex parent = NullNode;
+    NodeIndex node   = root;
+    NodeIndex first  = NullNode;
+
+    for (int i = 0; i < count; i++) {
+        NodeIndex pivot = nodePool[node].right;
+        nodePool[node].right = nodePool[pivot].left;
+        nodePool[pivot].left = node;
+        replaceChild(parent, node, pivot);
+
+        if (first == NullNode) {
+            first = pivot;
+        }
+        parent = pivot;
+        node   = nodePool[pivot].right;
+    }
+
+    return first;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::updateSubtree
+  功    能：自下而上刷新整棵子树的统计信息
+  输入参数：node - 子树根节点下标
+  返 回 值：
+  说    明：只在平衡后的树上调用，递归深度为 O(log n)
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::updateSubtree(NodeIndex node) {
+    if (node == NullNode) {
+        return;
+    }
+
+    updateSubtree(nodePool[node].left);
+    updateSubtree(nodePool[node].right);
+    updateNodeInfo(node);
+}
+
+/***************************************************************************
+  函数名称：SearchTree::flattenParallel
+  功    能：把子树的节点按中序写入数组
+  输入参数：node - 子树根节点下标，order - 写入位置（长度为子树节点数），threads - 可用的线程数
+  返 回 值：
+  说    明：左子树的节点数即为根在中序中的位置，集合中取自重复次数之和，多重集合只能单线程调用；
+            左右子树写入的区间互不重叠，可以同时进行；
+            threads 大于1且子树不小于 ParallelCutoff 时左子树交给新线程、线程数对半分，
+            否则在当前线程上用显式栈遍历；只读节点，不改变树
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::flattenParallel(NodeIndex node, NodeIndex* order, int threads) {
+    if (node == NullNode) {
+        return;
+    }
+
+    const Node& current = nodePool[node];
+    if (threads > 1 && current.weight >= ParallelCutoff) {
+        int leftSize = nodePool[current.left].weight;
+        order[leftSize] = node;
+
+        std::thread left(&SearchTree::flattenParallel, this, current.left, order, threads / 2);
+        flattenParallel(current.right, order + leftSize + 1, threads - threads / 2);
+        left.join();
+        return;
+    }
+
+    QVarLengthArray<NodeIndex, 64> stack;
+    int position = 0;
+    while (node != NullNode || !stack.isEmpty()) {
+        while (node != NullNode) {
+            stack.append(node);
+            node = nodePool[node].left;
+        }
+        node = stack.last();
+        stack.removeLast();
+        order[position++] = node;
+        node = nodePool[node].right;
+    }
+}
+
+/***************************************************************************
+  函数名称：SearchTree::linkComplete
+  功    能：把按中序排列的节点链接成完全二叉树
+  输入参数：order - 有序节点，count - 节点数，depth - 子树根的深度（根为1），
+            redDepth - 红黑树策略下为整棵树的高度，最深一层染红，其他策略为0，不改颜色，
+            threads - 可用的线程数
+  返 回 值：NodeIndex - 子树根节点下标
+  说    明：除最深一层外全满、最深一层从左到右依次排列，与 DSW 平衡的结果形状相同：
+            最深一层有 b 个节点、上面 h 层全满时，左子树分到最深一层的前 min(b, 2^(h-1)) 个；
+            左右子树链接的节点互不重叠，threads 大于1且节点数不小于 ParallelCutoff 时左子树交给新线程；
+            孩子链接完成后刷新本节点的统计信息
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+NodeIndex SearchTree<Key, Value, Compare>::linkComplete(const NodeIndex* order, int count, int depth, int redDepth, int threads) {
+    if (count == 0) {
+        return NullNode;
+    }
+
+    int full = 1; // 除最深一层外的节点数 2^h - 1
+    while (full * 2 + 1 <= count) {
+        full = full * 2 + 1;
+    }
+    int half     = (full + 1) / 2; // 最深一层每侧最多容纳的节点数 2^(h-1)
+    int leftSize = count == full ? full / 2 : (half - 1) + std::min(count - full, half);
+
+    NodeIndex node = order[leftSize];
+    NodeIndex left, right;
+    if (threads > 1 && count >= ParallelCutoff) {
+        std::thread worker([&]() {
+            left = linkComplete(order, leftSize, depth + 1, redDepth, threads / 2);
+        });
+        right = linkComplete(order + leftSize + 1, count - leftSize - 1, depth + 1, redDepth, threads - threads / 2);
+        worker.join();
+    }
+    else {
+        left  = linkComplete(order, leftSize, depth + 1, redDepth, 1);
+        right = linkComplete(order + leftSize + 1, count - leftSize - 1, depth + 1, redDepth, 1);
+    }
+
+    Node& current = nodePool[node];
+    current.left  = left;
+    current.right = right;
+    if (redDepth > 0) {
+        current.red = depth == redDepth && depth > 1;
+    }
+    updateNodeInfo(node);
+    return node;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::updateNodeInfo
+  功    能：由孩子重新计算节点的子树高度和重复次数之和
+  输入参数：node - 节点下标
+  返 回 值：
+  说    明：空孩子的各项统计为0（0号空节点槽位），无需判空
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::updateNodeInfo(NodeIndex node) {
+    Node& current = nodePool[node];
+    const Node& left  = nodePool[current.left];
+    const Node& right = nodePool[current.right];
+
+    current.height = 1 + std::max(left.height, right.height);
+    current.weight = current.count + left.weight + right.weight;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::updatePath
+  功    能：自下而上刷新路径上各节点的统计信息
+  输入参数：path - 从根向下经过的节点下标
+  返 回 值：
+  说    明：插入或删除只改变路径上节点的子树，其余节点的统计信息不受影响
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::updatePath(const NodePath& path) {
+    for (int i = path.size() - 1; i >= 0; i--) {
+        updateNodeInfo(path[i]);
+    }
+}
+
+/***************************************************************************
+  函数名称：SearchTree::balanceFactor
+  功    能：计算节点的平衡因子
+  输入参数：node - 节点下标
+  返 回 值：int - 左子树高度减右子树高度
+  说    明：空孩子的高度为0，无需判空
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+int SearchTree<Key, Value, Compare>::balanceFactor(NodeIndex node) const {
+    const Node& current = nodePool[node];
+    return static_cast<int>(nodePool[current.left].height) - static_cast<int>(nodePool[current.right].height);
+}
+
+/***************************************************************************
+  函数名称：SearchTree::rotateLeft
+  功    能：以节点为轴左旋
+  输入参数：node - 子树根节点下标
+  返 回 值：NodeIndex - 旋转后的子树根（原右孩子）
+  说    明：调用者负责把父节点的链接改到新的子树根；
+            先刷新下移的节点再刷新上移的节点，子树节点数不变，高度可能变化；
+            node 须为本树独占，上移的孩子与其他版本共用时先复制；
+            记录调整步骤时把这次旋转记为一个步骤
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+NodeIndex SearchTree<Key, Value, Compare>::rotateLeft(NodeIndex node) {
+    NodeIndex pivot = ownChild(node, false);
+    nodePool[node].right = nodePool[pivot].left;
+    nodePool[pivot].left = node;
+    updateNodeInfo(node);
+    updateNodeInfo(pivot);
+
+    balanceStats[static_cast<int>(balancePolicy)].rotations++;
+    if (recordSteps) {
+        addStep(QString::fromUtf8("在节点 %1 处左旋，%2 上移")
+            .arg(KeyTraits<Key>::toString(nodePool[node].key), KeyTraits<Key>::toString(nodePool[pivot].key)), pivot);
+    }
+    return pivot;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::rotateRight
+  功    能：以节点为轴右旋
+  输入参数：node - 子树根节点下标
+  返 回 值：NodeIndex - 旋转后的子树根（原左孩子）
+  说    明：与 rotateLeft 对称
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+NodeIndex SearchTree<Key, Value, Compare>::rotateRight(NodeIndex node) {
+    NodeIndex pivot = ownChild(node, true);
+    nodePool[node].left = nodePool[pivot].right;
+    nodePool[pivot].right = node;
+    updateNodeInfo(node);
+    updateNodeInfo(pivot);
+
+    balanceStats[static_cast<int>(balancePolicy)].rotations++;
+    if (recordSteps) {
+        addStep(QString::fromUtf8("在节点 %1 处右旋，%2 上移")
+            .arg(KeyTraits<Key>::toString(nodePool[node].key), KeyTraits<Key>::toString(nodePool[pivot].key)), pivot);
+    }
+    return pivot;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::replaceChild
+  功    能：把父节点指向旧孩子的链接改为新孩子
+  输入参数：parent - 父节点下标（为空表示旧孩子是根），oldChild - 旧孩子，newChild - 新孩子
+  返 回 值：
+  说    明：旋转或摘除节点后用于接回父节点
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::replaceChild(NodeIndex parent, NodeIndex oldChild, NodeIndex newChild) {
+    if (parent == NullNode) {
+        root = newChild;
+    }
+    else if (nodePool[parent].left == oldChild) {
+        nodePool[parent].left = newChild;
+    }
+    else {
+        nodePool[parent].right = newChild;
+    }
+}
+
+/***************************************************************************
+  函数名称：SearchTree::rebalanceAVL
+  功    能：刷新节点的统计信息，失衡时旋转恢复 AVL 平衡
+  输入参数：node - 节点下标（孩子的统计信息已是最新）
+  返 回 值：NodeIndex - 处理后的子树根
+  说    明：平衡因子由左右子树高度得出；左右型、右左型先旋转孩子再旋转自身，
+            删除后较高的孩子可能不在查找路径上，先取得它的独占副本
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+NodeIndex SearchTree<Key, Value, Compare>::rebalanceAVL(NodeIndex node) {
+    updateNodeInfo(node);
+    int factor = balanceFactor(node);
+
+    if (factor > 1) {
+        if (balanceFactor(nodePool[node].left) < 0) {
+            NodeIndex child = ownChild(node, true);
+            nodePool[node].left = rotateLeft(child);
+        }
+        return rotateRight(node);
+    }
+    if (factor < -1) {
+        if (balanceFactor(nodePool[node].right) > 0) {
+            NodeIndex child = ownChild(node, false);
+            nodePool[node].right = rotateRight(child);
+        }
+        return rotateLeft(node);
+    }
+
+    return node;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::rebalanceAVLPath
+  功    能：自下而上恢复路径上的 AVL 平衡
+  输入参数：path - 从根向下经过的节点下标
+  返 回 值：
+  说    明：同时完成统计信息的刷新；旋转后的子树根接回路径上的父节点
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::rebalanceAVLPath(const NodePath& path) {
+    for (int i = path.size() - 1; i >= 0; i--) {
+        NodeIndex node = path[i];
+        NodeIndex top  = rebalanceAVL(node);
+        if (top != node) {
+            replaceChild(i > 0 ? path[i - 1] : NullNode, node, top);
+        }
+    }
+}
+
+/***************************************************************************
+  函数名称：SearchTree::fixRedBlackInsert
+  功    能：插入红节点后恢复红黑性质
+  输入参数：node - 新插入的节点，path - 新节点的祖先（父节点在最后），统计信息已刷新
+  返 回 值：
+  说    明：没有父指针，父节点和祖父节点从路径中取得；
+            叔节点为红时只改颜色并上移两层，否则至多两次旋转后结束，
+            旋转改变了子树高度，最后刷新旋转点以上的祖先；
+            路径上的节点已为本树独占，叔节点改色前与其他版本共用时先复制
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::fixRedBlackInsert(NodeIndex node, NodePath& path) {
+    int i = path.size() - 1;    // 父节点在路径中的位置
+
+    // 父节点为红时它不是根，祖父节点一定存在
+    while (i > 0 && nodePool[path[i]].red) {
+        NodeIndex parent       = path[i];
+        NodeIndex grand        = path[i - 1];
+        bool      parentIsLeft = nodePool[grand].left == parent;
+        NodeIndex uncle        = parentIsLeft ? nodePool[grand].right : nodePool[grand].left;
+
+        if (nodePool[uncle].red) {
+            uncle = ownChild(grand, !parentIsLeft);
+            nodePool[parent].red = 0;
+            nodePool[uncle].red  = 0;
+            nodePool[grand].red  = 1;
+            node = grand;
+            i -= 2;
+            continue;
+        }
+
+        // 内侧孙节点先旋转到外侧
+        if (parentIsLeft && nodePool[parent].right == node) {
+            nodePool[grand].left = rotateLeft(parent);
+            parent = node;
+        }
+        else if (!parentIsLeft && nodePool[parent].left == node) {
+            nodePool[grand].right = rotateRight(parent);
+            parent = node;
+        }
+
+        nodePool[parent].red = 0;
+        nodePool[grand].red  = 1;
+        NodeIndex top = parentIsLeft ? rotateRight(grand) : rotateLeft(grand);
+        replaceChild(i > 1 ? path[i - 2] : NullNode, grand, top);
+
+        for (int j = i - 2; j >= 0; j--) {
+            updateNodeInfo(path[j]);
+        }
+        break;
+    }
+
+    nodePool[root].red = 0;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::fixRedBlackDelete
+  功    能：摘除黑节点后恢复红黑性质
+  输入参数：node - 顶替被摘除节点的孩子（可能为空），isLeft - 它是否为父节点的左孩子，
+            path - 它的祖先（父节点在最后），统计信息已刷新
+  返 回 值：
+  说    明：node 所在路径少了一个黑节点；兄弟为红时先旋转父节点使兄弟变黑，
+            兄弟的两个孩子都为黑时把兄弟染红并上移一层，否则至多两次旋转后结束；
+            旋转会把新的子树根插入路径，使路径始终是 node 的祖先，最后刷新旋转点以上的祖先；
+            路径上的节点已为本树独占，不在路径上的 node、兄弟节点和侄节点改色前与其他版本共用时先复制
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::fixRedBlackDelete(NodeIndex node, bool isLeft, NodePath& path) {
+    int i = path.size() - 1;    // 父节点在路径中的位置
+
+    // 顶替的孩子为红时直接染黑，它不在复制过的路径上
+    if (nodePool[node].red) {
+        node = i >= 0 ? ownChild(path[i], isLeft) : (root = ownNode(root));
+    }
+
+    while (i >= 0 && !nodePool[node].red) {
+        NodeIndex parent  = path[i];
+        NodeIndex sibling = ownChild(parent, !isLeft);
+
+        if (nodePool[sibling].red) {
+            nodePool[sibling].red = 0;
+            nodePool[parent].red  = 1;
+            NodeIndex top = isLeft ? rotateLeft(parent) : rotateRight(parent);
+            replaceChild(i > 0 ? path[i - 1] : NullNode, parent, top);
+            path.insert(i, top);
+            i++;
+            sibling = ownChild(parent, !isLeft);
+        }
+
+        NodeIndex nearChild = isLeft ? nodePool[sibling].left : nodePool[sibling].right;
+        NodeIndex farChild  = isLeft ? nodePool[sibling].right : nodePool[sibling].left;
+
+        if (!nodePool[nearChild].red && !nodePool[farChild].red) {
+            nodePool[sibling].red = 1;
+            node = parent;
+            i--;
+            isLeft = i >= 0 && nodePool[path[i]].left == node;
+            continue;
+        }
+
+        nearChild = ownChild(sibling, isLeft);
+        farChild  = ownChild(sibling, !isLeft);
+
+        // 远侧侄节点为黑时，先把近侧的红侄节点转到远侧
+        if (!nodePool[farChild].red) {
+            nodePool[nearChild].red = 0;
+            nodePool[sibling].red   = 1;
+            if (isLeft) {
+                nodePool[parent].right = rotateRight(sibling);
+            }
+            else {
+                nodePool[parent].left = rotateLeft(sibling);
+            }
+            farChild = sibling;
+            sibling  = nearChild;
+        }
+
+        nodePool[sibling].red  = nodePool[parent].red;
+        nodePool[parent].red   = 0;
+        nodePool[farChild].red = 0;
+        NodeIndex top = isLeft ? rotateLeft(parent) : rotateRight(parent);
+        replaceChild(i > 0 ? path[i - 1] : NullNode, parent, top);
+        node = root;
+        break;
+    }
+
+    for (int j = i - 1; j >= 0; j--) {
+        updateNodeInfo(path[j]);
+    }
+
+    if (node != NullNode) {
+        nodePool[node].red = 0;
+    }
+}
+
+/***************************************************************************
+  函数名称：SearchTree::colorBalancedTree
+  功    能：为完全平衡的树着色，使其满足红黑性质
+  输入参数：
+  返 回 值：
+  说    明：按有序数组取中构建的树，叶子只出现在最后两层；
+            最深一层的节点染红、其余染黑，各路径的黑节点数即相同
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::colorBalancedTree() {
+    const int height = getHeight();
+    QVarLengthArray<QPair<NodeIndex, int>, 64> stack;
+
+    if (root != NullNode) {
+        stack.append(qMakePair(root, 1));
+    }
+
+    while (!stack.isEmpty()) {
+        NodeIndex node  = stack.last().first;
+        int       depth = stack.last().second;
+        stack.removeLast();
+
+        Node& current = nodePool[node];
+        current.red = depth == height && depth > 1;
+
+        if (current.left != NullNode) {
+            stack.append(qMakePair(current.left, depth + 1));
+        }
+        if (current.right != NullNode) {
+            stack.append(qMakePair(current.right, depth + 1));
+        }
+    }
+}
+
+/***************************************************************************
+  函数名称：SearchTree::splayNode
+  功    能：自顶向下伸展，把键为 key 的节点（不存在时为最后访问的节点）提到子树根
+  输入参数：node - 子树根节点下标（非空），key - 要伸展的键，depth - 用于返回该节点伸展前的深度
+  返 回 值：NodeIndex - 伸展后的子树根
+  说    明：沿查找路径一次下降一到两层，小于目标的部分挂到左树的最右端，大于目标的挂到右树的最左端，
+            最后把左右树接到目标节点两侧，不需要父节点栈；
+            zig 下降一层，zig-zig 先旋转再下降两层，zig-zag 直接下降两层；
+            挂到左右树上的节点孩子发生了变化，最后沿两条脊自下而上刷新统计信息；
+            记录调整步骤时把每一步记为一个步骤
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+NodeIndex SearchTree<Key, Value, Compare>::splayNode(NodeIndex node, KeyArg key, int& depth) {
+    NodeIndex leftRoot  = NullNode;     // 左树：小于目标的节点
+    NodeIndex rightRoot = NullNode;     // 右树：大于目标的节点
+    NodePath  leftSpine;                // 左树的右脊，自上而下
+    NodePath  rightSpine;               // 右树的左脊，自上而下
+    BalanceStats& stats = balanceStats[static_cast<int>(balancePolicy)];
+
+    auto linkLeft = [&](NodeIndex n) {
+        if (leftSpine.isEmpty()) {
+            leftRoot = n;
+        }
+        else {
+            nodePool[leftSpine.last()].right = n;
+        }
+        leftSpine.append(n);
+    };
+    auto linkRight = [&](NodeIndex n) {
+        if (rightSpine.isEmpty()) {
+            rightRoot = n;
+        }
+        else {
+            nodePool[rightSpine.last()].left = n;
+        }
+        rightSpine.append(n);
+    };
+    auto recordStep = [&](const char* text, NodeIndex target) {
+        if (recordSteps) {
+            addStep(QString::fromUtf8(text).arg(KeyTraits<Key>::toString(nodePool[node].key),
+                KeyTraits<Key>::toString(nodePool[target].key)), target);
+        }
+    };
+
+    depth = 1;
+    int order;
+    while ((order = keyOrder.compare(key, nodePool[node].key)) != 0) {
+        bool      goLeft = order < 0;
+        NodeIndex child  = goLeft ? nodePool[node].left : nodePool[node].right;
+        if (child == NullNode) {
+            break;
+        }
+
+        const Node& next       = nodePool[child];
+        int         nextOrder  = keyOrder.compare(key, next.key);
+        NodeIndex   grandchild = nextOrder < 0 ? next.left : next.right;
+        bool        sameSide   = (nextOrder < 0) == goLeft;
+
+        if (nextOrder == 0 || grandchild == NullNode) {
+            // zig：目标是孩子，下降一层
+            recordStep("zig：%1 下移，%2 上升一层", child);
+            if (goLeft) {
+                linkRight(node);
+            }
+            else {
+                linkLeft(node);
+            }
+            node = child;
+            depth += 1;
+            stats.rotations += 1;
+        }
+        else if (sameSide) {
+            // zig-zig：孙节点与孩子同侧，先旋转当前节点，再把孩子挂出去
+            recordStep("zig-zig：%1 与孩子同侧，%2 上升两层", grandchild);
+            node = goLeft ? rotateRight(node) : rotateLeft(node);
+            if (goLeft) {
+                linkRight(node);
+            }
+            else {
+                linkLeft(node);
+            }
+            node = grandchild;
+            depth += 2;
+            stats.rotations += 1;
+        }
+        else {
+            // zig-zag：孙节点与孩子异侧，当前节点与孩子分别挂到两侧
+            recordStep("zig-zag：%1 与孩子异侧，%2 上升两层", grandchild);
+            if (goLeft) {
+                linkRight(node);
+                linkLeft(child);
+            }
+            else {
+                linkLeft(node);
+                linkRight(child);
+            }
+            node = grandchild;
+            depth += 2;
+            stats.rotations += 2;
+        }
+    }
+
+    // 把目标节点的两棵子树接到左右树，左右树成为目标节点的子树
+    Node& top = nodePool[node];
+    if (!leftSpine.isEmpty()) {
+        nodePool[leftSpine.last()].right = top.left;
+        top.left = leftRoot;
+    }
+    if (!rightSpine.isEmpty()) {
+        nodePool[rightSpine.last()].left = top.right;
+        top.right = rightRoot;
+    }
+    updatePath(leftSpine);
+    updatePath(rightSpine);
+    updateNodeInfo(node);
+
+    if (recordSteps && depth > 1) {
+        addStep(QString::fromUtf8("伸展结束，%1 成为根").arg(KeyTraits<Key>::toString(nodePool[node].key)), node);
+    }
+    return node;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::rebuildScapegoat
+  功    能：插入过深时找到替罪羊祖先并重建其子树
+  输入参数：created - 新插入的节点，path - 新节点的祖先（父节点在最后），统计信息已刷新
+  返 回 值：
+  说    明：新节点深度超过 log(1/α) n 时，沿路径向上找第一个孩子子树节点数超过自身 α 倍的祖先，
+            祖先的节点数由孩子的节点数加上兄弟子树的节点数得出，集合中直接取自统计信息，
+            多重集合只数兄弟子树，总开销不超过重建的子树；只重建该子树，再刷新其上方祖先的高度
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::rebuildScapegoat(NodeIndex created, const NodePath& path) {
+    int depth = path.size() + 1;
+    if (depth <= std::log(static_cast<double>(nodeCount)) / std::log(1.0 / ScapegoatAlpha)) {
+        return;
+    }
+
+    NodeIndex child     = created;
+    int       childSize = 1;
+    for (int i = path.size() - 1; i >= 0; i--) {
+        NodeIndex   node    = path[i];
+        const Node& current = nodePool[node];
+        int size = childSize + 1 + countNodes(current.left == child ? current.right : current.left);
+        if (childSize > ScapegoatAlpha * size) {
+            if (recordSteps) {
+                addStep(QString::fromUtf8("节点 %1 的子树失衡，原地重建 %2 个节点")
+                    .arg(KeyTraits<Key>::toString(current.key)).arg(size), node);
+            }
+
+            ownSubtree(node);
+            NodeIndex top = rebuildSubtree(node);
+            replaceChild(i > 0 ? path[i - 1] : NullNode, node, top);
+            for (int j = i - 1; j >= 0; j--) {
+                updateNodeInfo(path[j]);
+            }
+            return;
+        }
+        child     = node;
+        childSize = size;
+    }
+}
+
+/***************************************************************************
+  函数名称：SearchTree::rebuildSubtree
+  功    能：把子树原地重建为完全平衡的形状
+  输入参数：node - 子树根节点下标
+  返 回 值：NodeIndex - 重建后的子树根
+  说    明：按中序取下各节点后重新链接，节点既不回收也不重新分配
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+NodeIndex SearchTree<Key, Value, Compare>::rebuildSubtree(NodeIndex node) {
+    flattenSubtree(node);
+
+    BalanceStats& stats = balanceStats[static_cast<int>(balancePolicy)];
+    stats.rebuilds++;
+    stats.rebuiltNodes += rebuildBuffer.size();
+
+    return linkBalanced(0, rebuildBuffer.size() - 1);
+}
+
+/***************************************************************************
+  函数名称：SearchTree::flattenSubtree
+  功    能：把子树的节点按中序取到暂存缓冲区
+  输入参数：node - 子树根节点下标
+  返 回 值：
+  说    明：与 clearTree 一样不断右旋把子树压成链，不需要栈；
+            原有链接随后由调用者重建，暂存缓冲区在多次重建间重复使用
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::flattenSubtree(NodeIndex node) {
+    rebuildBuffer.clear();
+
+    while (node != NullNode) {
+        Node& current = nodePool[node];
+
+        if (current.left != NullNode) {
+            NodeIndex left = current.left;
+            current.left = nodePool[left].right;
+            nodePool[left].right = node;
+            node = left;
+        }
+        else {
+            rebuildBuffer.append(node);
+            node = current.right;
+        }
+    }
+}
+
+/***************************************************************************
+  函数名称：SearchTree::linkBalanced
+  功    能：把暂存缓冲区中按中序排列的节点链接成平衡树
+  输入参数：start - 起始索引，end - 结束索引
+  返 回 值：NodeIndex - 子树根节点下标
+  说    明：取中间节点为根，递归深度为 O(log n)
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+NodeIndex SearchTree<Key, Value, Compare>::linkBalanced(int start, int end) {
+    if (start > end) {
+        return NullNode;
+    }
+
+    int mid = (start + end) / 2;
+    NodeIndex node = rebuildBuffer[mid];
+
+    NodeIndex left  = linkBalanced(start, mid - 1);
+    NodeIndex right = linkBalanced(mid + 1, end);
+    nodePool[node].left  = left;
+    nodePool[node].right = right;
+    updateNodeInfo(node);
+
+    return node;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::linkTreap
+  功    能：把暂存缓冲区中按中序排列的节点链接成树堆
+  输入参数：
+  返 回 值：NodeIndex - 树堆的根
+  说    明：维护当前的右脊，新节点从右脊上弹出所有优先级更低的节点作为自己的左子树，
+            再挂到右脊末端；被弹出的节点子树已经完整，此时刷新统计信息，整体 O(n)
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+NodeIndex SearchTree<Key, Value, Compare>::linkTreap() {
+    NodePath spine;
+
+    for (NodeIndex node : rebuildBuffer) {
+        quint64   priority = treapPriority(nodePool[node].key);
+        NodeIndex last     = NullNode;
+
+        while (!spine.isEmpty() && treapPriority(nodePool[spine.last()].key) < priority) {
+            last = spine.last();
+            spine.removeLast();
+            updateNodeInfo(last);
+        }
+
+        nodePool[node].left  = last;
+        nodePool[node].right = NullNode;
+        if (!spine.isEmpty()) {
+            nodePool[spine.last()].right = node;
+        }
+        spine.append(node);
+    }
+
+    updatePath(spine);
+    return spine.isEmpty() ? NullNode : spine.first();
+}
+
+/***************************************************************************
+  函数名称：SearchTree::splitNode
+  功    能：按 key 把树堆拆成两棵
+  输入参数：node - 子树根节点下标，key - 拆分键，left - 返回小于 key 的部分，right - 返回其余部分，
+            equal - 非空时把等于 key 的节点单独取出（不存在时为空）
+  返 回 值：
+  说    明：沿查找路径下降，小于 key 的节点挂到左树的最右端，其余挂到右树的最左端，
+            堆序自然保持；最后沿两条脊自下而上刷新统计信息，期望 O(log n)；
+            经过的节点与其他版本共用时先复制，路径之外的子树继续共用
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::splitNode(NodeIndex node, KeyArg key, NodeIndex& left, NodeIndex& right, NodeIndex* equal) {
+    NodePath  leftSpine;            // 左树的右脊，自上而下
+    NodePath  rightSpine;           // 右树的左脊，自上而下
+    NodeIndex leftRest  = NullNode; // 最后挂到左树最右端的子树
+    NodeIndex rightRest = NullNode; // 最后挂到右树最左端的子树
+
+    left  = NullNode;
+    right = NullNode;
+    if (equal) {
+        *equal = NullNode;
+    }
+
+    while (node != NullNode) {
+        node = ownNode(node);
+        Node& current = nodePool[node];
+
+        if (keyOrder.less(current.key, key)) {
+            if (leftSpine.isEmpty()) {
+                left = node;
+            }
+            else {
+                nodePool[leftSpine.last()].right = node;
+            }
+            leftSpine.append(node);
+            node = current.right;
+        }
+        else if (equal && !keyOrder.less(key, current.key)) {
+            *equal    = node;
+            leftRest  = current.left;
+            rightRest = current.right;
+            current.left  = NullNode;
+            current.right = NullNode;
+            updateNodeInfo(node);
+            break;
+        }
+        else {
+            if (rightSpine.isEmpty()) {
+                right = node;
+            }
+            else {
+                nodePool[rightSpine.last()].left = node;
+            }
+            rightSpine.append(node);
+            node = current.left;
+        }
+    }
+
+    if (leftSpine.isEmpty()) {
+        left = leftRest;
+    }
+    else {
+        nodePool[leftSpine.last()].right = leftRest;
+    }
+    if (rightSpine.isEmpty()) {
+        right = rightRest;
+    }
+    else {
+        nodePool[rightSpine.last()].left = rightRest;
+    }
+
+    updatePath(leftSpine);
+    updatePath(rightSpine);
+}
+
+/***************************************************************************
+  函数名称：SearchTree::joinNodes
+  功    能：合并两棵树堆
+  输入参数：left - 左树，right - 右树（left 的键全部小于 right）
+  返 回 值：NodeIndex - 合并后的根
+  说    明：沿 left 的右脊和 right 的左脊向下，每次取优先级较高的节点挂到结果上，
+            最后自下而上刷新经过的节点，期望 O(log n)；
+            经过的节点与其他版本共用时先复制，路径之外的子树继续共用
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+NodeIndex SearchTree<Key, Value, Compare>::joinNodes(NodeIndex left, NodeIndex right) {
+    NodePath  path;
+    NodeIndex result    = NullNode;
+    NodeIndex owner     = NullNode;     // 下一个节点挂在哪个节点下
+    bool      ownerLeft = false;        // 挂在 owner 的左侧还是右侧
+
+    auto attach = [&](NodeIndex node) {
+        if (owner == NullNode) {
+            result = node;
+        }
+        else if (ownerLeft) {
+            nodePool[owner].left = node;
+        }
+        else {
+            nodePool[owner].right = node;
+        }
+    };
+
+    while (left != NullNode && right != NullNode) {
+        if (treapPriority(nodePool[left].key) > treapPriority(nodePool[right].key)) {
+            left = ownNode(left);
+            attach(left);
+            path.append(left);
+            owner     = left;
+            ownerLeft = false;
+            left      = nodePool[left].right;
+        }
+        else {
+            right = ownNode(right);
+            attach(right);
+            path.append(right);
+            owner     = right;
+            ownerLeft = true;
+            right     = nodePool[right].left;
+        }
+    }
+
+    attach(left != NullNode ? left : right);
+    updatePath(path);
+    return result;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::unionNodes
+  功    能：求两棵树堆的并
+  输入参数：first, second - 两棵树堆的根（键域可以交错）
+  返 回 值：NodeIndex - 并集的根
+  说    明：优先级较高的根保留，另一棵按它的键拆分后分别与它的左右子树求并；
+            另一棵中与它相等的节点被回收，多重集合模式下其重复次数并入保留的节点，节点数随之减少；
+            保留的节点与其他版本共用时先复制；递归深度为期望树高 O(log n)
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+NodeIndex SearchTree<Key, Value, Compare>::unionNodes(NodeIndex first, NodeIndex second) {
+    if (first == NullNode) {
+        return second;
+    }
+    if (second == NullNode) {
+        return first;
+    }
+
+    if (treapPriority(nodePool[first].key) < treapPriority(nodePool[second].key)) {
+        std::swap(first, second);
+    }
+    first = ownNode(first);
+
+    NodeIndex left, right, equal;
+    Key       key = nodePool[first].key;
+    splitNode(second, key, left, right, &equal);
+    if (equal != NullNode) {
+        if (multiset) {
+            nodePool[first].count += nodePool[equal].count;
+        }
+        nodePool.release(equal);
+        nodeCount--;
+    }
+
+    NodeIndex newLeft  = unionNodes(nodePool[first].left, left);
+    NodeIndex newRight = unionNodes(nodePool[first].right, right);
+    nodePool[first].left  = newLeft;
+    nodePool[first].right = newRight;
+    updateNodeInfo(first);
+
+    return first;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::ensureTreap
+  功    能：不是树堆策略时切换为树堆
+  输入参数：
+  返 回 值：
+  说    明：拆分与合并依赖堆序，其他策略下的树先原地重建为树堆
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::ensureTreap() {
+    if (balancePolicy != BalancePolicy::Treap) {
+        setBalancePolicy(BalancePolicy::Treap);
+    }
+}
+
+/***************************************************************************
+  函数名称：SearchTree::saveVersion
+  功    能：把当前内容保存为一个版本
+  输入参数：version - 接收版本的树（原有内容被清空）
+  返 回 值：
+  说    明：version 与本树共用节点存储，根节点的引用数加1，不复制任何节点，O(1)；
+            之后两棵树各自修改互不影响：各策略下的插入、删除只复制查找路径和调整涉及的被共用节点，
+            平衡树上每次 O(log n)；替罪羊树只复制被重建的子树，拆分合并只复制经过的节点；
+            整体平衡、切换策略等大范围调整先复制全部被共用的节点，之后不再与其他版本共用
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::saveVersion(SearchTree& version) {
+    if (&version == this) {
+        return;
+    }
+
+    version.clear();
+    version.nodePool.shareWith(nodePool);
+    nodePool.addRef(root);
+
+    version.root          = root;
+    version.nodeCount     = nodeCount;
+    version.keyOrder      = keyOrder;
+    version.multiset      = multiset;
+    version.balancePolicy = balancePolicy;
+    version.maxNodeCount  = maxNodeCount;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::ownNode
+  功    能：取得节点的独占副本
+  输入参数：node - 节点下标
+  返 回 值：NodeIndex - 只被本树引用的节点：节点本来独占时即为自身，否则为新复制的节点
+  说    明：副本沿用原节点的孩子，两个孩子各多一处引用，原节点少一处引用；
+            调用者负责把父节点的链接改到副本
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+NodeIndex SearchTree<Key, Value, Compare>::ownNode(NodeIndex node) {
+    if (!nodePool.isNodeShared(node)) {
+        return node;
+    }
+
+    // 分配可能使内存池扩容，先把节点内容取出
+    Node      copied  = nodePool[node];
+    NodeIndex created = nodePool.allocate(copied.key);
+    nodePool[created] = copied;
+
+    nodePool.addRef(copied.left);
+    nodePool.addRef(copied.right);
+    nodePool.dropRef(node);
+    return created;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::ownChild
+  功    能：取得孩子的独占副本并接回父节点
+  输入参数：parent - 父节点下标（须为本树独占），isLeft - 是否为左孩子
+  返 回 值：NodeIndex - 孩子的独占副本
+  说    明：没有被共用的节点时只是读取孩子
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+NodeIndex SearchTree<Key, Value, Compare>::ownChild(NodeIndex parent, bool isLeft) {
+    NodeIndex child = isLeft ? nodePool[parent].left : nodePool[parent].right;
+    if (!nodePool.isNodeShared(child)) {
+        return child;
+    }
+
+    NodeIndex owned = ownNode(child);
+    if (isLeft) {
+        nodePool[parent].left = owned;
+    }
+    else {
+        nodePool[parent].right = owned;
+    }
+    return owned;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::ownPath
+  功    能：复制查找路径上被共用的节点
+  输入参数：key - 要查找的键，successor - 键所在节点有两个孩子时是否一并复制通往后继的路径
+  返 回 值：
+  说    明：从根向下逐个取得独占副本，路径之外的子树继续与其他版本共用；
+            删除时后继节点的内容要移到被删除的节点上，通往后继的路径同样会被修改
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::ownPath(KeyArg key, bool successor) {
+    root = ownNode(root);
+    NodeIndex node = root;
+
+    while (node != NullNode) {
+        int order = keyOrder.compare(key, nodePool[node].key);
+        if (order == 0) {
+            break;
+        }
+        node = ownChild(node, order < 0);
+    }
+
+    if (successor && node != NullNode && nodePool[node].left != NullNode && nodePool[node].right != NullNode) {
+        node = ownChild(node, false);
+        while (nodePool[node].left != NullNode) {
+            node = ownChild(node, true);
+        }
+    }
+}
+
+/***************************************************************************
+  函数名称：SearchTree::prepareUpdate
+  功    能：插入、删除前复制被共用的节点
+  输入参数：key - 要插入或删除的键，successor - 是否为删除
+  返 回 值：
+  说    明：各策略都从查找路径出发调整：旋转时上移的孩子由 rotateLeft、rotateRight 自行复制，
+            红黑树修复时改色的叔节点、兄弟节点和侄节点由修复函数自行复制；
+            伸展只改动查找路径，删除后在左子树右脊上的第二次伸展由 splayDelete 复制；
+            树堆插入时拆分的就是查找路径，删除时合并的两条脊由 joinNodes 复制；
+            替罪羊树重建前由 rebuildScapegoat 复制该子树，删除过多时整棵复制后重建；
+            伸展树和树堆删除时不用后继顶替，不复制通往后继的路径
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::prepareUpdate(KeyArg key, bool successor) {
+    bool bySuccessor = balancePolicy != BalancePolicy::Splay && balancePolicy != BalancePolicy::Treap;
+    ownPath(key, successor && bySuccessor);
+}
+
+/***************************************************************************
+  函数名称：SearchTree::detach
+  功    能：复制本树中所有被共用的节点
+  输入参数：
+  返 回 值：
+  说    明：先取得根的独占副本，再复制整棵树，之后本树可以任意原地调整；
+            存储中没有被共用的节点时直接返回
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::detach() {
+    if (!nodePool.hasSharedNodes() || root == NullNode) {
+        return;
+    }
+
+    root = ownNode(root);
+    ownSubtree(root);
+}
+
+/***************************************************************************
+  函数名称：SearchTree::ownSubtree
+  功    能：复制子树中所有被共用的节点
+  输入参数：node - 子树根节点下标（须为本树独占）
+  返 回 值：
+  说    明：用显式栈自上而下取得每个节点的独占副本，之后子树可以任意原地调整，子树之外的节点不受影响；
+            存储中没有被共用的节点时直接返回
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::ownSubtree(NodeIndex node) {
+    if (!nodePool.hasSharedNodes() || node == NullNode) {
+        return;
+    }
+
+    QVarLengthArray<NodeIndex, 64> stack;
+    stack.append(node);
+
+    while (!stack.isEmpty()) {
+        NodeIndex current = stack.last();
+        stack.removeLast();
+
+        NodeIndex left  = ownChild(current, true);
+        NodeIndex right = ownChild(current, false);
+        if (left != NullNode) {
+            stack.append(left);
+        }
+        if (right != NullNode) {
+            stack.append(right);
+        }
+    }
+}
+
+/***************************************************************************
+  函数名称：SearchTree::split
+  功    能：按 key 拆分树
+  输入参数：key - 拆分键，right - 接收不小于 key 的节点的树（原有内容被清空）
+  返 回 值：
+  说    明：本树保留小于 key 的节点；right 与本树共用节点存储，节点不搬动，期望 O(log n)；
+            两棵树都切换为树堆策略；多重集合需要数出 right 的节点数，另加 O(m)
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::split(KeyArg key, SearchTree& right) {
+    if (&right == this) {
+        return;
+    }
+
+    ensureTreap();
+    right.clear();
+    right.nodePool.shareWith(nodePool);
+    right.balancePolicy = BalancePolicy::Treap;
+    right.multiset      = multiset;
+
+    splitNode(root, key, root, right.root);
+    right.nodeCount    = countNodes(right.root);
+    nodeCount         -= right.nodeCount;
+    maxNodeCount       = nodeCount;
+    right.maxNodeCount = right.nodeCount;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::join
+  功    能：把 right 整体接到本树右侧
+  输入参数：right - 要接入的树，其中的键须全部大于本树中的键，完成后被清空
+  返 回 值：bool - 键域重叠时返回false，两棵树都不变
+  说    明：两棵树共用节点存储（如由 split 得到）时只需合并，期望 O(log n)；
+            否则先把 right 的节点连同映射值复制进本树的存储，O(m)，本树为集合时重复次数记为1
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+bool SearchTree<Key, Value, Compare>::join(SearchTree& right) {
+    if (&right == this || right.isEmpty()) {
+        return true;
+    }
+
+    Key maxKey, minKey;
+    if (select(getTotalCount(), maxKey) && right.select(1, minKey) && !keyOrder.less(maxKey, minKey)) {
+        return false;
+    }
+
+    ensureTreap();
+
+    NodeIndex other;
+    int       joined = right.nodeCount;
+    if (nodePool.sharesWith(right.nodePool)) {
+        right.ensureTreap();
+        other = right.root;
+        right.root = NullNode;
+    }
+    else {
+        rebuildBuffer.clear();
+        visitSubtree(right.nodePool, right.root, [this](const Node& current, int) {
+            NodeIndex copied = nodePool.allocate(current.key);
+            static_cast<NodePayload<Value>&>(nodePool[copied]) = current;
+            nodePool[copied].count = multiset ? current.count : 1;
+            rebuildBuffer.append(copied);
+        });
+        other = linkTreap();
+    }
+    right.clear();
+
+    root          = joinNodes(root, other);
+    nodeCount    += joined;
+    maxNodeCount  = nodeCount;
+    return true;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::insertBatch
+  功    能：批量插入
+  输入参数：keys - 要插入的键（可以无序、重复）
+  返 回 值：int - 新增的元素数
+  说    明：排序去重后用 O(m) 的方式建成一棵树堆，再与本树求并；
+            集合模式下已存在的键被丢弃，多重集合模式下重复次数累加
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+int SearchTree<Key, Value, Compare>::insertBatch(const QVector<Key>& keys) {
+    if (keys.isEmpty()) {
+        return 0;
+    }
+
+    ensureTreap();
+
+    allocateSorted(keys);
+
+    int oldTotal  = getTotalCount();
+    nodeCount    += rebuildBuffer.size();
+    root          = unionNodes(root, linkTreap());
+    maxNodeCount  = nodeCount;
+    balanceStats[static_cast<int>(balancePolicy)].operations++;
+
+    return getTotalCount() - oldTotal;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::eraseRange
+  功    能：批量删除 [low, high] 内的元素
+  输入参数：low, high - 删除范围（包含两端）
+  返 回 值：int - 删除的元素数（多重集合计入重复次数）
+  说    明：先按 low 拆出不小于 low 的部分，再按 high 拆分并单独取出等于 high 的节点，
+            中间一段连同它整体回收，再把两侧合并，期望 O(log n + m)
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+int SearchTree<Key, Value, Compare>::eraseRange(KeyArg low, KeyArg high) {
+    if (keyOrder.less(high, low) || root == NullNode) {
+        return 0;
+    }
+
+    ensureTreap();
+
+    NodeIndex left, middle, right, last;
+    splitNode(root, low, left, middle);
+    splitNode(middle, high, middle, right, &last);
+
+    int erased = nodePool[middle].weight + nodePool[last].weight;
+    nodeCount -= countNodes(middle) + countNodes(last);
+    clearTree(middle);
+    nodePool.release(last);
+
+    root = joinNodes(left, right);
+    balanceStats[static_cast<int>(balancePolicy)].operations++;
+
+    return erased;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::setBalancePolicy
+  功    能：切换自平衡策略
+  输入参数：policy - 新的自平衡策略
+  返 回 值：
+  说    明：已有的树不一定满足 AVL 或红黑树的性质，切换到这两种策略时先整体重建为完全平衡的树；
+            切换到替罪羊树或树堆时原地重建整棵树；任何二叉搜索树都可以直接作为伸展树
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::setBalancePolicy(BalancePolicy policy) {
+    if (policy == balancePolicy) {
+        return;
+    }
+
+    detach();
+    balancePolicy = policy;
+    if (policy == BalancePolicy::AVL || policy == BalancePolicy::RedBlack) {
+        balance();
+    }
+    else if (policy == BalancePolicy::Scapegoat) {
+        root = rebuildSubtree(root);
+        maxNodeCount = nodeCount;
+    }
+    else if (policy == BalancePolicy::Treap) {
+        flattenSubtree(root);
+        root = linkTreap();
+    }
+}
+
+/***************************************************************************
+  函数名称：SearchTree::setMultiset
+  功    能：切换多重集合模式
+  输入参数：enabled - 是否为多重集合
+  返 回 值：
+  说    明：树的形状不变；切换为集合时各键只保留一份，重复次数重置为1，
+            再按先序的逆序自下而上刷新重复次数之和，使其等于子树节点数；用显式栈遍历本树的节点，O(n)
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::setMultiset(bool enabled) {
+    if (!enabled && multiset) {
+        detach();
+
+        QVarLengthArray<NodeIndex, 64> stack;
+        rebuildBuffer.clear();
+        if (root != NullNode) {
+            stack.append(root);
+        }
+        while (!stack.isEmpty()) {
+            NodeIndex node = stack.last();
+            stack.removeLast();
+
+            Node& current = nodePool[node];
+            current.count = 1;
+            rebuildBuffer.append(node);
+            if (current.left != NullNode) {
+                stack.append(current.left);
+            }
+            if (current.right != NullNode) {
+                stack.append(current.right);
+            }
+        }
+
+        // 先序中父节点在孩子之前，逆序刷新时孩子总是先于父节点
+        for (int i = rebuildBuffer.size() - 1; i >= 0; i--) {
+            updateNodeInfo(rebuildBuffer[i]);
+        }
+        rebuildBuffer.clear();
+    }
+
+    multiset = enabled;
+}
+
+/***************************************************************************
+  函数名称：SearchTree::getBalanceStats
+  功    能：获取某一策略的旋转统计
+  输入参数：policy - 自平衡策略
+  返 回 值：BalanceStats - 该策略下累计的操作数和旋转数
+  说    明：
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+BalanceStats SearchTree<Key, Value, Compare>::getBalanceStats(BalancePolicy policy) const {
+    return balanceStats[static_cast<int>(policy)];
+}
+
+/***************************************************************************
+  函数名称：SearchTree::resetBalanceStats
+  功    能：清零各策略的旋转统计
+  输入参数：
+  返 回 值：
+  说    明：
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::resetBalanceStats() {
+    for (BalanceStats& stats : balanceStats) {
+        stats = BalanceStats();
+    }
+}
+
+/***************************************************************************
+  函数名称：SearchTree::balance
+  功    能：平衡二叉搜索树
+  输入参数：threads - 使用的线程数
+  返 回 值：
+  说    明：用 DSW 算法原地调整：先右旋拉直成链，再按轮左旋压缩，
+            第一轮把多出完全树的节点压到最底层，之后每轮右链长度减半；
+            节点既不回收也不重新分配，只需 O(1) 额外空间；
+            红黑树策略下调整后重新着色；树堆的形状由优先级决定，不做调整；
+            记录调整步骤时把拉直和每一轮压缩各记为一个步骤；
+            threads 大于1、不记录步骤且节点数不小于 2*ParallelCutoff 时改为 fork-join：
+            按子树节点数并行取出中序（多重集合单线程取出），再并行链接成同样形状的完全二叉树，
+            结果（每个节点的孩子、统计信息和颜色）与 DSW 完全相同，需要 O(n) 额外空间
+***************************************************************************/
+template <typename Key, typename Value, typename Compare>
+void SearchTree<Key, Value, Compare>::balance(int threads) {
+    if (root == NullNode || balancePolicy == BalancePolicy::Treap)
+        return;
+
+    detach();
+
+    if (threads > 1 && !recordSteps && nodeCount >= ParallelCutoff * 2) {
+        rebuildBuffer.resize(nodeCount);
+        flattenParallel(root, rebuildBuffer.data(), multiset ? 1 : threads);
+
+        int height = 1;
+        while ((1 << height) - 1 < nodeCount) {
+            height++;
+        }
+        int redDepth = balancePolicy == BalancePolicy::RedBlack ? height : 0;
+        root = linkComplete(rebuildBuffer.data(), nodeCount, 1, redDepth, threads);
+
+        rebuildBuffer.clear();
+        maxNodeCount = nodeCount;
+        return;
+    }
+
+    int rotations = treeToVine();
+    if (recordSteps) {
+        addStep(QString::fromUtf8("右旋 %1 次，把树拉直成一条右链").arg(rotations), NullNode);
+    }
+
+    // 完全树部分的节点数为 2^k - 1，多出的节点先压到最底层
+    int fullCount = 1;
+    while (fullCount * 2 + 1 <= nodeCount) {
+        fullCount = fullCount * 2 + 1;
+    }
+
+    int round = 0;
+    int count = nodeCount - fullCount;
+    while (fullCount > 0) {
+        if (count > 0) {
+            NodeIndex first = compressVine(count);
+            round++;
+            if (recordSteps) {
+                addStep(QString::fromUtf8("第 %1 轮压缩：沿右链左旋 %2 次").arg(round).arg(count), first);
+            }
+        }
+
+        count     = fullCount / 2;
+        fullCount = count;
+    }
+
+    updateSubtree(root);
+    maxNodeCount = nodeCount;
+    if (balancePolicy == BalancePolicy::RedBlack) {
+        colorBalancedTree();
+    }
+}
+
+#endif // SEARCHTREE_H
\ No newline at end of file
@@ -0,0 +1,340 @@
+﻿/***************************************************************************
+  文件名称：ShardedTree.cpp
+  功    能：按值域分片的并发树的实现文件
+  说    明：加锁顺序固定为先路由表、后分片，需要多个分片时按下标从小到大加锁，不会死锁
+***************************************************************************/
+
+#include "ShardedTree.h"
+#include <algorithm>
+
+// 分片：一棵 AVL 树和保护它的锁，不记录撤销历史
+struct ShardedTree::Shard {
+    BinarySearchTree tree;       // 分片内的树
+    std::mutex       mutex;      // 保护 tree 和 writes
+    quint64          writes = 0; // 上次重新分片以来的修改次数
+};
+
+/***************************************************************************
+  函数名称：ShardedTree::ShardedTree
+  功    能：构造函数
+  输入参数：shardCount - 初始分片数，low, high - 预计的值域，均分给各分片
+  返 回 值：
+  说    明：第一个分片的下界放宽到 int 的最小值，最后一个分片的上界总是 int 的最大值，
+            预计值域以外的值落在两端的分片中；值域比分片数还窄时减少分片数
+***************************************************************************/
+ShardedTree::ShardedTree(int shardCount, int low, int high) {
+    if (low > high) {
+        std::swap(low, high);
+    }
+    qint64 range = static_cast<qint64>(high) - low + 1;
+    if (shardCount > MaxShards) {
+        shardCount = MaxShards;
+    }
+    shardCount = static_cast<int>(std::max<qint64>(1, std::min<qint64>(shardCount, range)));
+
+    qint64 width = range / shardCount;
+    for (int i = 0; i < shardCount; i++) {
+        int shardLow = i == 0 ? std::numeric_limits<int>::min() : static_cast<int>(low + width * i);
+        lowValues.append(shardLow);
+        shards.push_back(createShard());
+    }
+}
+
+/***************************************************************************
+  函数名称：ShardedTree::~ShardedTree
+  功    能：析构函数
+  输入参数：
+  返 回 值：
+  说    明：析构时不能有其他线程仍在访问
+***************************************************************************/
+ShardedTree::~ShardedTree() {
+}
+
+/***************************************************************************
+  函数名称：ShardedTree::createShard
+  功    能：新建空分片
+  输入参数：
+  返 回 值：std::unique_ptr<Shard> - 新分片
+  说    明：分片内用 AVL 树，避免有序写入使单个分片退化；撤销历史对分片没有意义，关闭记录
+***************************************************************************/
+std::unique_ptr<ShardedTree::Shard> ShardedTree::createShard() {
+    std::unique_ptr<Shard> shard(new Shard);
+    shard->tree.setBalancePolicy(BalancePolicy::AVL);
+    shard->tree.setHistoryBudget(0);
+    return shard;
+}
+
+/***************************************************************************
+  函数名称：ShardedTree::route
+  功    能：查找值所在的分片
+  输入参数：value - 要查找的值
+  返 回 值：int - 分片下标
+  说    明：在各分片的下界中二分查找最后一个不大于 value 的，调用者须持路由表的锁
+***************************************************************************/
+int ShardedTree::route(int value) const {
+    return static_cast<int>(std::upper_bound(lowValues.begin(), lowValues.end(), value) - lowValues.begin()) - 1;
+}
+
+/***************************************************************************
+  函数名称：ShardedTree::insert
+  功    能：插入值
+  输入参数：value - 要插入的值
+  返 回 值：bool - 是否插入（值已存在时返回false）
+  说    明：只锁住值所在的分片，其他分片上的操作不受影响
+***************************************************************************/
+bool ShardedTree::insert(int value) {
+    std::shared_lock<std::shared_mutex> router(routerMutex);
+    Shard& shard = *shards[route(value)];
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    int before = shard.tree.getTotalCount();
+    shard.tree.insert(value);
+    shard.writes++;
+    return shard.tree.getTotalCount() != before;
+}
+
+/***************************************************************************
+  函数名称：ShardedTree::remove
+  功    能：删除值
+  输入参数：value - 要删除的值
+  返 回 值：bool - 是否删除（值不存在时返回false）
+  说    明：只锁住值所在的分片
+***************************************************************************/
+bool ShardedTree::remove(int value) {
+    std::shared_lock<std::shared_mutex> router(routerMutex);
+    Shard& shard = *shards[route(value)];
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    int before = shard.tree.getTotalCount();
+    shard.tree.remove(value);
+    shard.writes++;
+    return shard.tree.getTotalCount() != before;
+}
+
+/***************************************************************************
+  函数名称：ShardedTree::contains
+  功    能：值是否在树中
+  输入参数：value - 要查找的值
+  返 回 值：bool - 是否找到
+  说    明：查找不改变树，但仍要锁住分片，避免与同一分片上的修改同时进行
+***************************************************************************/
+bool ShardedTree::contains(int value) const {
+    std::shared_lock<std::shared_mutex> router(routerMutex);
+    Shard& shard = *shards[route(value)];
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.tree.contains(value);
+}
+
+/***************************************************************************
+  函数名称：ShardedTree::size
+  功    能：获取元素总数
+  输入参数：
+  返 回 值：int - 元素总数
+  说    明：按下标顺序锁住全部分片后求和，结果是某一时刻的准确值
+***************************************************************************/
+int ShardedTree::size() const {
+    std::shared_lock<std::shared_mutex> router(routerMutex);
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for (const std::unique_ptr<Shard>& shard : shards) {
+        locks.emplace_back(shard->mutex);
+    }
+
+    int total = 0;
+    for (const std::unique_ptr<Shard>& shard : shards) {
+        total += shard->tree.getTotalCount();
+    }
+    return total;
+}
+
+/***************************************************************************
+  函数名称：ShardedTree::collectValues
+  功    能：跨分片中序取出全部值
+  输入参数：
+  返 回 值：QVector<int> - 从小到大排列的值
+  说    明：分片的值域互不重叠且按下标递增，依次取出各分片的中序结果即为整体有序；
+            按下标顺序锁住全部分片后再取，期间的修改要么全部看到、要么全部看不到
+***************************************************************************/
+QVector<int> ShardedTree::collectValues() const {
+    std::shared_lock<std::shared_mutex> router(routerMutex);
+    std::vector<std::unique_lock<std::mutex>> locks;
+    int total = 0;
+    for (const std::unique_ptr<Shard>& shard : shards) {
+        locks.emplace_back(shard->mutex);
+        total += shard->tree.getTotalCount();
+    }
+
+    QVector<int> values;
+    values.reserve(total);
+    for (const std::unique_ptr<Shard>& shard : shards) {
+        values += shard->tree.collectValues(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+    }
+    return values;
+}
+
+/***************************************************************************
+  函数名称：ShardedTree::display
+  功    能：获取树的字符串表示
+  输入参数：
+  返 回 值：QString - 各分片的中序遍历结果，树为空时为“树为空”
+  说    明：每个值输出为“值(在分片内的深度) ”，空分片不输出，相邻分片之间以“| ”分隔
+***************************************************************************/
+QString ShardedTree::display() const {
+    std::shared_lock<std::shared_mutex> router(routerMutex);
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for (const std::unique_ptr<Shard>& shard : shards) {
+        locks.emplace_back(shard->mutex);
+    }
+
+    QString result;
+    for (const std::unique_ptr<Shard>& shard : shards) {
+        if (shard->tree.isEmpty()) {
+            continue;
+        }
+        if (!result.isEmpty()) {
+            result += "| ";
+        }
+        result += shard->tree.display();
+    }
+    if (result.isEmpty()) {
+        return QString::fromUtf8("树为空");
+    }
+    return result;
+}
+
+/***************************************************************************
+  函数名称：ShardedTree::exportTo
+  功    能：把全部值合并到一棵树中
+  输入参数：tree - 接收合并结果的树，原有内容被替换
+  返 回 值：
+  说    明：取一致的跨分片中序结果后整体替换，BSTView 显示这棵树即为合并后的视图
+***************************************************************************/
+void ShardedTree::exportTo(BinarySearchTree& tree) const {
+    tree.assign(collectValues());
+}
+
+/***************************************************************************
+  函数名称：ShardedTree::getShardCount
+  功    能：获取分片数
+  输入参数：
+  返 回 值：int - 分片数
+  说    明：
+***************************************************************************/
+int ShardedTree::getShardCount() const {
+    std::shared_lock<std::shared_mutex> router(routerMutex);
+    return static_cast<int>(shards.size());
+}
+
+/***************************************************************************
+  函数名称：ShardedTree::getShardInfo
+  功    能：获取各分片的概况
+  输入参数：
+  返 回 值：QVector<ShardInfo> - 按值域从小到大排列的分片概况
+  说    明：逐个锁住分片读取，各分片的数值不一定是同一时刻的
+***************************************************************************/
+QVector<ShardInfo> ShardedTree::getShardInfo() const {
+    std::shared_lock<std::shared_mutex> router(routerMutex);
+
+    QVector<ShardInfo> infos;
+    for (int i = 0; i < static_cast<int>(shards.size()); i++) {
+        ShardInfo info;
+        info.lowValue  = lowValues[i];
+        info.highValue = i + 1 < lowValues.size() ? lowValues[i + 1] - 1 : std::numeric_limits<int>::max();
+
+        std::lock_guard<std::mutex> lock(shards[i]->mutex);
+        info.size   = shards[i]->tree.getTotalCount();
+        info.writes = shards[i]->writes;
+        infos.append(info);
+    }
+    return infos;
+}
+
+/***************************************************************************
+  函数名称：ShardedTree::splitShard
+  功    能：在中位数处把分片一分为二
+  输入参数：index - 分片下标
+  返 回 值：
+  说    明：取出分片的全部值，前一半留在原分片、后一半建成新分片，两者各自持有节点存储，O(n)；
+            修改次数平分给两个分片；调用者须持路由表的独占锁
+***************************************************************************/
+void ShardedTree::splitShard(int index) {
+    Shard& shard = *shards[index];
+    QVector<int> values = shard.tree.collectValues(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+    int half = values.size() / 2;
+
+    std::unique_ptr<Shard> upper = createShard();
+    upper->tree.assign(values.mid(half));
+    upper->writes = shard.writes - shard.writes / 2;
+    shard.tree.assign(values.mid(0, half));
+    shard.writes /= 2;
+
+    lowValues.insert(index + 1, values[half]);
+    shards.insert(shards.begin() + index + 1, std::move(upper));
+}
+
+/***************************************************************************
+  函数名称：ShardedTree::mergeShards
+  功    能：把分片 index+1 并入分片 index
+  输入参数：index - 前一个分片的下标
+  返 回 值：
+  说    明：两个分片的值域相邻，前者的值全部小于后者，直接拼接后整体重建，O(n)；
+            调用者须持路由表的独占锁
+***************************************************************************/
+void ShardedTree::mergeShards(int index) {
+    Shard& lower = *shards[index];
+    Shard& upper = *shards[index + 1];
+
+    QVector<int> values = lower.tree.collectValues(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+    values += upper.tree.collectValues(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+    lower.tree.assign(values);
+    lower.writes += upper.writes;
+
+    lowValues.removeAt(index + 1);
+    shards.erase(shards.begin() + index + 1);
+}
+
+/***************************************************************************
+  函数名称：ShardedTree::rebalance
+  功    能：按各分片的修改次数重新分片
+  输入参数：
+  返 回 值：int - 拆分与合并的次数
+  说    明：修改次数超过平均值两倍且元素不少于 MinSplitSize 的分片在中位数处拆分；
+            之后相邻两个分片的修改次数之和不到平均值时合并，合并后的分片不会成为新的热点；
+            最后清零所有分片的修改次数，下次按这段时间内的分布重新判断；
+            持路由表的独占锁，期间其他操作等待
+***************************************************************************/
+int ShardedTree::rebalance() {
+    std::unique_lock<std::shared_mutex> router(routerMutex);
+
+    quint64 totalWrites = 0;
+    for (const std::unique_ptr<Shard>& shard : shards) {
+        totalWrites += shard->writes;
+    }
+    quint64 average = totalWrites / shards.size();
+
+    int changes = 0;
+    for (int i = static_cast<int>(shards.size()) - 1; i >= 0; i--) {
+        if (static_cast<int>(shards.size()) >= MaxShards) {
+            break;
+        }
+        if (shards[i]->writes > average * 2 && shards[i]->tree.getTotalCount() >= MinSplitSize) {
+            splitShard(i);
+            changes++;
+        }
+    }
+
+    for (int i = 0; i + 1 < static_cast<int>(shards.size()); ) {
+        if (shards[i]->writes + shards[i + 1]->writes < average) {
+            mergeShards(i);
+            changes++;
+        }
+        else {
+            i++;
+        }
+    }
+
+    for (const std::unique_ptr<Shard>& shard : shards) {
+        shard->writes = 0;
+    }
+    return changes;
+}
\ No newline at end of file
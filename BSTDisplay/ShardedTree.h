@@ -0,0 +1,76 @@
+﻿/***************************************************************************
+  文件名称：ShardedTree.h
+  功    能：按值域分片的并发树的声明文件
+  说    明：值域划分为若干连续的区间，每个区间由一棵带独立锁的 BinarySearchTree 负责，
+            不同分片上的修改可以在多个核上同时进行；路由表记录各分片的下界，
+            重新分片时拆分写入多的分片、合并相邻的冷分片
+***************************************************************************/
+
+#ifndef SHARDEDTREE_H
+#define SHARDEDTREE_H
+
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+#include <QString>
+#include <QVector>
+#include "BinarySearchTree.h"
+
+// 一个分片的概况
+struct ShardInfo {
+    int     lowValue  = 0; // 值域下界（包含）
+    int     highValue = 0; // 值域上界（包含）
+    int     size      = 0; // 元素数
+    quint64 writes    = 0; // 上次重新分片以来的修改次数
+};
+
+/***************************************************************************
+  类名称：ShardedTree
+  功    能：多线程同时插入、删除、查找的整数集合，按值域分片加锁
+  说    明：每次操作先持路由表的共享锁找到分片，再持该分片的锁，不同分片互不阻塞；
+            重新分片持路由表的独占锁，期间所有操作等待；
+            跨分片的中序遍历按顺序锁住全部分片，取出的是某一时刻的一致内容；
+            分片各自持有节点存储，不用 split/join（它们会让两棵树共用存储，无法分别加锁）
+***************************************************************************/
+class ShardedTree {
+public:
+    explicit ShardedTree(int shardCount = 1, int low = std::numeric_limits<int>::min(),
+        int high = std::numeric_limits<int>::max()); // 构造函数，把 [low, high] 均分为 shardCount 个分片
+    ~ShardedTree();                                  // 析构函数
+
+    ShardedTree(const ShardedTree&) = delete;
+    ShardedTree& operator=(const ShardedTree&) = delete;
+
+    bool insert(int value);         // 插入，值已存在时返回false
+    bool remove(int value);         // 删除，值不存在时返回false
+    bool contains(int value) const; // 值是否在树中
+
+    int          size() const;                           // 元素总数
+    QVector<int> collectValues() const;                  // 跨分片中序取出全部值
+    QString      display() const;                        // 显示树内容，各分片依次输出，以“| ”分隔
+    void         exportTo(BinarySearchTree& tree) const; // 把全部值合并到一棵树中，交给 BSTView 显示
+
+    int                getShardCount() const; // 分片数
+    QVector<ShardInfo> getShardInfo() const;  // 各分片的概况，按值域从小到大
+    int                rebalance();           // 重新分片，返回拆分与合并的次数
+
+    static const int MaxShards    = 256; // 分片数上限
+    static const int MinSplitSize = 64;  // 元素少于这个数的分片不拆分
+
+private:
+    struct Shard; // 分片
+
+    mutable std::shared_mutex           routerMutex; // 路由表的锁：操作时共享，重新分片时独占
+    QVector<int>                        lowValues;   // 各分片的值域下界，第一个为 int 的最小值
+    std::vector<std::unique_ptr<Shard>> shards;      // 各分片，与 lowValues 一一对应
+
+    int  route(int value) const; // 值所在的分片下标，调用者须持路由表的锁
+    void splitShard(int index);  // 在中位数处把分片一分为二
+    void mergeShards(int index); // 把分片 index+1 并入分片 index
+
+    static std::unique_ptr<Shard> createShard(); // 新建空分片
+};
+
+#endif // SHARDEDTREE_H
\ No newline at end of file
@@ -0,0 +1,153 @@
+﻿/***************************************************************************
+  文件名称：SnapshotIndex.cpp
+  功    能：只读快照索引的实现文件
+  说    明：
+***************************************************************************/
+
+#include "SnapshotIndex.h"
+#include <QVarLengthArray>
+#include <QtAlgorithms>
+
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#define SNAPSHOT_PREFETCH(address) _mm_prefetch(reinterpret_cast<const char*>(address), _MM_HINT_T0)
+#else
+#define SNAPSHOT_PREFETCH(address) __builtin_prefetch(address)
+#endif
+
+const quint64 PrefetchStride = 64 / sizeof(int); // 一个缓存行的值个数，k 的第四层后代从 16k 开始连续存放
+
+/***************************************************************************
+  函数名称：SnapshotIndex::SnapshotIndex
+  功    能：构造函数，创建空快照
+  输入参数：
+  返 回 值：
+  说    明：
+***************************************************************************/
+SnapshotIndex::SnapshotIndex() :
+    count(0)
+{
+}
+
+/***************************************************************************
+  函数名称：SnapshotIndex::build
+  功    能：按中序把树的内容填入快照
+  输入参数：pool - 节点内存池，root - 树的根节点下标，count - 树的节点数
+  返 回 值：
+  说    明：树的中序与隐式完全树的中序一一对应，两边同时做中序遍历即可，不需要暂存有序数组；
+            隐式树从 k 走到中序后继：有右孩子时进入右子树的最左端，
+            否则沿右孩子链上升再多上升一层，即右移 (k 末尾连续1的个数 + 1) 位
+***************************************************************************/
+void SnapshotIndex::build(const NodePool& pool, NodeIndex root, int count) {
+    keys.assign(static_cast<std::size_t>(count) + 1, 0);
+    this->count = count;
+    if (count == 0) {
+        return;
+    }
+
+    const quint64 last = static_cast<quint64>(count);
+    quint64 slot = 1;
+    while (slot * 2 <= last) {
+        slot *= 2;
+    }
+
+    QVarLengthArray<NodeIndex, 64> stack;
+    NodeIndex node = root;
+
+    while (node != NullNode || !stack.isEmpty()) {
+        while (node != NullNode) {
+            stack.append(node);
+            node = pool[node].left;
+        }
+
+        node = stack.last();
+        stack.removeLast();
+        keys[slot] = pool[node].key;
+
+        if (slot * 2 + 1 <= last) {
+            slot = slot * 2 + 1;
+            while (slot * 2 <= last) {
+                slot *= 2;
+            }
+        }
+        else {
+            slot >>= qCountTrailingZeroBits(~slot) + 1;
+        }
+
+        node = pool[node].right;
+    }
+}
+
+/***************************************************************************
+  函数名称：SnapshotIndex::clear
+  功    能：清空快照
+  输入参数：
+  返 回 值：
+  说    明：整块归还数组内存
+***************************************************************************/
+void SnapshotIndex::clear() {
+    std::vector<int>().swap(keys);
+    count = 0;
+}
+
+/***************************************************************************
+  函数名称：SnapshotIndex::getBytesReserved
+  功    能：获取快照占用的内存字节数
+  输入参数：
+  返 回 值：qint64 - 字节数
+  说    明：
+***************************************************************************/
+qint64 SnapshotIndex::getBytesReserved() const {
+    return static_cast<qint64>(keys.capacity()) * static_cast<qint64>(sizeof(int));
+}
+
+/***************************************************************************
+  函数名称：SnapshotIndex::lowerBoundSlot
+  功    能：查找不小于 value 的最小值所在槽位
+  输入参数：value - 要查找的值
+  返 回 值：quint64 - 槽位，不存在时为0
+  说    明：每层把比较结果直接加到下标上（k = 2k + (key < value)），循环中没有依赖比较结果的分支；
+            走出数组后，最后一次向左转的位置就是答案：去掉末尾连续的1（向右转）和再上一层即可；
+            预取只是提示，越过数组末尾的地址不会被访问
+***************************************************************************/
+quint64 SnapshotIndex::lowerBoundSlot(int value) const {
+    const int*    base = keys.data();
+    const quint64 last = static_cast<quint64>(count);
+    quint64 slot = 1;
+
+    while (slot <= last) {
+        SNAPSHOT_PREFETCH(base + slot * PrefetchStride);
+        slot = slot * 2 + (base[slot] < value);
+    }
+
+    return slot >> (qCountTrailingZeroBits(~slot) + 1);
+}
+
+/***************************************************************************
+  函数名称：SnapshotIndex::contains
+  功    能：检查值是否在快照中
+  输入参数：value - 要查找的值
+  返 回 值：bool - 是否存在
+  说    明：
+***************************************************************************/
+bool SnapshotIndex::contains(int value) const {
+    quint64 slot = lowerBoundSlot(value);
+    return slot != 0 && keys[slot] == value;
+}
+
+/***************************************************************************
+  函数名称：SnapshotIndex::lowerBound
+  功    能：查找不小于 value 的最小值
+  输入参数：value - 要查找的值，result - 用于返回找到的值
+  返 回 值：bool - 是否存在这样的值
+  说    明：
+***************************************************************************/
+bool SnapshotIndex::lowerBound(int value, int& result) const {
+    quint64 slot = lowerBoundSlot(value);
+    if (slot == 0) {
+        return false;
+    }
+
+    result = keys[slot];
+    return true;
+}
\ No newline at end of file
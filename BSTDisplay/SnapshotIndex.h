@@ -0,0 +1,42 @@
+﻿/***************************************************************************
+  文件名称：SnapshotIndex.h
+  功    能：只读快照索引的声明文件
+  说    明：把树的有序内容冻结为 Eytzinger（按层序排列的隐式完全树）数组，
+            查找时只做下标运算，不追随孩子链接，配合预取减少缓存缺失
+***************************************************************************/
+
+#ifndef SNAPSHOTINDEX_H
+#define SNAPSHOTINDEX_H
+
+#include <vector>
+#include "NodePool.h"
+
+/***************************************************************************
+  类名称：SnapshotIndex
+  功    能：Eytzinger 布局的只读有序索引
+  说    明：1 号槽位为根，k 号槽位的孩子为 2k 和 2k+1，0 号槽位不用；
+            查找循环中没有与比较结果相关的分支，每步预取四层以后的节点所在的缓存行；
+            建成后不再修改，树变化时由 BinarySearchTree 整体作废
+***************************************************************************/
+class SnapshotIndex {
+public:
+    SnapshotIndex(); // 构造函数
+
+    void build(const NodePool& pool, NodeIndex root, int count); // 按中序把树的内容填入快照
+    void clear();                                                // 清空快照
+
+    bool isEmpty() const { return count == 0; }                  // 快照是否为空
+    int  size() const    { return count; }                       // 快照中的值的个数
+    qint64 getBytesReserved() const;                             // 快照占用的内存字节数
+
+    bool contains(int value) const;                              // 值是否在快照中
+    bool lowerBound(int value, int& result) const;               // 不小于 value 的最小值
+
+private:
+    std::vector<int> keys;  // Eytzinger 顺序的值，0 号槽位不用
+    int              count; // 值的个数
+
+    quint64 lowerBoundSlot(int value) const; // 不小于 value 的最小值所在槽位，不存在时为0
+};
+
+#endif // SNAPSHOTINDEX_H
\ No newline at end of file
@@ -1,19 +1,57 @@
 ﻿/***************************************************************************
   文件名称：TreeNode.h
   功    能：树节点数据结构声明
-  说    明：
+  说    明：节点统一存放在 NodePool 的连续数组中，左右孩子用 32 位下标链接；
+            节点深度不再存储，由遍历时的层数得出；
+            平衡信息按位压缩：子树高度与红黑颜色共用一个 32 位字；
+            节点按键类型和映射值类型参数化，只存键的集合不为映射值占空间；
+            重复的键不另建节点，只增加节点的重复次数；子树节点数不单独存储，
+            集合中即各键重复次数之和，整数集合的节点为 24 字节
 ***************************************************************************/
 #ifndef TREENODE_H
 #define TREENODE_H
 
+#include <cstdint>
+
+typedef std::uint32_t NodeIndex; // 节点在内存池中的下标
+const NodeIndex NullNode = 0;    // 空节点下标（0 号槽位保留，不存放节点）
+
+// 不带映射值时的占位类型，树只是一个有序集合
+struct NoValue {};
+
+// 节点中的映射值
+template <typename Value>
+struct NodePayload {
+    Value value;
+};
+
+// 集合不存映射值，空基类优化后不占节点空间
+template <>
+struct NodePayload<NoValue> {};
+
+// 写入节点的映射值，集合没有映射值，什么也不做
+template <typename Value>
+inline void setPayload(NodePayload<Value>& payload, const Value& value) { payload.value = value; }
+inline void setPayload(NodePayload<NoValue>&, const NoValue&) {}
+
 // 二叉树节点定义
-struct TreeNode {
-    int       value;
-    TreeNode* left;
-    TreeNode* right;
-    int       depth; // 节点深度（从根节点开始计算，根节点深度为1）
+template <typename Key, typename Value>
+struct BasicTreeNode : NodePayload<Value> {
+    typedef Key   KeyType;   // 键类型
+    typedef Value ValueType; // 映射值类型
 
-    TreeNode(int val, int d);
+    Key           key;
+    NodeIndex     left;
+    NodeIndex     right;
+    std::uint32_t height : 31; // 以该节点为根的子树高度（叶子节点为1，空节点为0），AVL 由此得出平衡因子
+    std::uint32_t red    : 1;  // 红黑树颜色位（1为红，0为黑；空节点恒为黑）
+    int           count;       // 键的重复次数（集合恒为1，多重集合可大于1；空节点为0）
+    int           weight;      // 以该节点为根的子树中各键重复次数之和（空节点为0），名次由此得出，集合中即子树节点数
+
+    explicit BasicTreeNode(const Key& key) :
+        NodePayload<Value>(), key(key), left(NullNode), right(NullNode), height(1), red(0), count(1), weight(1) {}
 };
 
+typedef BasicTreeNode<int, NoValue> TreeNode; // 界面使用的整数树节点
+
 #endif // TREENODE_H
\ No newline at end of file
@@ -0,0 +1,354 @@
+﻿/***************************************************************************
+  文件名称：TreePublisher.cpp
+  功    能：已发布树版本的实现文件
+  说    明：所有原子操作都使用顺序一致的内存序，回收条件的推导依赖于它们的全序；
+            节点引用数只由写线程修改，发布、撤回和回收都在写线程上进行
+***************************************************************************/
+
+#include "TreePublisher.h"
+#include <limits>
+#include <thread>
+
+// 发布者与读者共同持有的内部状态
+struct TreePublisher::Domain {
+    std::atomic<TreeVersion*> current;             // 当前版本
+    std::atomic<quint64>      epoch;               // 全局纪元，从1开始
+    std::atomic<quint64>      readers[MaxReaders]; // 各槽位登记的纪元，0 为空闲
+    QVector<QPair<quint64, TreeVersion*>> retired; // 被替换下来的版本及其发布时的纪元（只由写线程访问）
+
+    Domain();             // 构造函数
+    ~Domain();            // 析构函数
+
+    int  pin();           // 登记读者，返回槽位
+    void unpin(int slot); // 撤销登记
+};
+
+/***************************************************************************
+  函数名称：TreePublisher::Domain::Domain
+  功    能：构造函数，发布初始的空版本
+  输入参数：
+  返 回 值：
+  说    明：
+***************************************************************************/
+TreePublisher::Domain::Domain() :
+    current(new TreeVersion), epoch(1)
+{
+    for (std::atomic<quint64>& reader : readers) {
+        reader.store(0);
+    }
+}
+
+/***************************************************************************
+  函数名称：TreePublisher::Domain::~Domain
+  功    能：析构函数，释放所有版本
+  输入参数：
+  返 回 值：
+  说    明：读者持有内部状态的引用，析构时已没有任何读者；
+            这时发布者已析构，可能在读者线程上，只释放版本本身，不再减少节点引用数
+***************************************************************************/
+TreePublisher::Domain::~Domain() {
+    for (const QPair<quint64, TreeVersion*>& entry : retired) {
+        delete entry.second;
+    }
+    delete current.load();
+}
+
+/***************************************************************************
+  函数名称：TreePublisher::Domain::pin
+  功    能：登记读者
+  输入参数：
+  返 回 值：int - 登记的槽位
+  说    明：把当前纪元写入一个空闲槽位；写入前纪元可能已被推进，
+            登记的纪元只会偏小，回收更保守，不影响正确性
+***************************************************************************/
+int TreePublisher::Domain::pin() {
+    for (;;) {
+        quint64 observed = epoch.load();
+        for (int slot = 0; slot < MaxReaders; slot++) {
+            quint64 expected = 0;
+            if (readers[slot].compare_exchange_strong(expected, observed)) {
+                return slot;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+/***************************************************************************
+  函数名称：TreePublisher::Domain::unpin
+  功    能：撤销登记
+  输入参数：slot - 登记的槽位
+  返 回 值：
+  说    明：
+***************************************************************************/
+void TreePublisher::Domain::unpin(int slot) {
+    readers[slot].store(0);
+}
+
+/***************************************************************************
+  函数名称：TreePublisher::TreePublisher
+  功    能：构造函数
+  输入参数：
+  返 回 值：
+  说    明：当前版本为空树，读者在第一次发布前也能取到有效版本
+***************************************************************************/
+TreePublisher::TreePublisher() :
+    domain(std::make_shared<Domain>())
+{
+}
+
+/***************************************************************************
+  函数名称：TreePublisher::~TreePublisher
+  功    能：析构函数
+  输入参数：
+  返 回 值：
+  说    明：在写线程上撤回当前版本，没有读者持有的版本随即释放并归还节点；
+            仍被读者持有的版本留给内部状态析构时释放
+***************************************************************************/
+TreePublisher::~TreePublisher() {
+    withdraw();
+}
+
+/***************************************************************************
+  函数名称：TreePublisher::publish
+  功    能：与写线程共用节点，发布一个新版本
+  输入参数：pool - 写线程的节点内存池，root - 根节点下标，
+            nodeCount - 节点数，totalCount - 计入重复次数的元素总数
+  返 回 值：
+  说    明：版本共用 pool 的存储，根节点多一处引用，不复制节点，O(1)；
+            写线程之后像修改保存过版本的树一样按路径复制被共用的节点，版本可达的节点不会被改写；
+            读者通过只读视图访问节点数组，写线程扩容换用新数组时视图仍指向原数组
+***************************************************************************/
+void TreePublisher::publish(const NodePool& pool, NodeIndex root, int nodeCount, int totalCount) {
+    TreeVersion* version = new TreeVersion;
+    version->source.shareWith(pool);
+    version->source.addRef(root);
+    version->pool.viewOf(pool);
+    version->root       = root;
+    version->nodeCount  = nodeCount;
+    version->totalCount = totalCount;
+    version->height     = pool[root].height;
+
+    replace(version);
+}
+
+/***************************************************************************
+  函数名称：TreePublisher::withdraw
+  功    能：发布空版本
+  输入参数：
+  返 回 值：
+  说    明：停止发布时调用，之前的版本按纪元回收后不再持有写线程的节点，
+            写线程的修改不必再复制路径
+***************************************************************************/
+void TreePublisher::withdraw() {
+    if (domain->current.load()->isEmpty()) {
+        reclaim();
+        return;
+    }
+    replace(new TreeVersion);
+}
+
+/***************************************************************************
+  函数名称：TreePublisher::replace
+  功    能：换上新版本
+  输入参数：version - 新版本
+  返 回 值：
+  说    明：交换当前版本后推进纪元，旧版本连同推进前的纪元放入待回收列表，再尝试回收
+***************************************************************************/
+void TreePublisher::replace(TreeVersion* version) {
+    TreeVersion* previous = domain->current.load();
+    version->sequence = previous->sequence + 1;
+
+    domain->current.exchange(version);
+    quint64 retiredEpoch = domain->epoch.fetch_add(1);
+    domain->retired.append(qMakePair(retiredEpoch, previous));
+
+    reclaim();
+}
+
+/***************************************************************************
+  函数名称：TreePublisher::release
+  功    能：减少版本持有的节点引用并释放版本
+  输入参数：version - 已没有读者持有的版本
+  返 回 值：
+  说    明：从根开始减少引用数，只被这个版本引用的节点归还给写线程的空闲链表并继续处理其孩子，
+            仍被写线程的树或其他版本引用的节点到此为止；
+            写线程按路径复制时被替换下来的节点只属于旧版本，回收的工作量与复制的节点数相当
+***************************************************************************/
+void TreePublisher::release(TreeVersion* version) {
+    NodePool& source = version->source;
+    QVector<NodeIndex> stack;
+    stack.append(version->root);
+
+    while (!stack.isEmpty()) {
+        NodeIndex node = stack.takeLast();
+        if (!source.dropRef(node)) {
+            continue;
+        }
+        stack.append(source[node].left);
+        stack.append(source[node].right);
+        source.release(node);
+    }
+
+    delete version;
+}
+
+/***************************************************************************
+  函数名称：TreePublisher::acquire
+  功    能：登记读者并取当前版本
+  输入参数：
+  返 回 值：ReadGuard - 持有当前版本的登记
+  说    明：先登记纪元再读取当前版本，顺序不能颠倒
+***************************************************************************/
+TreePublisher::ReadGuard TreePublisher::acquire() const {
+    ReadGuard guard;
+    guard.domain  = domain;
+    guard.slot    = domain->pin();
+    guard.version = domain->current.load();
+    return guard;
+}
+
+/***************************************************************************
+  函数名称：TreePublisher::reclaim
+  功    能：释放没有读者持有的旧版本
+  输入参数：
+  返 回 值：int - 释放的版本数
+  说    明：取登记中的读者纪元的最小值，发布时纪元小于它的旧版本不会再被任何读者访问；
+            每次发布后自动调用，长期持有版本的读者只推迟它之后的旧版本的回收
+***************************************************************************/
+int TreePublisher::reclaim() {
+    quint64 oldestReader = std::numeric_limits<quint64>::max();
+    for (const std::atomic<quint64>& reader : domain->readers) {
+        quint64 pinned = reader.load();
+        if (pinned != 0 && pinned < oldestReader) {
+            oldestReader = pinned;
+        }
+    }
+
+    int freed = 0;
+    QVector<QPair<quint64, TreeVersion*>>& retired = domain->retired;
+    for (int i = 0; i < retired.size(); ) {
+        if (retired[i].first < oldestReader) {
+            release(retired[i].second);
+            retired[i] = retired.last();
+            retired.removeLast();
+            freed++;
+        }
+        else {
+            i++;
+        }
+    }
+
+    return freed;
+}
+
+/***************************************************************************
+  函数名称：TreePublisher::getEpoch
+  功    能：获取当前全局纪元
+  输入参数：
+  返 回 值：quint64 - 全局纪元
+  说    明：每次发布加1
+***************************************************************************/
+quint64 TreePublisher::getEpoch() const {
+    return domain->epoch.load();
+}
+
+/***************************************************************************
+  函数名称：TreePublisher::getRetiredCount
+  功    能：获取等待回收的旧版本数
+  输入参数：
+  返 回 值：int - 旧版本数
+  说    明：只能由写线程调用
+***************************************************************************/
+int TreePublisher::getRetiredCount() const {
+    return domain->retired.size();
+}
+
+/***************************************************************************
+  函数名称：TreePublisher::getActiveReaders
+  功    能：获取登记中的读者数
+  输入参数：
+  返 回 值：int - 读者数
+  说    明：各槽位分别读取，其他线程同时登记时结果只是近似值
+***************************************************************************/
+int TreePublisher::getActiveReaders() const {
+    int active = 0;
+    for (const std::atomic<quint64>& reader : domain->readers) {
+        if (reader.load() != 0) {
+            active++;
+        }
+    }
+    return active;
+}
+
+/***************************************************************************
+  函数名称：TreePublisher::ReadGuard::ReadGuard
+  功    能：构造空登记
+  输入参数：
+  返 回 值：
+  说    明：
+***************************************************************************/
+TreePublisher::ReadGuard::ReadGuard() :
+    slot(-1), version(nullptr)
+{
+}
+
+/***************************************************************************
+  函数名称：TreePublisher::ReadGuard::ReadGuard
+  功    能：移动构造
+  输入参数：other - 被移动的登记，之后为空
+  返 回 值：
+  说    明：
+***************************************************************************/
+TreePublisher::ReadGuard::ReadGuard(ReadGuard&& other) :
+    domain(std::move(other.domain)), slot(other.slot), version(other.version)
+{
+    other.slot    = -1;
+    other.version = nullptr;
+}
+
+/***************************************************************************
+  函数名称：TreePublisher::ReadGuard::operator=
+  功    能：移动赋值
+  输入参数：other - 被移动的登记，之后为空
+  返 回 值：ReadGuard& - 自身
+  说    明：先撤销原有登记
+***************************************************************************/
+TreePublisher::ReadGuard& TreePublisher::ReadGuard::operator=(ReadGuard&& other) {
+    if (this != &other) {
+        release();
+        domain  = std::move(other.domain);
+        slot    = other.slot;
+        version = other.version;
+        other.slot    = -1;
+        other.version = nullptr;
+    }
+    return *this;
+}
+
+/***************************************************************************
+  函数名称：TreePublisher::ReadGuard::~ReadGuard
+  功    能：析构函数
+  输入参数：
+  返 回 值：
+  说    明：撤销登记
+***************************************************************************/
+TreePublisher::ReadGuard::~ReadGuard() {
+    release();
+}
+
+/***************************************************************************
+  函数名称：TreePublisher::ReadGuard::release
+  功    能：撤销登记
+  输入参数：
+  返 回 值：
+  说    明：之后不能再访问原来持有的版本，它可能在下一次发布时被释放
+***************************************************************************/
+void TreePublisher::ReadGuard::release() {
+    if (domain) {
+        domain->unpin(slot);
+        domain.reset();
+    }
+    slot    = -1;
+    version = nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+﻿/***************************************************************************
+  文件名称：TreePublisher.h
+  功    能：已发布树版本的声明文件
+  说    明：写线程每次修改后把树冻结为一个只读版本，用一次原子交换发布；
+            版本与写线程的树共用节点，根节点多一处引用，之后写线程按路径复制修改，发布 O(1)；
+            视图、状态栏等读者先登记纪元再取当前版本，绘制期间一直持有，写线程照常修改；
+            被替换下来的版本按纪元回收，只有所有读者都已越过它发布时的纪元才释放，
+            释放时只回收它独有的节点，即之后被写线程复制替换掉的路径
+***************************************************************************/
+
+#ifndef TREEPUBLISHER_H
+#define TREEPUBLISHER_H
+
+#include <atomic>
+#include <memory>
+#include <QVector>
+#include <QPair>
+#include "NodePool.h"
+
+/***************************************************************************
+  结构名称：TreeVersion
+  功    能：一个已发布的只读树版本
+  说    明：通过只读视图读取写线程的节点数组，版本可达的节点被引用计数保护，写线程不会改写，
+            节点句柄可以在任意线程上遍历
+***************************************************************************/
+struct TreeVersion {
+    NodePool  pool;                  // 写线程节点数组的只读视图
+    NodePool  source;                // 与写线程共用的节点存储，回收时在其中减少引用数，只由写线程访问
+    NodeIndex root       = NullNode; // 根节点下标
+    int       nodeCount  = 0;        // 节点数
+    int       totalCount = 0;        // 计入重复次数的元素总数
+    int       height     = 0;        // 树的高度
+    quint64   sequence   = 0;        // 发布序号，从1开始，0 为初始的空版本
+
+    bool       isEmpty() const { return root == NullNode; }           // 版本是否为空树
+    NodeHandle getRoot() const { return NodeHandle(&pool, root, 1); } // 根节点句柄
+};
+
+/***************************************************************************
+  类名称：TreePublisher
+  功    能：树版本的发布与基于纪元的回收
+  说    明：publish 与 reclaim 只能由写线程调用，acquire 可以在任意线程上调用；
+            读者登记在固定数量的槽位中，槽位中存放登记时的全局纪元，0 表示空闲；
+            发布时根节点多一处引用，先交换当前版本再推进纪元，旧版本记下推进前的纪元 E，
+            之后登记的读者纪元都大于 E、只能取到新版本，
+            所以当所有登记中的读者纪元都大于 E 时旧版本可以释放；
+            内部状态由发布者与读者共同持有，发布者先于读者析构也不会悬空
+***************************************************************************/
+class TreePublisher {
+public:
+    class ReadGuard;
+
+    TreePublisher();  // 构造函数，当前版本为空树
+    ~TreePublisher(); // 析构函数，撤回当前版本并回收没有读者持有的版本
+
+    TreePublisher(const TreePublisher&) = delete;
+    TreePublisher& operator=(const TreePublisher&) = delete;
+
+    void      publish(const NodePool& pool, NodeIndex root, int nodeCount, int totalCount); // 与写线程共用节点，发布一个新版本
+    void      withdraw();                                                                   // 发布空版本，不再持有写线程的节点
+    ReadGuard acquire() const;                                                              // 登记读者并取当前版本
+    int       reclaim();                                                                    // 释放没有读者持有的旧版本，返回释放的个数
+
+    quint64 getEpoch() const;         // 当前全局纪元
+    int     getRetiredCount() const;  // 等待回收的旧版本数
+    int     getActiveReaders() const; // 登记中的读者数
+
+    static const int MaxReaders = 64; // 同时登记的读者上限，槽位用尽时新读者让出时间片等待
+
+private:
+    struct Domain;
+
+    std::shared_ptr<Domain> domain; // 发布者与读者共同持有的内部状态
+
+    void replace(TreeVersion* version);       // 换上新版本，旧版本放入待回收列表
+    static void release(TreeVersion* version); // 减少版本持有的节点引用并释放版本
+};
+
+/***************************************************************************
+  类名称：TreePublisher::ReadGuard
+  功    能：读者对一个已发布版本的登记
+  说    明：析构或 release 时撤销登记；只能移动不能复制，
+            持有期间版本和其中所有节点都不会被释放
+***************************************************************************/
+class TreePublisher::ReadGuard {
+public:
+    ReadGuard();                             // 空登记
+    ReadGuard(ReadGuard&& other);            // 移动构造
+    ReadGuard& operator=(ReadGuard&& other); // 移动赋值，先撤销原有登记
+    ~ReadGuard();                            // 析构函数，撤销登记
+
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+
+    void release(); // 撤销登记
+
+    explicit operator bool() const        { return version != nullptr; } // 是否持有版本
+    const TreeVersion* get() const        { return version; }            // 持有的版本
+    const TreeVersion* operator->() const { return version; }            // 访问持有的版本
+
+private:
+    friend class TreePublisher;
+
+    std::shared_ptr<Domain> domain;  // 所属发布者的内部状态
+    int                     slot;    // 登记的槽位
+    const TreeVersion*      version; // 持有的版本
+};
+
+#endif // TREEPUBLISHER_H
\ No newline at end of file